@@ -6,6 +6,7 @@
 #include <map>
 #include <numeric>
 #include <omp.h>
+#include <sstream>
 #include <string>
 #include <vector>
 #include "ite.h"
@@ -35,9 +36,37 @@ enum : int
     OPT_SAUVOLA_WINDOW,
     OPT_SAUVOLA_K,
     OPT_SAUVOLA_DELTA,
+    OPT_NIBLACK_K,
+    OPT_WOLF_K,
+    OPT_PHANSALKAR_K,
+    OPT_NICK_K,
+    OPT_OTSU_TILE_SIZE,
+    OPT_OTSU_THRESHOLDS,
+    OPT_THRESHOLD_SCALE,
+    OPT_DO_DPI_NORMALIZATION,
+    OPT_TARGET_DPI,
+    OPT_DO_AUTO_CROP,
+    OPT_CROP_PASTE_BACK,
+    OPT_DO_ORIENTATION,
+    OPT_SKEW_METHOD,
+    OPT_DESKEW_SEARCH,
+    OPT_DESKEW_EARLY_EXIT,
+    OPT_DESKEW_MAX_EVALS,
+    OPT_DO_BACKGROUND_FLATTENING,
+    OPT_BACKGROUND_WINDOW,
+    OPT_DO_CLAHE,
+    OPT_CLAHE_TILE_SIZE,
+    OPT_CLAHE_CLIP_LIMIT,
+    OPT_DO_AUTO_POLARITY,
+    OPT_DO_LINE_REMOVAL,
+    OPT_LINE_MIN_LENGTH,
+    OPT_REPORT_FMEASURE,
+    OPT_SWEEP,
     OPT_TRIALS,
     OPT_WARMUP,
-    OPT_TIME_LIMIT
+    OPT_TIME_LIMIT,
+    OPT_MRC,
+    OPT_MRC_SCALE
 };
 
 static void die_usage(const std::string &msg, int exit_code = 2)
@@ -96,6 +125,333 @@ static void require_positive_f(const char* opt_name, float v)
         die_usage(std::string(opt_name) + " must be > 0");
 }
 
+// Toggles are plain flags on the command line and take on/off in --sweep
+static bool parse_toggle(const char* s, const char* opt_name)
+{
+    if (s == nullptr)
+        return true;
+
+    const std::string v = s;
+    if (v == "on" || v == "1" || v == "true")
+        return true;
+    if (v == "off" || v == "0" || v == "false")
+        return false;
+
+    die_usage(std::string(opt_name) + " expects on or off (got '" + v + "')");
+    return false;
+}
+
+// Applies one pipeline option; `arg` is null for plain toggles. Returns false if `id` is not a pipeline option.
+static bool apply_enhance_option(int id, const char* arg, const char* name, ite::EnhanceOptions &opt)
+{
+    switch (id)
+    {
+    case OPT_DO_GAUSSIAN:
+        opt.do_gaussian_blur = parse_toggle(arg, name);
+        break;
+    case OPT_DO_MEDIAN:
+        opt.do_median_blur = parse_toggle(arg, name);
+        break;
+    case OPT_DO_ADAPTIVE_MEDIAN:
+        opt.do_adaptive_median = parse_toggle(arg, name);
+        break;
+    case OPT_DO_ADAPTIVE_GAUSSIAN:
+        opt.do_adaptive_gaussian_blur = parse_toggle(arg, name);
+        break;
+    case OPT_DO_EROSION:
+        opt.do_erosion = parse_toggle(arg, name);
+        break;
+    case OPT_DO_DILATION:
+        opt.do_dilation = parse_toggle(arg, name);
+        break;
+    case OPT_DO_DESPECKLE:
+        opt.do_despeckle = parse_toggle(arg, name);
+        break;
+    case OPT_DO_DESKEW:
+        opt.do_deskew = parse_toggle(arg, name);
+        break;
+    case OPT_DO_COLOR_PASS:
+        opt.do_color_pass = parse_toggle(arg, name);
+        break;
+    case OPT_BINARIZATION_METHOD:
+        {
+            std::string method = arg;
+            for (auto &c : method)
+                c = tolower(c);
+
+            if (method == "otsu")
+                opt.binarization_method = ite::BinarizationMethod::Otsu;
+            else if (method == "sauvola")
+                opt.binarization_method = ite::BinarizationMethod::Sauvola;
+            else if (method == "bataineh")
+                opt.binarization_method = ite::BinarizationMethod::Bataineh;
+            else if (method == "niblack")
+                opt.binarization_method = ite::BinarizationMethod::Niblack;
+            else if (method == "wolf")
+                opt.binarization_method = ite::BinarizationMethod::Wolf;
+            else if (method == "phansalkar")
+                opt.binarization_method = ite::BinarizationMethod::Phansalkar;
+            else if (method == "nick")
+                opt.binarization_method = ite::BinarizationMethod::Nick;
+            else
+                die_usage("Unknown binarization method: " + method + " (allowed: otsu, sauvola, bataineh, niblack, wolf, phansalkar, nick)");
+            break;
+        }
+    case OPT_SIGMA:
+        opt.sigma = parse_float(arg, "--sigma");
+        require_positive_f("--sigma", opt.sigma);
+        break;
+    case OPT_SIGMA_LOW:
+        opt.adaptive_sigma_low = parse_float(arg, "--sigma-low");
+        require_positive_f("--sigma-low", opt.adaptive_sigma_low);
+        break;
+    case OPT_SIGMA_HIGH:
+        opt.adaptive_sigma_high = parse_float(arg, "--sigma-high");
+        require_positive_f("--sigma-high", opt.adaptive_sigma_high);
+        break;
+    case OPT_EDGE_THRESH:
+        opt.adaptive_edge_thresh = parse_float(arg, "--edge-thresh");
+        break;
+    case OPT_MEDIAN_SIZE:
+        opt.median_kernel_size = (int)parse_uint(arg, "--median-size");
+        require_positive("--median-size", opt.median_kernel_size);
+        break;
+    case OPT_MEDIAN_THRESH:
+        opt.median_threshold = (int)parse_uint(arg, "--median-thresh");
+        break;
+    case OPT_ADAPTIVE_MEDIAN_MAX:
+        opt.adaptive_median_max_window = (int)parse_uint(arg, "--adaptive-median-max");
+        require_positive("--adaptive-median-max", opt.adaptive_median_max_window);
+        if ((opt.adaptive_median_max_window % 2) == 0)
+            die_usage("--adaptive-median-max must be odd");
+        if (opt.adaptive_median_max_window < 3)
+            die_usage("--adaptive-median-max must be >= 3");
+        break;
+    case OPT_KERNEL_SIZE:
+        opt.kernel_size = (int)parse_uint(arg, "--kernel-size");
+        require_positive("--kernel-size", opt.kernel_size);
+        break;
+    case OPT_DESPECKLE_THRESH:
+        opt.despeckle_threshold = (int)parse_uint(arg, "--despeckle-thresh");
+        require_non_negative("--despeckle-thresh", opt.despeckle_threshold);
+        break;
+    case OPT_SAUVOLA_WINDOW:
+        opt.sauvola_window_size = (int)parse_uint(arg, "--sauvola-window");
+        require_positive("--sauvola-window", opt.sauvola_window_size);
+        break;
+    case OPT_SAUVOLA_K:
+        opt.sauvola_k = parse_float(arg, "--sauvola-k");
+        require_positive_f("--sauvola-k", opt.sauvola_k);
+        break;
+    case OPT_SAUVOLA_DELTA:
+        opt.sauvola_delta = parse_float(arg, "--sauvola-delta");
+        break;
+    case OPT_NIBLACK_K:
+        opt.niblack_k = parse_float(arg, "--niblack-k");
+        break;
+    case OPT_WOLF_K:
+        opt.wolf_k = parse_float(arg, "--wolf-k");
+        break;
+    case OPT_PHANSALKAR_K:
+        opt.phansalkar_k = parse_float(arg, "--phansalkar-k");
+        break;
+    case OPT_NICK_K:
+        opt.nick_k = parse_float(arg, "--nick-k");
+        break;
+    case OPT_OTSU_TILE_SIZE:
+        opt.otsu_tile_size = (int)parse_uint(arg, "--otsu-tile-size");
+        if (opt.otsu_tile_size != 0 && opt.otsu_tile_size < 16)
+            die_usage("--otsu-tile-size must be 0 or at least 16");
+        break;
+    case OPT_OTSU_THRESHOLDS:
+        opt.otsu_thresholds = (int)parse_uint(arg, "--otsu-thresholds");
+        if (opt.otsu_thresholds < 1 || opt.otsu_thresholds > 3)
+            die_usage("--otsu-thresholds must be between 1 and 3");
+        break;
+    case OPT_THRESHOLD_SCALE:
+        opt.threshold_scale = (int)parse_uint(arg, "--threshold-scale");
+        if (opt.threshold_scale < 1 || opt.threshold_scale > 8)
+            die_usage("--threshold-scale must be between 1 and 8");
+        break;
+    case OPT_DO_DPI_NORMALIZATION:
+        opt.do_dpi_normalization = parse_toggle(arg, name);
+        break;
+    case OPT_TARGET_DPI:
+        opt.target_dpi = (int)parse_uint(arg, "--target-dpi");
+        if (opt.target_dpi < 50)
+            die_usage("--target-dpi must be at least 50");
+        break;
+    case OPT_DO_AUTO_CROP:
+        opt.do_auto_crop = parse_toggle(arg, name);
+        break;
+    case OPT_CROP_PASTE_BACK:
+        opt.crop_paste_back = parse_toggle(arg, name);
+        break;
+    case OPT_DO_ORIENTATION:
+        opt.do_orientation = parse_toggle(arg, name);
+        break;
+    case OPT_SKEW_METHOD:
+        {
+            std::string method = arg;
+            for (auto &c : method)
+                c = tolower(c);
+
+            if (method == "projection")
+                opt.skew_method = ite::SkewMethod::ProjectionProfile;
+            else if (method == "docstrum")
+                opt.skew_method = ite::SkewMethod::Docstrum;
+            else
+                die_usage("Unknown skew method: " + method + " (allowed: projection, docstrum)");
+            break;
+        }
+    case OPT_DESKEW_SEARCH:
+        {
+            std::string search = arg;
+            for (auto &c : search)
+                c = tolower(c);
+
+            if (search == "grid")
+                opt.deskew_search = ite::DeskewSearch::Grid;
+            else if (search == "golden")
+                opt.deskew_search = ite::DeskewSearch::Golden;
+            else if (search == "ternary")
+                opt.deskew_search = ite::DeskewSearch::Ternary;
+            else
+                die_usage("Unknown deskew search: " + search + " (allowed: grid, golden, ternary)");
+            break;
+        }
+    case OPT_DESKEW_EARLY_EXIT:
+        opt.deskew_early_exit = parse_float(arg, "--deskew-early-exit");
+        if (opt.deskew_early_exit < 0.0f)
+            die_usage("--deskew-early-exit must be non-negative");
+        break;
+    case OPT_DESKEW_MAX_EVALS:
+        opt.deskew_max_evaluations = (int)parse_uint(arg, "--deskew-max-evals");
+        break;
+    case OPT_DO_BACKGROUND_FLATTENING:
+        opt.do_background_flattening = parse_toggle(arg, name);
+        break;
+    case OPT_BACKGROUND_WINDOW:
+        opt.background_window = (int)parse_uint(arg, "--background-window");
+        if (opt.background_window < 3)
+            die_usage("--background-window must be at least 3");
+        break;
+    case OPT_DO_CLAHE:
+        opt.do_clahe = parse_toggle(arg, name);
+        break;
+    case OPT_CLAHE_TILE_SIZE:
+        opt.clahe_tile_size = (int)parse_uint(arg, "--clahe-tile-size");
+        if (opt.clahe_tile_size < 8)
+            die_usage("--clahe-tile-size must be at least 8");
+        break;
+    case OPT_CLAHE_CLIP_LIMIT:
+        opt.clahe_clip_limit = parse_float(arg, "--clahe-clip-limit");
+        require_positive_f("--clahe-clip-limit", opt.clahe_clip_limit);
+        break;
+    case OPT_DO_AUTO_POLARITY:
+        opt.do_auto_polarity = parse_toggle(arg, name);
+        break;
+    case OPT_DO_LINE_REMOVAL:
+        opt.do_line_removal = parse_toggle(arg, name);
+        break;
+    case OPT_LINE_MIN_LENGTH:
+        opt.line_min_length = (int)parse_uint(arg, "--line-min-length");
+        if (opt.line_min_length < 3)
+            die_usage("--line-min-length must be at least 3");
+        break;
+    default:
+        return false;
+    }
+    return true;
+}
+
+static std::string option_name(const option* longopts, int id)
+{
+    for (const option* o = longopts; o->name; ++o)
+    {
+        if (o->val == id)
+            return std::string("--") + o->name;
+    }
+    return "option";
+}
+
+struct SweepCombination
+{
+    ite::EnhanceOptions options;
+    std::string label; ///< "name=value" of every swept option
+};
+
+// Expands "--sweep name=v1,v2" specs into the cartesian product on top of `base`
+static std::vector<SweepCombination> expand_sweeps(const ite::EnhanceOptions &base, const std::vector<std::string> &sweeps, const option* longopts)
+{
+    std::vector<SweepCombination> combinations = {{base, ""}};
+    for (const auto &spec : sweeps)
+    {
+        const size_t eq = spec.find('=');
+        if (eq == std::string::npos || eq == 0 || eq + 1 == spec.size())
+            die_usage("--sweep expects <option>=<v1,v2,...> (got '" + spec + "')");
+
+        const std::string name = spec.substr(0, eq);
+        const option* match = nullptr;
+        for (const option* o = longopts; o->name; ++o)
+        {
+            if (name == o->name)
+                match = o;
+        }
+        std::vector<std::string> values;
+        std::stringstream list(spec.substr(eq + 1));
+        for (std::string v; std::getline(list, v, ',');)
+        {
+            if (v.empty())
+                die_usage("--sweep: empty value in '" + spec + "'");
+            values.push_back(v);
+        }
+
+        // Applying the first value to a scratch copy validates the option name and value
+        ite::EnhanceOptions probe;
+        if (!match || !apply_enhance_option(match->val, values.front().c_str(), ("--" + name).c_str(), probe))
+            die_usage("--sweep: '" + name + "' is not a pipeline option");
+
+        std::vector<SweepCombination> expanded;
+        for (const auto &c : combinations)
+        {
+            for (const auto &v : values)
+            {
+                SweepCombination next = c;
+                apply_enhance_option(match->val, v.c_str(), ("--" + name).c_str(), next.options);
+                next.label += (next.label.empty() ? "" : " ") + name + "=" + v;
+                expanded.push_back(std::move(next));
+            }
+        }
+        combinations = std::move(expanded);
+    }
+    return combinations;
+}
+
+// out.png -> out_007.png
+static std::string sweep_output_path(const std::string &output_path, size_t index)
+{
+    std::filesystem::path p(output_path);
+    std::ostringstream name;
+    name << p.stem().string() << '_' << std::setw(3) << std::setfill('0') << index << p.extension().string();
+    return (p.parent_path() / name.str()).string();
+}
+
+// Saves a result as an image, or as MRC layers next to it (out.png -> out.mask.png + out.fg.jpg)
+static std::string save_result(const CImg<uint> &result, const std::string &output_path, int mrc_scale)
+{
+    if (mrc_scale == 0)
+    {
+        ite::writeimage(result, output_path);
+        return output_path;
+    }
+
+    std::filesystem::path p(output_path);
+    const std::string base = (p.parent_path() / p.stem()).string();
+    ite::writemrc(result, base, mrc_scale);
+    return base + ".mask.png + " + base + ".fg.jpg";
+}
+
 static void print_help(const char* prog)
 {
     const ite::EnhanceOptions d; // default values
@@ -108,7 +464,29 @@ static void print_help(const char* prog)
 
               << "GEOMETRY & PRE-PROCESSING:\n"
               << "  (Note: Contrast Stretching and Grayscale conversion are ALWAYS performed)\n"
-              << "      --do-deskew               Straighten tilted text (default: " << (d.do_deskew ? "ON" : "OFF") << ")\n\n"
+              << "      --do-auto-polarity        Invert light-text-on-dark pages during grayscale conversion (default: "
+              << (d.do_auto_polarity ? "ON" : "OFF") << ")\n"
+              << "      --do-deskew               Straighten tilted text (default: " << (d.do_deskew ? "ON" : "OFF") << ")\n"
+              << "      --do-orientation          Turn sideways and upside-down pages upright (default: " << (d.do_orientation ? "ON" : "OFF") << ")\n"
+              << "      --skew-method <name>      Skew estimator: projection, docstrum [sparse pages] (default: projection)\n"
+              << "      --deskew-search <name>    Refinement of the projection search: grid, golden, ternary (default: grid)\n"
+              << "      --deskew-early-exit <f>   Score drop at +-0.1 deg that marks a page as straight, 0 = always search (default: "
+              << d.deskew_early_exit << ")\n"
+              << "      --deskew-max-evals <int>  Maximum number of scored angles, 0 = no limit (default: " << d.deskew_max_evaluations << ")\n"
+              << "      --do-dpi-normalization    Downscale high-resolution scans to --target-dpi first; windows and kernels scale along (default: "
+              << (d.do_dpi_normalization ? "ON" : "OFF") << ")\n"
+              << "      --target-dpi <int>        Working resolution, estimated from the text's x-height (default: " << d.target_dpi << ")\n"
+              << "      --do-auto-crop            Crop to the page content and inside dark scanner borders (default: " << (d.do_auto_crop ? "ON" : "OFF")
+              << ")\n"
+              << "      --crop-paste-back         Paste the cropped result back onto a white page of the original size (default: "
+              << (d.crop_paste_back ? "ON" : "OFF") << ")\n"
+              << "      --do-background-flattening  Divide out uneven illumination before contrast stretching (default: "
+              << (d.do_background_flattening ? "ON" : "OFF") << ")\n"
+              << "      --background-window <int> Background window in pixels, wider than the widest stroke (default: " << d.background_window << ")\n"
+              << "      --do-clahe                Local contrast equalization (CLAHE) instead of the global stretch (default: " << (d.do_clahe ? "ON" : "OFF")
+              << ")\n"
+              << "      --clahe-tile-size <int>   CLAHE tile size in pixels, >= 8 (default: " << d.clahe_tile_size << ")\n"
+              << "      --clahe-clip-limit <f>    CLAHE histogram clip limit, relative to the mean bin count (default: " << d.clahe_clip_limit << ")\n\n"
 
               << "DENOISING (Pre-Binarization):\n"
               << "      --do-gaussian             Apply Gaussian blur (default: " << (d.do_gaussian_blur ? "ON" : "OFF") << ")\n"
@@ -123,12 +501,23 @@ static void print_help(const char* prog)
               << "      --do-adaptive-median      Apply adaptive median filter (default: " << (d.do_adaptive_median ? "ON" : "OFF") << ")\n\n"
 
               << "BINARIZATION (Sauvola Algorithm):\n"
-              << "      --binarization <name>         Method: otsu, sauvola, bataineh (default: bataineh)\n"
+              << "      --binarization <name>         Method: otsu, sauvola, bataineh, niblack, wolf, phansalkar, nick (default: bataineh)\n"
               << "      --sauvola-window <int>    Local window size (default: " << d.sauvola_window_size << ")\n"
               << "      --sauvola-k <float>       Sensitivity parameter k (default: " << d.sauvola_k << ")\n"
-              << "      --sauvola-delta <float>   Threshold offset delta (default: " << d.sauvola_delta << ")\n\n"
+              << "      --sauvola-delta <float>   Threshold offset delta (default: " << d.sauvola_delta << ")\n"
+              << "      --niblack-k <float>       Niblack k, uses --sauvola-window (default: " << d.niblack_k << ")\n"
+              << "      --wolf-k <float>          Wolf-Jolion k, uses --sauvola-window (default: " << d.wolf_k << ")\n"
+              << "      --phansalkar-k <float>    Phansalkar k, uses --sauvola-window (default: " << d.phansalkar_k << ")\n"
+              << "      --nick-k <float>          NICK k, uses --sauvola-window (default: " << d.nick_k << ")\n"
+              << "      --otsu-tile-size <int>    Per-tile Otsu thresholds, 0 = global, otherwise >= 16 (default: " << d.otsu_tile_size << ")\n"
+              << "      --otsu-thresholds <int>   Multi-level Otsu, 1-3; only the darkest class is text (default: " << d.otsu_thresholds << ")\n"
+              << "      --threshold-scale <int>   Threshold surface grid spacing for sauvola/bataineh, 1-8 (default: " << d.threshold_scale << ")\n"
+              << "      --report-fmeasure         Print the F-measure of the result against full-resolution thresholds\n\n"
 
               << "MORPHOLOGY (Post-Binarization):\n"
+              << "      --do-line-removal         Remove long horizontal/vertical lines, keeping crossing strokes (default: "
+              << (d.do_line_removal ? "ON" : "OFF") << ")\n"
+              << "      --line-min-length <int>   Shortest black run that counts as a line (default: " << d.line_min_length << ")\n"
               << "      --do-despeckle            Remove small noise specks (default: " << (d.do_despeckle ? "ON" : "OFF") << ")\n"
               << "      --despeckle-thresh <int>  Max pixel size of specks to remove (default: " << d.despeckle_threshold << ")\n"
               << "      --do-dilation             Thicken/bolden dark features (default: " << (d.do_dilation ? "ON" : "OFF") << ")\n"
@@ -137,6 +526,11 @@ static void print_help(const char* prog)
 
               << "OUTPUT OPTIONS:\n"
               << "      --do-color-pass           Re-apply original color to binarized mask (default: " << (d.do_color_pass ? "ON" : "OFF") << ")\n"
+              << "      --mrc                     Save as a 1-bit <output>.mask.png plus a low-resolution <output>.fg.jpg color layer\n"
+              << "      --mrc-scale <int>         Block size of the MRC color layer, implies --mrc (default: 8)\n"
+              << "      --sweep <opt>=<v1,v2,..>  Evaluate every combination of the listed values in one process, sharing\n"
+              << "                                the common pipeline prefix; repeatable, toggles take on/off.\n"
+              << "                                Results are saved as <output>_<index>.<ext>\n"
               << "  -h, --help                    Show this help\n"
               << "  -v, --verbose                     Enable per-step timing output during execution\n"
               << "      --trials <int>                Number of trials for benchmark (default: 1)\n"
@@ -189,6 +583,9 @@ int main(int argc, char* argv[])
     bool verbose_log = false;
     int trials = 1;
     int warmup = 0;
+    bool report_fmeasure = false;
+    int mrc_scale = 0; // 0 = save a plain image
+    std::vector<std::string> sweeps;
 
     // getopt settings:
     // - leading ':' => we handle missing arg as ':' return value
@@ -204,6 +601,8 @@ int main(int argc, char* argv[])
                                {"trials", required_argument, nullptr, OPT_TRIALS},
                                {"warmup", required_argument, nullptr, OPT_WARMUP},
                                {"time-limit", required_argument, nullptr, OPT_TIME_LIMIT},
+                               {"mrc", no_argument, nullptr, OPT_MRC},
+                               {"mrc-scale", required_argument, nullptr, OPT_MRC_SCALE},
 
                                // Toggles
                                {"do-gaussian", no_argument, nullptr, OPT_DO_GAUSSIAN},
@@ -230,6 +629,32 @@ int main(int argc, char* argv[])
                                {"sauvola-window", required_argument, nullptr, OPT_SAUVOLA_WINDOW},
                                {"sauvola-k", required_argument, nullptr, OPT_SAUVOLA_K},
                                {"sauvola-delta", required_argument, nullptr, OPT_SAUVOLA_DELTA},
+                               {"niblack-k", required_argument, nullptr, OPT_NIBLACK_K},
+                               {"wolf-k", required_argument, nullptr, OPT_WOLF_K},
+                               {"phansalkar-k", required_argument, nullptr, OPT_PHANSALKAR_K},
+                               {"nick-k", required_argument, nullptr, OPT_NICK_K},
+                               {"otsu-tile-size", required_argument, nullptr, OPT_OTSU_TILE_SIZE},
+                               {"otsu-thresholds", required_argument, nullptr, OPT_OTSU_THRESHOLDS},
+                               {"threshold-scale", required_argument, nullptr, OPT_THRESHOLD_SCALE},
+                               {"do-dpi-normalization", no_argument, nullptr, OPT_DO_DPI_NORMALIZATION},
+                               {"target-dpi", required_argument, nullptr, OPT_TARGET_DPI},
+                               {"do-auto-crop", no_argument, nullptr, OPT_DO_AUTO_CROP},
+                               {"crop-paste-back", no_argument, nullptr, OPT_CROP_PASTE_BACK},
+                               {"do-orientation", no_argument, nullptr, OPT_DO_ORIENTATION},
+                               {"skew-method", required_argument, nullptr, OPT_SKEW_METHOD},
+                               {"deskew-search", required_argument, nullptr, OPT_DESKEW_SEARCH},
+                               {"deskew-early-exit", required_argument, nullptr, OPT_DESKEW_EARLY_EXIT},
+                               {"deskew-max-evals", required_argument, nullptr, OPT_DESKEW_MAX_EVALS},
+                               {"do-background-flattening", no_argument, nullptr, OPT_DO_BACKGROUND_FLATTENING},
+                               {"background-window", required_argument, nullptr, OPT_BACKGROUND_WINDOW},
+                               {"do-clahe", no_argument, nullptr, OPT_DO_CLAHE},
+                               {"clahe-tile-size", required_argument, nullptr, OPT_CLAHE_TILE_SIZE},
+                               {"clahe-clip-limit", required_argument, nullptr, OPT_CLAHE_CLIP_LIMIT},
+                               {"do-auto-polarity", no_argument, nullptr, OPT_DO_AUTO_POLARITY},
+                               {"do-line-removal", no_argument, nullptr, OPT_DO_LINE_REMOVAL},
+                               {"line-min-length", required_argument, nullptr, OPT_LINE_MIN_LENGTH},
+                               {"report-fmeasure", no_argument, nullptr, OPT_REPORT_FMEASURE},
+                               {"sweep", required_argument, nullptr, OPT_SWEEP},
 
                                {nullptr, 0, nullptr, 0}};
 
@@ -264,97 +689,15 @@ int main(int argc, char* argv[])
         case OPT_TIME_LIMIT:
             time_limit_min = (int)parse_uint(optarg, "--time-limit");
             break;
-        case OPT_DO_GAUSSIAN:
-            opt.do_gaussian_blur = true;
-            break;
-        case OPT_DO_MEDIAN:
-            opt.do_median_blur = true;
-            break;
-        case OPT_DO_ADAPTIVE_MEDIAN:
-            opt.do_adaptive_median = true;
-            break;
-        case OPT_DO_ADAPTIVE_GAUSSIAN:
-            opt.do_adaptive_gaussian_blur = true;
-            break;
-        case OPT_DO_EROSION:
-            opt.do_erosion = true;
-            break;
-        case OPT_DO_DILATION:
-            opt.do_dilation = true;
-            break;
-        case OPT_DO_DESPECKLE:
-            opt.do_despeckle = true;
-            break;
-        case OPT_DO_DESKEW:
-            opt.do_deskew = true;
-            break;
-        case OPT_DO_COLOR_PASS:
-            opt.do_color_pass = true;
-            break;
-        case OPT_BINARIZATION_METHOD:
-            {
-                std::string method = optarg;
-                for (auto &c : method)
-                    c = tolower(c);
-
-                if (method == "otsu")
-                    opt.binarization_method = ite::BinarizationMethod::Otsu;
-                else if (method == "sauvola")
-                    opt.binarization_method = ite::BinarizationMethod::Sauvola;
-                else if (method == "bataineh")
-                    opt.binarization_method = ite::BinarizationMethod::Bataineh;
-                else
-                    die_usage("Unknown binarization method: " + method + " (allowed: otsu, sauvola, bataineh)");
-                break;
-            }
-        case OPT_SIGMA:
-            opt.sigma = parse_float(optarg, "--sigma");
-            require_positive_f("--sigma", opt.sigma);
-            break;
-        case OPT_SIGMA_LOW:
-            opt.adaptive_sigma_low = parse_float(optarg, "--sigma-low");
-            require_positive_f("--sigma-low", opt.adaptive_sigma_low);
-            break;
-        case OPT_SIGMA_HIGH:
-            opt.adaptive_sigma_high = parse_float(optarg, "--sigma-high");
-            require_positive_f("--sigma-high", opt.adaptive_sigma_high);
-            break;
-        case OPT_EDGE_THRESH:
-            opt.adaptive_edge_thresh = parse_float(optarg, "--edge-thresh");
-            break;
-        case OPT_MEDIAN_SIZE:
-            opt.median_kernel_size = (int)parse_uint(optarg, "--median-size");
-            require_positive("--median-size", opt.median_kernel_size);
-            break;
-        case OPT_MEDIAN_THRESH:
-            opt.median_threshold = (int)parse_uint(optarg, "--median-thresh");
-            break;
-        case OPT_ADAPTIVE_MEDIAN_MAX:
-            opt.adaptive_median_max_window = (int)parse_uint(optarg, "--adaptive-median-max");
-            require_positive("--adaptive-median-max", opt.adaptive_median_max_window);
-            if ((opt.adaptive_median_max_window % 2) == 0)
-                die_usage("--adaptive-median-max must be odd");
-            if (opt.adaptive_median_max_window < 3)
-                die_usage("--adaptive-median-max must be >= 3");
-            break;
-        case OPT_KERNEL_SIZE:
-            opt.kernel_size = (int)parse_uint(optarg, "--kernel-size");
-            require_positive("--kernel-size", opt.kernel_size);
-            break;
-        case OPT_DESPECKLE_THRESH:
-            opt.despeckle_threshold = (int)parse_uint(optarg, "--despeckle-thresh");
-            require_non_negative("--despeckle-thresh", opt.despeckle_threshold);
+        case OPT_REPORT_FMEASURE:
+            report_fmeasure = true;
             break;
-        case OPT_SAUVOLA_WINDOW:
-            opt.sauvola_window_size = (int)parse_uint(optarg, "--sauvola-window");
-            require_positive("--sauvola-window", opt.sauvola_window_size);
+        case OPT_MRC:
+            mrc_scale = mrc_scale == 0 ? 8 : mrc_scale;
             break;
-        case OPT_SAUVOLA_K:
-            opt.sauvola_k = parse_float(optarg, "--sauvola-k");
-            require_positive_f("--sauvola-k", opt.sauvola_k);
-            break;
-        case OPT_SAUVOLA_DELTA:
-            opt.sauvola_delta = parse_float(optarg, "--sauvola-delta");
+        case OPT_MRC_SCALE:
+            mrc_scale = (int)parse_uint(optarg, "--mrc-scale");
+            require_positive("--mrc-scale", mrc_scale);
             break;
 
         case ':':
@@ -363,8 +706,13 @@ int main(int argc, char* argv[])
         case '?':
             die_usage(std::string("Unknown option"));
             break;
+        case OPT_SWEEP:
+            sweeps.emplace_back(optarg);
+            break;
+
         default:
-            die_usage("Unknown parsing error");
+            if (!apply_enhance_option(c, optarg, option_name(longopts, c).c_str(), opt))
+                die_usage("Unknown parsing error");
         }
     }
 
@@ -374,6 +722,12 @@ int main(int argc, char* argv[])
         return 0;
     }
 
+    std::vector<SweepCombination> sweep_combinations;
+    if (!sweeps.empty())
+    {
+        sweep_combinations = expand_sweeps(opt, sweeps, longopts);
+    }
+
     try
     {
         std::cout << "Loading: " << input_path << std::endl;
@@ -388,6 +742,46 @@ int main(int argc, char* argv[])
         {
             std::cout << "[INFO] Input image is grayscale (1 channel). Disabling --do-color-pass." << std::endl;
             opt.do_color_pass = false;
+            for (auto &combination : sweep_combinations)
+                combination.options.do_color_pass = false;
+        }
+
+        // --- SWEEP: all combinations in one process, sharing the common pipeline prefix ---
+        if (!sweep_combinations.empty())
+        {
+            std::vector<ite::EnhanceOptions> combinations;
+            for (const auto &combination : sweep_combinations)
+                combinations.push_back(combination.options);
+
+            std::cout << "Sweeping " << combinations.size() << " combination(s)..." << std::endl;
+            ite::TimingLog log;
+            const auto sweep_start = std::chrono::steady_clock::now();
+            ite::enhance_sweep(
+                img, combinations,
+                [&](const size_t index, const CImg<uint> &result)
+                {
+                    const std::string path = save_result(result, sweep_output_path(output_path, index), mrc_scale);
+                    std::cout << "[" << std::setw(3) << std::setfill('0') << index << std::setfill(' ') << "] " << sweep_combinations[index].label
+                              << " -> " << path << std::endl;
+                },
+                64, measure_time ? &log : nullptr, verbose_log);
+            const auto sweep_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - sweep_start).count();
+            std::cout << "Sweep time: " << std::fixed << std::setprecision(3) << sweep_ms / 1000.0 << " s" << std::endl;
+
+            if (measure_time)
+            {
+                // One row per step over all combinations; cached steps do not run and are not counted
+                std::map<std::string, std::vector<double>> aggregated_data;
+                std::vector<std::string> step_order;
+                for (const auto &entry : log)
+                {
+                    if (aggregated_data.find(entry.name) == aggregated_data.end())
+                        step_order.push_back(entry.name);
+                    aggregated_data[entry.name].push_back(entry.duration_us / 1000.0);
+                }
+                print_benchmark_table(aggregated_data, step_order, static_cast<int>(combinations.size()));
+            }
+            return 0;
         }
 
         // --- WARMUP ---
@@ -492,13 +886,25 @@ int main(int argc, char* argv[])
             std::cerr << std::endl;
         }
 
-        ite::writeimage(result, output_path);
-        std::cout << "Saved: " << output_path << std::endl;
+        std::cout << "Saved: " << save_result(result, output_path, mrc_scale) << std::endl;
 
         if (measure_time)
         {
             print_benchmark_table(aggregated_data, step_order, actual_trials);
         }
+
+        if (report_fmeasure)
+        {
+            // Compare the binarized masks (no color pass) of the configured run and an exact-threshold run
+            ite::EnhanceOptions scaled_opt = opt;
+            scaled_opt.do_color_pass = false;
+            ite::EnhanceOptions exact_opt = scaled_opt;
+            exact_opt.threshold_scale = 1;
+
+            const double f = ite::f_measure(ite::enhance(img, scaled_opt), ite::enhance(img, exact_opt));
+            std::cout << "F-measure vs. full-resolution thresholds: " << std::fixed << std::setprecision(4) << f << " (delta " << (1.0 - f) << ")"
+                      << std::endl;
+        }
     }
     catch (const std::exception &e)
     {
@@ -1,117 +1,925 @@
 #include "binarization.h"
 #include <algorithm>
+#include <array>
 #include <cmath>
 #include <cstdint>
 #include <iostream>
 #include <stdexcept>
+#include <string>
+#include <vector>
+#include "../color/grayscale.h"
+#include "../core/histogram.h"
 #include "../core/integral_image.h"
+#include "../core/local_stats.h"
 
 
 namespace ite::binarization
 {
 
-    void binarize_sauvola(CImg<uint> &input_image, const int window_size, const float k, const float delta)
+    namespace
     {
-        if (input_image.spectrum() != 1)
+        // Long side of the smallest pyramid level Bataineh's global statistics are taken from
+        constexpr int BATAINEH_STATS_LONG_SIDE = 1024;
+
+        /**
+         * @brief (Internal) Global quantities of Bataineh's method (adaptive window size steps 1-3).
+         */
+        struct BatainehParams
+        {
+            double mean_global;
+            double std_dev;
+            double max_intensity;
+            double T_con;
+            double offset;
+            int pw_x_half;
+            int pw_y_half;
+        };
+
+        /**
+         * @param input_image The image to binarize (its size selects the window sizes).
+         * @param stats_image Image the gray-level statistics are taken from: the input itself or a downsampled copy.
+         */
+        BatainehParams bataineh_global_params(const CImg<uint> &input_image, const CImg<uint> &stats_image)
+        {
+            // All global quantities come from one parallel histogram pass over the statistics image
+            const core::Histogram hist = core::compute_histogram(stats_image);
+
+            // set usefull constants
+            const double mean_global = hist.mean();
+            const int img_width = input_image.width();
+            const int img_height = input_image.height();
+
+            // First step: compute Confusion Threshold T_con
+            const double std_dev = std::sqrt(hist.variance());
+            const auto max_intensity = static_cast<double>(hist.max);
+            const double T_con = mean_global - ((mean_global * mean_global * std_dev) / ((mean_global + std_dev) * (0.5 * max_intensity + std_dev)));
+            const double offset = std_dev / 2.0;
+
+            // Second step: classify pixels based on T_con and calculation of
+            // probabilities p (white pixels are not needed)
+            long n_black = 0;
+            long n_red = 0;
+            for (int v = 0; v < 256; ++v)
+            {
+                const auto pixel_value = static_cast<double>(v);
+                if (pixel_value <= T_con - offset)
+                {
+                    n_black += static_cast<long>(hist.bins[v]);
+                }
+                else if (pixel_value < T_con + offset)
+                {
+                    n_red += static_cast<long>(hist.bins[v]);
+                }
+            }
+            if (hist.overflow > 0)
+            {
+                // Values above 255 are not binned: classify them directly
+                const uint* data = stats_image.data();
+                const long long n = static_cast<long long>(stats_image.size());
+#pragma omp parallel for reduction(+ : n_black, n_red)
+                for (long long i = 0; i < n; ++i)
+                {
+                    if (data[i] < 256u)
+                        continue;
+                    const double pixel_value = data[i];
+                    n_black += (pixel_value <= T_con - offset);
+                    n_red += (pixel_value > T_con - offset && pixel_value < T_con + offset);
+                }
+            }
+
+            double p = (n_red == 0) ? 10.0 : (double)n_black / n_red;
+
+            // Third step: determine primary window size pw_size based on probability p
+            // pw_size = [pw_size_x, pw_size_y]
+            int pw_size[2];
+            if (p >= 2.5 || (std_dev < 0.1 * max_intensity)) // large text size, low contact images
+            {
+                pw_size[0] = img_width / 6; // 6
+                pw_size[1] = img_height / 4; // 4
+            }
+            else if (1 < p || (img_width + img_height) < 400)
+            { // fine and normal images
+                pw_size[0] = img_width / 30; // 30
+                pw_size[1] = img_height / 20; // 20
+            }
+            else
+            { // very fine text size, high contact images
+                pw_size[0] = img_width / 40; // 40
+                pw_size[1] = img_height / 30; // 30
+            }
+
+            // check if window sizes are odd numbers, if not make them odd
+            if (pw_size[0] % 2 == 0)
+            {
+                pw_size[0]++;
+            }
+            if (pw_size[1] % 2 == 0)
+            {
+                pw_size[1]++;
+            }
+
+            return {mean_global, std_dev, max_intensity, T_con, offset, pw_size[0] / 2, pw_size[1] / 2};
+        }
+
+        /**
+         * @brief (Internal) Bataineh's per-pixel threshold from the final window statistics.
+         */
+        double bataineh_threshold(const double mean_window_val, const double std_dev_window_val, const double mean_global, const double min_std_dev,
+                                  const double std_dev_range)
         {
-            throw std::runtime_error("Sauvola requires a grayscale image.");
+            // not part of Bataineh's method, but needed for fourther adjusting
+            // threshold
+            double k = 1.0;
+            if (std_dev_window_val < 5.0)
+            {
+                k = 1.4;
+            }
+            else if (std_dev_window_val > 30.0)
+            {
+                k = 0.8;
+            }
+
+            // Calculate adaptive threshold
+            double std_dev_adaptive = (std_dev_window_val - min_std_dev) / std_dev_range;
+
+            // define threshold based on adaptive std deviation
+            return mean_window_val -
+                k *
+                    (((mean_window_val * mean_window_val) - std_dev_window_val) /
+                     ((mean_global + std_dev_window_val) * (std_dev_adaptive + std_dev_window_val)));
         }
 
-        CImg<double> img_double = input_image; // Convert CImg<uint> to CImg<double>
+        // Resolution of the per-pixel window statistics Bataineh keeps between its two phases
+        constexpr double STATS_FIXED_POINT = 256.0;
 
-        CImg<double> integral_img = core::calculate_integral_image(img_double);
-        CImg<double> integral_sq_img = core::calculate_integral_image(img_double.get_sqr()); // Integral of (pixel*pixel)
+        uint16_t to_stats_fixed(const double value) { return static_cast<uint16_t>(std::clamp(value * STATS_FIXED_POINT + 0.5, 0.0, 65535.0)); }
 
-        CImg<uint> output_image(input_image.width(), input_image.height(), input_image.depth(), 1);
-        const float R = 128.0f; // Max std. dev (for normalization)
-        const int w_half = window_size / 2;
+        double from_stats_fixed(const uint16_t value) { return value / STATS_FIXED_POINT; }
+
+        /**
+         * @brief (Internal) Integral image of +1 per red and -1 per black pixel of Bataineh's classification.
+         */
+        CImg<int32_t> class_balance_integral(const CImg<uint> &image, const double T_con, const double offset)
+        {
+            const int w = image.width();
+            const int h = image.height();
+            const int d = image.depth();
+            CImg<int32_t> integral(w, h, d, 1);
+
+            // Row prefix sums
+#pragma omp parallel for collapse(2) schedule(static)
+            for (int z = 0; z < d; ++z)
+            {
+                for (int y = 0; y < h; ++y)
+                {
+                    const uint* src = image.data(0, y, z);
+                    int32_t* dst = integral.data(0, y, z);
+                    int32_t sum = 0;
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const double pixel_value = src[x];
+                        sum += (pixel_value <= T_con - offset) ? -1 : (pixel_value < T_con + offset) ? 1 : 0;
+                        dst[x] = sum;
+                    }
+                }
+            }
+
+            // Column sums, in strips of columns so every thread walks its rows contiguously
+            constexpr int STRIP = 256;
+#pragma omp parallel for collapse(2) schedule(static)
+            for (int z = 0; z < d; ++z)
+            {
+                for (int x0 = 0; x0 < w; x0 += STRIP)
+                {
+                    const int x1 = std::min(w, x0 + STRIP);
+                    for (int y = 1; y < h; ++y)
+                    {
+                        const int32_t* above = integral.data(0, y - 1, z);
+                        int32_t* row = integral.data(0, y, z);
+#pragma omp simd
+                        for (int x = x0; x < x1; ++x)
+                            row[x] += above[x];
+                    }
+                }
+            }
+            return integral;
+        }
+
+        /**
+         * @brief (Internal) Sum of a rectangle (inclusive bounds) of class_balance_integral().
+         */
+        int32_t balance_area_sum(const CImg<int32_t> &integral, const int x1, const int y1, const int z, const int x2, const int y2)
+        {
+            const int32_t a = (x1 > 0 && y1 > 0) ? integral(x1 - 1, y1 - 1, z) : 0;
+            const int32_t b = (y1 > 0) ? integral(x2, y1 - 1, z) : 0;
+            const int32_t c = (x1 > 0) ? integral(x1 - 1, y2, z) : 0;
+            return integral(x2, y2, z) - b - c + a;
+        }
+
+        // ============================================================================
+        // Downsampled threshold surface
+        // ============================================================================
+
+        // Channels of the block statistics grid
+        enum BlockChannel
+        {
+            BLOCK_SUM = 0,
+            BLOCK_SUM_SQ,
+            BLOCK_BLACK,
+            BLOCK_RED,
+            BLOCK_CHANNELS
+        };
+
+        /**
+         * @brief (Internal) Summarizes every scale x scale block of one slice into sums and sums of squares and, if
+         * requested, the number of black/red pixels with respect to [lo, hi] (used by Bataineh's window selection).
+         * @return Integral image over the block grid, one channel per BlockChannel.
+         */
+        CImg<double> block_statistics(const CImg<uint> &image, const int z, const int scale, const bool count_classes, const double lo = 0.0,
+                                      const double hi = 0.0)
+        {
+            const int w = image.width();
+            const int h = image.height();
+            const int gw = (w + scale - 1) / scale;
+            const int gh = (h + scale - 1) / scale;
+
+            CImg<double> blocks(gw, gh, 1, count_classes ? BLOCK_CHANNELS : BLOCK_SUM_SQ + 1, 0.0);
+
+#pragma omp parallel for schedule(static)
+            for (int by = 0; by < gh; ++by)
+            {
+                const int y_end = std::min(h, (by + 1) * scale);
+                for (int bx = 0; bx < gw; ++bx)
+                {
+                    const int x_begin = bx * scale;
+                    const int x_end = std::min(w, x_begin + scale);
+                    uint64_t sum = 0, sum_sq = 0, black = 0, red = 0;
+
+                    for (int y = by * scale; y < y_end; ++y)
+                    {
+                        const uint* row = image.data(0, y, z);
+                        for (int x = x_begin; x < x_end; ++x)
+                        {
+                            const uint64_t v = row[x];
+                            sum += v;
+                            sum_sq += v * v;
+                        }
+                        if (count_classes)
+                        {
+                            for (int x = x_begin; x < x_end; ++x)
+                            {
+                                const double v = row[x];
+                                black += (v <= lo);
+                                red += (v > lo && v < hi);
+                            }
+                        }
+                    }
+
+                    blocks(bx, by, 0, BLOCK_SUM) = static_cast<double>(sum);
+                    blocks(bx, by, 0, BLOCK_SUM_SQ) = static_cast<double>(sum_sq);
+                    if (count_classes)
+                    {
+                        blocks(bx, by, 0, BLOCK_BLACK) = static_cast<double>(black);
+                        blocks(bx, by, 0, BLOCK_RED) = static_cast<double>(red);
+                    }
+                }
+            }
+
+            return core::calculate_integral_image(blocks);
+        }
+
+        /**
+         * @brief (Internal) Number of image pixels covered by the block range [b1, b2] along an axis of the given length.
+         */
+        inline double block_span(const int b1, const int b2, const int scale, const int length)
+        {
+            return static_cast<double>(std::min(length, (b2 + 1) * scale) - b1 * scale);
+        }
+
+        /**
+         * @brief (Internal) Local mean and std. deviation of a block window from the block integral image of a w x h slice.
+         */
+        void block_window_stats(const CImg<double> &integral, const int w, const int h, const int scale, int bx, int by, int rx, int ry, double &mean,
+                                double &std_dev)
+        {
+            const int x1 = std::max(0, bx - rx);
+            const int y1 = std::max(0, by - ry);
+            const int x2 = std::min(integral.width() - 1, bx + rx);
+            const int y2 = std::min(integral.height() - 1, by + ry);
+
+            const double N = block_span(x1, x2, scale, w) * block_span(y1, y2, scale, h);
+            const double sum = core::get_area_sum(integral, x1, y1, 0, BLOCK_SUM, x2, y2);
+            const double sum_sq = core::get_area_sum(integral, x1, y1, 0, BLOCK_SUM_SQ, x2, y2);
+
+            mean = sum / N;
+            std_dev = std::sqrt(std::max(0.0, (sum_sq / N) - (mean * mean)));
+        }
+
+        /**
+         * @brief (Internal) Thresholds one slice against a coarse threshold surface.
+         * Grid node (bx, by) sits at the center of its block; values in between are bilinearly interpolated.
+         * Pixels above the threshold become white, or black if `dark_background` is set.
+         */
+        void apply_threshold_surface(CImg<uint> &image, const int z, const CImg<float> &surface, const int scale, const bool dark_background = false)
+        {
+            const int w = image.width();
+            const int h = image.height();
+            const int gw = surface.width();
+            const int gh = surface.height();
+            const float center = 0.5f * static_cast<float>(scale - 1);
+            const float inv_scale = 1.0f / static_cast<float>(scale);
+
+            // Interpolation position of a pixel coordinate on the grid axis: lower node and weight of the upper one
+            const auto grid_position = [&](const int p, const int nodes, int &node, float &frac)
+            {
+                const float g = std::clamp((static_cast<float>(p) - center) * inv_scale, 0.0f, static_cast<float>(nodes - 1));
+                node = std::min(static_cast<int>(g), std::max(0, nodes - 2));
+                frac = (nodes > 1) ? g - static_cast<float>(node) : 0.0f;
+            };
+
+            // Horizontal interpolation taps are the same for every row
+            std::vector<int> tap_x(w);
+            std::vector<float> frac_x(w);
+            for (int x = 0; x < w; ++x)
+            {
+                grid_position(x, gw, tap_x[x], frac_x[x]);
+            }
+
+#pragma omp parallel
+            {
+                std::vector<float> node_threshold(gw + 1);
+                std::vector<float> threshold(w);
+#pragma omp for schedule(static)
+                for (int y = 0; y < h; ++y)
+                {
+                    int y0;
+                    float fy;
+                    grid_position(y, gh, y0, fy);
+                    const int y1 = std::min(y0 + 1, gh - 1);
+
+                    // Vertical interpolation once per grid column, horizontal once per pixel
+                    const float* s0 = surface.data(0, y0);
+                    const float* s1 = surface.data(0, y1);
+                    for (int bx = 0; bx < gw; ++bx)
+                    {
+                        node_threshold[bx] = s0[bx] + fy * (s1[bx] - s0[bx]);
+                    }
+                    node_threshold[gw] = node_threshold[gw - 1];
+
+                    for (int x = 0; x < w; ++x)
+                    {
+                        const float t0 = node_threshold[tap_x[x]];
+                        threshold[x] = t0 + frac_x[x] * (node_threshold[tap_x[x] + 1] - t0);
+                    }
+
+                    // Branch-free compare over contiguous rows
+                    uint* row = image.data(0, y, z);
+                    const float* t = threshold.data();
+                    for (int x = 0; x < w; ++x)
+                    {
+                        row[x] = ((static_cast<float>(row[x]) > t[x]) != dark_background) ? 255u : 0u;
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief (Internal) Clamps a requested threshold scale to the supported 1..8 range.
+         */
+        int normalize_threshold_scale(const int threshold_scale) { return std::clamp(threshold_scale, 1, 8); }
+
+        void binarize_sauvola_scaled(CImg<uint> &input_image, const int window_size, const float k, const float delta, const int scale)
+        {
+            const double R = 128.0; // Max std. dev (for normalization)
+            const int r_blocks = static_cast<int>(std::lround(static_cast<double>(window_size / 2) / scale));
+
+            for (int z = 0; z < input_image.depth(); ++z)
+            {
+                const CImg<double> integral = block_statistics(input_image, z, scale, false);
+                CImg<float> surface(integral.width(), integral.height(), 1, 1);
+
+#pragma omp parallel for schedule(static)
+                for (int by = 0; by < surface.height(); ++by)
+                {
+                    for (int bx = 0; bx < surface.width(); ++bx)
+                    {
+                        double mean, std_dev;
+                        block_window_stats(integral, input_image.width(), input_image.height(), scale, bx, by, r_blocks, r_blocks, mean, std_dev);
+                        surface(bx, by) = static_cast<float>(mean * (1.0 + k * ((std_dev / R) - 1.0)) - delta);
+                    }
+                }
+
+                apply_threshold_surface(input_image, z, surface, scale);
+            }
+        }
+
+        void binarize_bataineh_scaled(CImg<uint> &input_image, const BatainehParams &params, const int scale)
+        {
+            // Window radii expressed in blocks; the counting window of the full-resolution path is the primary window
+            const int rx = static_cast<int>(std::lround(static_cast<double>(params.pw_x_half) / scale));
+            const int ry = static_cast<int>(std::lround(static_cast<double>(params.pw_y_half) / scale));
+            const int rx_sub = static_cast<int>(std::lround(static_cast<double>(params.pw_x_half / 2) / scale));
+            const int ry_sub = static_cast<int>(std::lround(static_cast<double>(params.pw_y_half / 2) / scale));
+
+            std::vector<CImg<double>> integrals;
+            double min_std_dev = 255.0;
+            double max_std_dev = 0.0;
+
+            // 1. Local std. deviation of the primary window at every grid node -> global min and max
+            for (int z = 0; z < input_image.depth(); ++z)
+            {
+                integrals.push_back(block_statistics(input_image, z, scale, true, params.T_con - params.offset, params.T_con + params.offset));
+                const CImg<double> &integral = integrals.back();
+
+#pragma omp parallel for collapse(2) reduction(min : min_std_dev) reduction(max : max_std_dev)
+                for (int by = 0; by < integral.height(); ++by)
+                {
+                    for (int bx = 0; bx < integral.width(); ++bx)
+                    {
+                        double mean, std_dev;
+                        block_window_stats(integral, input_image.width(), input_image.height(), scale, bx, by, rx, ry, mean, std_dev);
+                        min_std_dev = std::min(min_std_dev, std_dev);
+                        max_std_dev = std::max(max_std_dev, std_dev);
+                    }
+                }
+            }
+
+            const double std_dev_range = (max_std_dev - min_std_dev) > 1e-5 ? (max_std_dev - min_std_dev) : 1e-5;
+            const auto max_threshold = static_cast<float>(params.max_intensity + 1.0);
+
+            // 2. Threshold at every grid node with the final (possibly halved) window
+            for (int z = 0; z < input_image.depth(); ++z)
+            {
+                const CImg<double> &integral = integrals[z];
+                CImg<float> surface(integral.width(), integral.height(), 1, 1);
 
 #pragma omp parallel for collapse(2)
-        for (int z = 0; z < input_image.depth(); ++z)
+                for (int by = 0; by < surface.height(); ++by)
+                {
+                    for (int bx = 0; bx < surface.width(); ++bx)
+                    {
+                        const int x1 = std::max(0, bx - rx), x2 = std::min(surface.width() - 1, bx + rx);
+                        const int y1 = std::max(0, by - ry), y2 = std::min(surface.height() - 1, by + ry);
+                        const double n_w_black = core::get_area_sum(integral, x1, y1, 0, BLOCK_BLACK, x2, y2);
+                        const double n_w_red = core::get_area_sum(integral, x1, y1, 0, BLOCK_RED, x2, y2);
+                        const bool use_sub_window = (n_w_red > n_w_black);
+
+                        double mean, std_dev;
+                        block_window_stats(integral, input_image.width(), input_image.height(), scale, bx, by, use_sub_window ? rx_sub : rx,
+                                           use_sub_window ? ry_sub : ry, mean, std_dev);
+                        const double threshold = bataineh_threshold(mean, std_dev, params.mean_global, min_std_dev, std_dev_range);
+
+                        // Flat windows divide by zero (+-inf or NaN); pin them just outside the value range so the
+                        // decision is unchanged but the bilinear interpolation stays finite.
+                        surface(bx, by) =
+                            std::isnan(threshold) ? max_threshold : static_cast<float>(std::clamp(threshold, -1.0, static_cast<double>(max_threshold)));
+                    }
+                }
+
+                apply_threshold_surface(input_image, z, surface, scale);
+            }
+        }
+
+        /**
+         * @brief (Internal) Local thresholding on the shared O(1)-per-pixel mean/std. deviation core.
+         * `threshold_of(mean, std_dev)` gives the threshold of a pixel; pixels above it become white (255).
+         */
+        template <typename ThresholdFn>
+        void binarize_local(CImg<uint> &input_image, const int window_size, const ThresholdFn &threshold_of)
         {
-            for (int y = 0; y < input_image.height(); ++y)
+            CImg<uint> output_image(input_image.width(), input_image.height(), input_image.depth(), 1);
+            const int w_half = window_size / 2;
+
+            const core::LocalStats stats(input_image, {{w_half, w_half}});
+            stats.for_each_row(
+                [&](const int y, const int z, const int, const core::LocalStatsRow* rows)
+                {
+                    const uint* in = input_image.data(0, y, z);
+                    uint* out = output_image.data(0, y, z);
+                    const double* mean = rows[0].mean;
+                    const double* std_dev = rows[0].std_dev;
+                    for (int x = 0; x < input_image.width(); ++x)
+                    {
+                        out[x] = (in[x] > threshold_of(mean[x], std_dev[x])) * 255;
+                    }
+                });
+
+            input_image.swap(output_image);
+        }
+
+        /**
+         * @brief (Internal) Rejects non-grayscale input of the local methods.
+         */
+        void require_grayscale(const CImg<uint> &input_image, const char* method)
+        {
+            if (input_image.spectrum() != 1)
             {
-                for (int x = 0; x < input_image.width(); ++x)
+                throw std::runtime_error(std::string(method) + " requires a grayscale image.");
+            }
+        }
+
+        /**
+         * @brief (Internal) Result of Otsu's criterion on a histogram.
+         */
+        struct OtsuSplit
+        {
+            int threshold; ///< Last gray value of the dark class
+            double dark_mean; ///< Mean of the dark class (equal to light_mean if there is only one class)
+            double light_mean; ///< Mean of the light class
+        };
+
+        /**
+         * @brief (Internal) Otsu's threshold of a 256-bin histogram holding `n` samples.
+         */
+        template <typename Count>
+        OtsuSplit otsu_split(const Count* hist, const uint64_t n)
+        {
+            double sum_all = 0.0;
+            for (int t = 0; t < 256; ++t)
+                sum_all += static_cast<double>(t) * static_cast<double>(hist[t]);
+
+            double sum_b = 0.0;
+            uint64_t w_b = 0;
+            uint64_t w_f = 0;
+
+            const double mean = n > 0 ? sum_all / static_cast<double>(n) : 0.0;
+            double max_between = -1.0;
+            OtsuSplit best{128, mean, mean};
+
+            for (int t = 0; t < 256; ++t)
+            {
+                w_b += hist[t];
+                if (w_b == 0)
+                    continue;
+
+                w_f = n - w_b;
+                if (w_f == 0)
+                    break;
+
+                sum_b += static_cast<double>(t) * static_cast<double>(hist[t]);
+
+                const double m_b = sum_b / static_cast<double>(w_b);
+                const double m_f = (sum_all - sum_b) / static_cast<double>(w_f);
+
+                const double between = static_cast<double>(w_b) * static_cast<double>(w_f) * (m_b - m_f) * (m_b - m_f);
+                if (between > max_between)
                 {
-                    // Define the local window (clamp to edges)
-                    const int x1 = std::max(0, x - w_half);
-                    const int y1 = std::max(0, y - w_half);
-                    const int x2 = std::min(input_image.width() - 1, x + w_half);
-                    const int y2 = std::min(input_image.height() - 1, y + w_half);
+                    max_between = between;
+                    best = {t, m_b, m_f};
+                }
+            }
+            return best;
+        }
+
+        /**
+         * @brief (Internal) 256-bin histogram for Otsu from one parallel pass over the native buffer (values above 255 count as 255).
+         */
+        std::array<uint64_t, 256> otsu_histogram(const CImg<uint> &gray)
+        {
+            core::Histogram hist = core::compute_histogram(gray);
+            hist.bins[255] += hist.overflow;
+            return hist.bins;
+        }
+
+        // Tiles whose two Otsu classes are closer than this (in gray levels) hold no usable edge, e.g. plain background
+        constexpr double MIN_TILE_CLASS_GAP = 15.0;
+
+        // Polarity detection: long side of the strided proxy, and the share of the variance the two Otsu classes must explain
+        constexpr int POLARITY_PROXY_LONG_SIDE = 512;
+        constexpr double MIN_POLARITY_SEPARABILITY = 0.5;
+
+        /**
+         * @brief (Internal) Otsu with one threshold per tile_size x tile_size tile.
+         * Tiles without a usable split inherit the thresholds of their neighbours (or the global threshold),
+         * the threshold grid is smoothed with a 3x3 average and bilinearly interpolated per pixel.
+         */
+        void binarize_otsu_tiled(CImg<uint> &input_image, const int tile_size, const bool dark_background)
+        {
+            const int w = input_image.width();
+            const int h = input_image.height();
+            const int gw = (w + tile_size - 1) / tile_size;
+            const int gh = (h + tile_size - 1) / tile_size;
 
-                    const double N = (x2 - x1 + 1) * (y2 - y1 + 1); // Number of pixels in window
+            for (int z = 0; z < input_image.depth(); ++z)
+            {
+                // 1. Tile histograms, one tile row per task (values above 255 count as 255)
+                std::vector<uint32_t> hist(static_cast<size_t>(gw) * gh * 256, 0);
+#pragma omp parallel for schedule(static)
+                for (int by = 0; by < gh; ++by)
+                {
+                    const int y_end = std::min(h, (by + 1) * tile_size);
+                    for (int y = by * tile_size; y < y_end; ++y)
+                    {
+                        const uint* row = input_image.data(0, y, z);
+                        for (int bx = 0; bx < gw; ++bx)
+                        {
+                            uint32_t* tile_hist = hist.data() + (static_cast<size_t>(by) * gw + bx) * 256;
+                            const int x_end = std::min(w, (bx + 1) * tile_size);
+                            for (int x = bx * tile_size; x < x_end; ++x)
+                                ++tile_hist[std::min(row[x], 255u)];
+                        }
+                    }
+                }
 
-                    // Get sum and sum of squares from integral images
-                    const double sum = core::get_area_sum(integral_img, x1, y1, z, 0, x2, y2);
-                    const double sum_sq = core::get_area_sum(integral_sq_img, x1, y1, z, 0, x2, y2);
+                // 2. Per-tile thresholds; the sum of all tiles gives the global fallback
+                std::vector<uint64_t> global_hist(256, 0);
+                for (size_t i = 0; i < hist.size(); ++i)
+                    global_hist[i % 256] += hist[i];
+                const double global_threshold = otsu_split(global_hist.data(), static_cast<uint64_t>(w) * h).threshold;
 
-                    // Calculate local mean and std. deviation
-                    const double mean = sum / N;
-                    const double std_dev = std::sqrt(std::max(0.0, (sum_sq / N) - (mean * mean)));
+                CImg<float> thresholds(gw, gh, 1, 1, 0.0f);
+                CImg<unsigned char> known(gw, gh, 1, 1, 0);
+#pragma omp parallel for collapse(2)
+                for (int by = 0; by < gh; ++by)
+                {
+                    for (int bx = 0; bx < gw; ++bx)
+                    {
+                        const uint64_t n = static_cast<uint64_t>(std::min(w, (bx + 1) * tile_size) - bx * tile_size) *
+                                           static_cast<uint64_t>(std::min(h, (by + 1) * tile_size) - by * tile_size);
+                        const OtsuSplit split = otsu_split(hist.data() + (static_cast<size_t>(by) * gw + bx) * 256, n);
+                        if (split.light_mean - split.dark_mean >= MIN_TILE_CLASS_GAP)
+                        {
+                            // The criterion is flat across an empty gap between the classes, so the split is centered
+                            // between the class means rather than placed at the end of the dark class
+                            thresholds(bx, by) = static_cast<float>(0.5 * (split.dark_mean + split.light_mean));
+                            known(bx, by) = 1;
+                        }
+                    }
+                }
 
-                    // Calculate Sauvola's threshold
-                    const double threshold = mean * (1.0 + k * ((std_dev / R) - 1.0)) - delta;
+                // 3. Fill tiles without a usable split from their known 8-neighbours, ring by ring
+                bool any_known = known.max() > 0;
+                while (any_known && known.min() == 0)
+                {
+                    const CImg<float> previous = thresholds;
+                    const CImg<unsigned char> previous_known = known;
+                    cimg_forXY(thresholds, bx, by)
+                    {
+                        if (previous_known(bx, by))
+                            continue;
+                        double sum = 0.0;
+                        int count = 0;
+                        for (int dy = -1; dy <= 1; ++dy)
+                        {
+                            for (int dx = -1; dx <= 1; ++dx)
+                            {
+                                const int nx = bx + dx, ny = by + dy;
+                                if (nx >= 0 && nx < gw && ny >= 0 && ny < gh && previous_known(nx, ny))
+                                {
+                                    sum += previous(nx, ny);
+                                    ++count;
+                                }
+                            }
+                        }
+                        if (count > 0)
+                        {
+                            thresholds(bx, by) = static_cast<float>(sum / count);
+                            known(bx, by) = 1;
+                        }
+                    }
+                }
+                if (!any_known)
+                {
+                    thresholds.fill(static_cast<float>(global_threshold));
+                }
 
-                    // Apply threshold
-                    output_image(x, y, z) = (input_image(x, y, z) > threshold) * 255;
+                // 4. Smooth between neighbouring tiles (3x3 average, clipped at the grid border)
+                const CImg<float> raw = thresholds;
+                cimg_forXY(thresholds, bx, by)
+                {
+                    double sum = 0.0;
+                    int count = 0;
+                    for (int ny = std::max(0, by - 1); ny <= std::min(gh - 1, by + 1); ++ny)
+                    {
+                        for (int nx = std::max(0, bx - 1); nx <= std::min(gw - 1, bx + 1); ++nx)
+                        {
+                            sum += raw(nx, ny);
+                            ++count;
+                        }
+                    }
+                    thresholds(bx, by) = static_cast<float>(sum / count);
                 }
+
+                // 5. Per-pixel bilinear interpolation; gray values <= threshold belong to the dark class
+                apply_threshold_surface(input_image, z, thresholds, tile_size, dark_background);
             }
         }
+    } // namespace
 
-        input_image = output_image;
+    void binarize_sauvola(CImg<uint> &input_image, const int window_size, const float k, const float delta, const int threshold_scale)
+    {
+        require_grayscale(input_image, "Sauvola");
+        if (input_image.is_empty())
+        {
+            return;
+        }
+
+        const int scale = normalize_threshold_scale(threshold_scale);
+        if (scale > 1)
+        {
+            binarize_sauvola_scaled(input_image, window_size, k, delta, scale);
+            return;
+        }
+
+        // Local mean and std. deviation are streamed row by row (exact integer sums, O(1) per pixel)
+        const double R = 128.0; // Max std. dev (for normalization)
+        binarize_local(input_image, window_size,
+                       [&](const double mean, const double std_dev)
+                       {
+                           // Calculate Sauvola's threshold
+                           return mean * (1.0 + k * ((std_dev / R) - 1.0)) - delta;
+                       });
     }
 
-    int compute_otsu_threshold(const CImg<unsigned char> &g)
+    void binarize_niblack(CImg<uint> &input_image, const int window_size, const float k)
     {
-        int hist[256] = {0};
-        const int W = g.width(), H = g.height();
-        const int N = W * H;
-        if (N <= 0)
-            return 128;
+        require_grayscale(input_image, "Niblack");
+        if (input_image.is_empty())
+        {
+            return;
+        }
 
-        const unsigned char* p = g.data();
-        for (int i = 0; i < N; ++i)
-            ++hist[p[i]];
+        // T = m + k * s
+        binarize_local(input_image, window_size, [&](const double mean, const double std_dev) { return mean + k * std_dev; });
+    }
 
-        double sum_all = 0.0;
-        for (int t = 0; t < 256; ++t)
-            sum_all += static_cast<double>(t) * static_cast<double>(hist[t]);
+    void binarize_wolf(CImg<uint> &input_image, const int window_size, const float k)
+    {
+        require_grayscale(input_image, "Wolf-Jolion");
+        if (input_image.is_empty())
+        {
+            return;
+        }
 
-        double sum_b = 0.0;
-        int w_b = 0;
-        int w_f = 0;
+        // One sweep: keep mean and std. deviation of every window and reduce the global quantities,
+        // the darkest gray value M and the largest local std. deviation R
+        const int w = input_image.width();
+        const int h = input_image.height();
+        const int w_half = window_size / 2;
+        CImg<float> window_stats(w, h, input_image.depth(), 2); // channel 0: mean, channel 1: std. deviation
+        std::vector<double> row_max_std_dev(static_cast<size_t>(input_image.depth()) * h);
+        std::vector<uint> row_min_gray(row_max_std_dev.size());
 
-        double max_between = -1.0;
-        int best_t = 128;
+        core::LocalStats(input_image, {{w_half, w_half}})
+            .for_each_row(
+                [&](const int y, const int z, const int, const core::LocalStatsRow* rows)
+                {
+                    const uint* in = input_image.data(0, y, z);
+                    row_max_std_dev[static_cast<size_t>(z) * h + y] = *std::max_element(rows[0].std_dev, rows[0].std_dev + w);
+                    row_min_gray[static_cast<size_t>(z) * h + y] = *std::min_element(in, in + w);
 
-        for (int t = 0; t < 256; ++t)
+                    float* mean_out = window_stats.data(0, y, z, 0);
+                    float* std_dev_out = window_stats.data(0, y, z, 1);
+                    for (int x = 0; x < w; ++x)
+                    {
+                        mean_out[x] = static_cast<float>(rows[0].mean[x]);
+                        std_dev_out[x] = static_cast<float>(rows[0].std_dev[x]);
+                    }
+                });
+
+        const auto R = static_cast<float>(std::max(1e-5, *std::max_element(row_max_std_dev.begin(), row_max_std_dev.end())));
+        const auto M = static_cast<float>(*std::min_element(row_min_gray.begin(), row_min_gray.end()));
+
+        // T = (1 - k) * m + k * M + k * (s / R) * (m - M), evaluated in place
+#pragma omp parallel for collapse(2)
+        for (int z = 0; z < input_image.depth(); ++z)
         {
-            w_b += hist[t];
-            if (w_b == 0)
-                continue;
+            for (int y = 0; y < h; ++y)
+            {
+                const float* mean = window_stats.data(0, y, z, 0);
+                const float* std_dev = window_stats.data(0, y, z, 1);
+                uint* row = input_image.data(0, y, z);
+                for (int x = 0; x < w; ++x)
+                {
+                    const float threshold = (1.0f - k) * mean[x] + k * M + k * (std_dev[x] / R) * (mean[x] - M);
+                    row[x] = (static_cast<float>(row[x]) > threshold) ? 255u : 0u;
+                }
+            }
+        }
+    }
 
-            w_f = N - w_b;
-            if (w_f == 0)
-                break;
+    void binarize_phansalkar(CImg<uint> &input_image, const int window_size, const float k)
+    {
+        require_grayscale(input_image, "Phansalkar");
+        if (input_image.is_empty())
+        {
+            return;
+        }
 
-            sum_b += static_cast<double>(t) * static_cast<double>(hist[t]);
+        // T = m * (1 + p * exp(-q * m) + k * (s / R - 1)) on intensities normalized to [0, 1]
+        // The exponential term only depends on the mean: tabulate it at 1/16 gray level steps and interpolate
+        // linearly (the threshold error stays below 1e-3 gray levels)
+        const double p = 2.0;
+        const double q = 10.0;
+        const double R = 0.5;
+        const double inv_max = 1.0 / 255.0;
+        constexpr int steps_per_level = 16;
+        std::vector<double> exp_term(256 * steps_per_level + 2);
+        for (size_t i = 0; i < exp_term.size(); ++i)
+        {
+            exp_term[i] = p * std::exp(-q * (static_cast<double>(i) / steps_per_level) * inv_max);
+        }
 
-            const double m_b = sum_b / static_cast<double>(w_b);
-            const double m_f = (sum_all - sum_b) / static_cast<double>(w_f);
+        binarize_local(input_image, window_size,
+                       [&](const double mean, const double std_dev)
+                       {
+                           const double pos = std::min(mean, 255.0) * steps_per_level;
+                           const auto i = static_cast<size_t>(pos);
+                           const double e = exp_term[i] + (pos - static_cast<double>(i)) * (exp_term[i + 1] - exp_term[i]);
+                           return mean * (1.0 + e + k * ((std_dev * inv_max) / R - 1.0));
+                       });
+    }
 
-            const double between = static_cast<double>(w_b) * static_cast<double>(w_f) * (m_b - m_f) * (m_b - m_f);
-            if (between > max_between)
+    void binarize_nick(CImg<uint> &input_image, const int window_size, const float k)
+    {
+        require_grayscale(input_image, "NICK");
+        if (input_image.is_empty())
+        {
+            return;
+        }
+
+        // T = m + k * sqrt(sum(p^2) / N), i.e. the std. deviation shifted by the mean: m + k * sqrt(s^2 + m^2)
+        binarize_local(input_image, window_size,
+                       [&](const double mean, const double std_dev) { return mean + k * std::sqrt(std_dev * std_dev + mean * mean); });
+    }
+
+    int compute_otsu_threshold(const CImg<uint> &gray)
+    {
+        if (gray.is_empty())
+            return 128;
+
+        const std::array<uint64_t, 256> hist = otsu_histogram(gray);
+        return otsu_split(hist.data(), static_cast<uint64_t>(gray.size())).threshold;
+    }
+
+    std::vector<int> compute_otsu_thresholds(const CImg<uint> &gray, const int count)
+    {
+        if (count < 1 || count > 3)
+        {
+            throw std::invalid_argument("Multi-level Otsu supports 1 to 3 thresholds.");
+        }
+        if (count == 1)
+            return {compute_otsu_threshold(gray)};
+        if (gray.is_empty())
+            return std::vector<int>(count, 128);
+
+        // Prefix sums of the counts and gray sums, so the term of any bin range is O(1)
+        const std::array<uint64_t, 256> hist = otsu_histogram(gray);
+        std::array<double, 257> prefix_n{}, prefix_s{};
+        for (int t = 0; t < 256; ++t)
+        {
+            prefix_n[t + 1] = prefix_n[t] + static_cast<double>(hist[t]);
+            prefix_s[t + 1] = prefix_s[t] + static_cast<double>(t) * static_cast<double>(hist[t]);
+        }
+        // Class of bins [a, b]: its share of the between-class variance, up to constants, is S^2 / N
+        auto term = [&](const int a, const int b)
+        {
+            const double n = prefix_n[b + 1] - prefix_n[a];
+            const double s = prefix_s[b + 1] - prefix_s[a];
+            return n > 0.0 ? s * s / n : 0.0;
+        };
+
+        // best[k][b]: best score of splitting bins [0, b] into k + 1 classes; last[k][b]: first bin of the last class
+        const int classes = count + 1;
+        std::vector<std::array<double, 256>> best(classes);
+        std::vector<std::array<int, 256>> last(classes);
+        for (int b = 0; b < 256; ++b)
+        {
+            best[0][b] = term(0, b);
+            last[0][b] = 0;
+        }
+        for (int k = 1; k < classes; ++k)
+        {
+            for (int b = k; b < 256; ++b)
             {
-                max_between = between;
-                best_t = t;
+                best[k][b] = -1.0;
+                for (int a = k; a <= b; ++a)
+                {
+                    const double score = best[k - 1][a - 1] + term(a, b);
+                    if (score > best[k][b])
+                    {
+                        best[k][b] = score;
+                        last[k][b] = a;
+                    }
+                }
             }
         }
-        return best_t;
+
+        // Walk back from the full range; each threshold is the last gray value of a class
+        std::vector<int> thresholds(count);
+        int b = 255;
+        for (int k = classes - 1; k > 0; --k)
+        {
+            const int a = last[k][b];
+            thresholds[k - 1] = a - 1;
+            b = a - 1;
+        }
+        return thresholds;
     }
 
-    double compute_border_mean(const CImg<unsigned char> &g)
+    double compute_border_mean(const CImg<uint> &gray)
     {
-        const int W = g.width(), H = g.height();
+        const int W = gray.width(), H = gray.height();
         if (W <= 0 || H <= 0)
             return 0.0;
 
@@ -120,11 +928,11 @@ namespace ite::binarization
 
         uint64_t sum = 0;
         uint64_t cnt = 0;
-        const unsigned char* p = g.data();
+        const uint* p = gray.data();
 
         auto add = [&](int x, int y)
         {
-            sum += p[y * W + x];
+            sum += std::min(p[y * W + x], 255u);
             ++cnt;
         };
 
@@ -148,19 +956,78 @@ namespace ite::binarization
         return cnt ? static_cast<double>(sum) / static_cast<double>(cnt) : 0.0;
     }
 
-    void binarize_otsu(CImg<uint> &input_image)
+    bool detect_dark_background(const CImg<uint> &image)
+    {
+        if (image.is_empty())
+            return false;
+
+        // Strided luma proxy: only the sampled pixels are read
+        const int step = std::max(1, (std::max(image.width(), image.height()) + POLARITY_PROXY_LONG_SIDE - 1) / POLARITY_PROXY_LONG_SIDE);
+        const int pw = (image.width() + step - 1) / step;
+        const int ph = (image.height() + step - 1) / step;
+        const bool color = image.spectrum() >= 3;
+        CImg<uint> proxy(pw, ph, 1, 1);
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < ph; ++y)
+        {
+            for (int x = 0; x < pw; ++x)
+            {
+                const int sx = x * step, sy = y * step;
+                proxy(x, y) = color ? static_cast<uint>(std::lround(color::WEIGHT_R * image(sx, sy, 0, 0) + color::WEIGHT_G * image(sx, sy, 0, 1) +
+                                                                    color::WEIGHT_B * image(sx, sy, 0, 2)))
+                                    : image(sx, sy);
+            }
+        }
+
+        const std::array<uint64_t, 256> hist = otsu_histogram(proxy);
+        const uint64_t n = proxy.size();
+        const OtsuSplit split = otsu_split(hist.data(), n);
+
+        // Bimodality: share of the variance explained by the two classes (Otsu's separability measure)
+        uint64_t dark = 0;
+        double mean = 0.0, mean_sq = 0.0;
+        for (int v = 0; v < 256; ++v)
+        {
+            dark += v <= split.threshold ? hist[v] : 0;
+            mean += static_cast<double>(v) * hist[v];
+            mean_sq += static_cast<double>(v) * v * hist[v];
+        }
+        mean /= static_cast<double>(n);
+        const double variance = mean_sq / static_cast<double>(n) - mean * mean;
+        const double w_dark = static_cast<double>(dark) / static_cast<double>(n);
+        const double between = w_dark * (1.0 - w_dark) * (split.light_mean - split.dark_mean) * (split.light_mean - split.dark_mean);
+        if (variance <= 0.0 || between < MIN_POLARITY_SEPARABILITY * variance)
+            return false;
+
+        return compute_border_mean(proxy) <= split.threshold && w_dark > 0.5;
+    }
+
+    void binarize_otsu(CImg<uint> &input_image, const int tile_size, const int thresholds)
     {
         if (input_image.spectrum() != 1)
         {
             throw std::runtime_error("Otsu binarization requires a grayscale image.");
         }
+        if (thresholds < 1 || thresholds > 3)
+        {
+            throw std::invalid_argument("Multi-level Otsu supports 1 to 3 thresholds.");
+        }
 
-        // Compute Otsu's threshold and border mean
-        const int threshold = compute_otsu_threshold(input_image);
+        // Compute Otsu's threshold(s) and border mean
+        const std::vector<int> levels = compute_otsu_thresholds(input_image, tile_size > 0 ? 1 : thresholds);
         const double border_mean = compute_border_mean(input_image);
 
-        // Determine if background is light (border mean > threshold) or dark
-        const bool light_background = border_mean > static_cast<double>(threshold);
+        // Determine if background is light (border mean > darkest split) or dark.
+        // The foreground is the darkest class on a light background and the brightest one on a dark background,
+        // intermediate classes (stamps, highlights) go to the background.
+        const bool light_background = border_mean > static_cast<double>(levels.front());
+        const uint threshold = static_cast<uint>(light_background ? levels.front() : levels.back());
+
+        if (tile_size > 0)
+        {
+            binarize_otsu_tiled(input_image, tile_size, !light_background);
+            return;
+        }
 
         // Binarize in-place
 #pragma omp parallel for collapse(3)
@@ -170,7 +1037,7 @@ namespace ite::binarization
             {
                 for (int x = 0; x < input_image.width(); ++x)
                 {
-                    const unsigned char pixel = input_image(x, y, z);
+                    const uint pixel = input_image(x, y, z);
                     // For light background: dark pixels (<=threshold) become black (0)
                     // For dark background: light pixels (>threshold) become white (255)
                     const bool is_foreground = light_background ? (pixel <= threshold) : (pixel > threshold);
@@ -184,7 +1051,7 @@ namespace ite::binarization
      * @brief (Internal) Converts a grayscale image to a binary (black and white)
      * image, in-place. Uses simple Bataine's adaptive thresholding.
      */
-    void binarize_bataineh(CImg<uint> &input_image)
+    void binarize_bataineh(CImg<uint> &input_image, const int threshold_scale, const core::Pyramid* pyramid)
     {
         /*
         Calculates adaptive binarization while using adaptive window sizes to improve
@@ -215,223 +1082,135 @@ namespace ite::binarization
             throw std::runtime_error("Adaptive Binarization requires a grayscale image.");
         }
 
-        CImg<double> img_double = input_image; // Convert CImg<uint> to CImg<double>
-        CImg<double> integral_img = core::calculate_integral_image(input_image);
-        CImg<double> integral_sq_img = core::calculate_integral_image(input_image.get_sqr()); // Integral of (pixel*pixel)
+        // adaptive window size steps 1-3 (the classification only needs the histogram, which a pyramid level approximates)
+        const CImg<uint>* level = pyramid ? pyramid->find(BATAINEH_STATS_LONG_SIDE) : nullptr;
+        const BatainehParams params = bataineh_global_params(input_image, level ? *level : input_image);
 
-        // set usefull constants
-        const double mean_global = img_double.mean();
-        const int img_width = img_double.width();
-        const int img_height = img_double.height();
-        const int img_depth = img_double.depth();
-
-        // ============================================================================
-        // adaptive window size steps 1-3
-        // ============================================================================
-
-        // First step: compute Confusion Threshold T_con
-        const double std_dev = std::sqrt(img_double.variance());
-        const double max_intensity = img_double.max();
-        const double T_con = mean_global - ((mean_global * mean_global * std_dev) / ((mean_global + std_dev) * (0.5 * max_intensity + std_dev)));
-        const double offset = std_dev / 2.0;
-
-        // Second step: classify pixels based on T_con and calculation of
-        // probabilities p
-        long n_black = 0;
-        long n_red = 0;
-        long n_white = 0;
-        cimg_forXYZ(img_double, x, y, z)
-        {
-            double pixel_value = img_double(x, y, z);
-            if (pixel_value <= T_con - offset)
-            {
-                n_black++;
-            }
-            else if (pixel_value >= T_con + offset)
-            {
-                n_white++;
-            }
-            else
-            {
-                n_red++;
-            }
-        }
-
-        double p = (n_red == 0) ? 10.0 : (double)n_black / n_red;
-
-        // Third step: determine primary window size pw_size based on probability p
-        // pw_size = [pw_size_x, pw_size_y]
-        int pw_size[2];
-        if (p >= 2.5 || (std_dev < 0.1 * max_intensity)) // large text size, low contact images
+        const int scale = normalize_threshold_scale(threshold_scale);
+        if (scale > 1)
         {
-            pw_size[0] = img_width / 6; // 6
-            pw_size[1] = img_height / 4; // 4
-        }
-        else if (1 < p || (img_width + img_height) < 400)
-        { // fine and normal images
-            pw_size[0] = img_width / 30; // 30
-            pw_size[1] = img_height / 20; // 20
-        }
-        else
-        { // very fine text size, high contact images
-            pw_size[0] = img_width / 40; // 40
-            pw_size[1] = img_height / 30; // 30
+            binarize_bataineh_scaled(input_image, params, scale);
+            return;
         }
 
-        // check if window sizes are odd numbers, if not make them odd
-        if (pw_size[0] % 2 == 0)
-        {
-            pw_size[0]++;
-        }
-        if (pw_size[1] % 2 == 0)
-        {
-            pw_size[1]++;
-        }
+        const int img_width = input_image.width();
+        const int img_height = input_image.height();
+        const int img_depth = input_image.depth();
+        const double T_con = params.T_con;
+        const double offset = params.offset;
 
         // usefull constants for later
-        const int pw_x_half = pw_size[0] / 2;
-        const int pw_y_half = pw_size[1] / 2;
+        const int pw_x_half = params.pw_x_half;
+        const int pw_y_half = params.pw_y_half;
+        const core::LocalWindow primary_window{pw_x_half, pw_y_half};
+        const core::LocalWindow sub_window{pw_x_half / 2, pw_y_half / 2};
 
         // ============================================================================
-        // End adaptive window size steps 1-3
+        // adaptive binarization
         // ============================================================================
 
-        CImg<uint> output_image(img_width, img_height, img_depth, 1);
-        double min_std_dev = 255.0; // initialize to max possible value -> can only go down
-        double max_std_dev = 0.0; // initialize to min possible value -> can only go up
+        // Red minus black pixels with respect to T_con, as one integral image: the window choice only needs to know
+        // which class is larger (4 bytes per pixel instead of two double counts)
+        const CImg<int32_t> class_balance = class_balance_integral(input_image, T_con, offset);
 
-        // ============================================================================
-        // adaptive binarization
-        // ============================================================================
+        // 1. One sweep over the primary and the halved window: reduce the primary window's std. deviation to its
+        // global min and max, and keep mean and std. deviation of each pixel's final window for the second phase,
+        // in 1/256 fixed point (channel 0: mean, channel 1: std. deviation)
+        CImg<uint16_t> final_stats(img_width, img_height, img_depth, 2);
+        std::vector<double> row_min_std_dev(static_cast<size_t>(img_depth) * img_height);
+        std::vector<double> row_max_std_dev(row_min_std_dev.size());
 
-        // 1. Calculate local std. deviation for each window and determine global min and max std. deviation
-#pragma omp parallel for collapse(3) reduction(min : min_std_dev) reduction(max : max_std_dev)
-        for (int z = 0; z < img_depth; ++z)
-        {
-            for (int y = 0; y < img_height; ++y)
-            {
-                for (int x = 0; x < img_width; ++x)
+        core::LocalStats(input_image, {primary_window, sub_window})
+            .for_each_row(
+                [&](const int y, const int z, const int, const core::LocalStatsRow* rows)
                 {
-                    // use primary window size pw_size for each pixel in step 1
-                    // Define the local window (clamp to edges)
-                    const int x1 = std::max(0, x - pw_x_half);
+                    const auto [min_it, max_it] = std::minmax_element(rows[0].std_dev, rows[0].std_dev + img_width);
+                    row_min_std_dev[static_cast<size_t>(z) * img_height + y] = *min_it;
+                    row_max_std_dev[static_cast<size_t>(z) * img_height + y] = *max_it;
+
+                    uint16_t* mean_out = final_stats.data(0, y, z, 0);
+                    uint16_t* std_dev_out = final_stats.data(0, y, z, 1);
                     const int y1 = std::max(0, y - pw_y_half);
-                    const int x2 = std::min(img_width - 1, x + pw_x_half);
                     const int y2 = std::min(img_height - 1, y + pw_y_half);
 
-                    // Get sum and sum of squares from integral images
-                    double sum = core::get_area_sum(integral_img, x1, y1, z, 0, x2, y2);
-                    double sum_sq = core::get_area_sum(integral_sq_img, x1, y1, z, 0, x2, y2);
-
-                    const double N = (x2 - x1 + 1) * (y2 - y1 + 1); // Number of pixels in window
-
-                    // Calculate local mean and std. deviation
-                    const double mean = sum / N;
-                    const double std_dev = std::sqrt(std::max(0.0, (sum_sq / N) - (mean * mean)));
-
-                    // set min and max global std deviation for normalization
-                    if (std_dev < min_std_dev)
+                    for (int x = 0; x < img_width; ++x)
                     {
-                        min_std_dev = std_dev;
+                        // ============================================================================
+                        // adaptive window size steps 4-5
+                        // ============================================================================
+                        // Fourth step: Set final window size W_size based on pw_size and image dimensions count number of black and red
+                        // pixels in primary window (the counting window excludes its last row and column)
+                        const int x1 = std::max(0, x - pw_x_half);
+                        const int x2 = std::min(img_width - 1, x + pw_x_half);
+                        const bool more_red = x2 > x1 && y2 > y1 && balance_area_sum(class_balance, x1, y1, z, x2 - 1, y2 - 1) > 0;
+
+                        // if more red pixels than black pixels, decrease window size if not use
+                        // normal pw_size
+                        // Fifth step: keep the statistics of the final window
+                        const core::LocalStatsRow &final_window = more_red ? rows[1] : rows[0];
+                        mean_out[x] = to_stats_fixed(final_window.mean[x]);
+                        std_dev_out[x] = to_stats_fixed(final_window.std_dev[x]);
                     }
-                    if (std_dev > max_std_dev)
-                    {
-                        max_std_dev = std_dev;
-                    }
-                }
-            }
-        }
+                });
+
+        // set min and max global std deviation for normalization
+        // (initialized to the max/min possible value -> can only go down/up)
+        const double min_std_dev = std::min(255.0, *std::min_element(row_min_std_dev.begin(), row_min_std_dev.end()));
+        const double max_std_dev = std::max(0.0, *std::max_element(row_max_std_dev.begin(), row_max_std_dev.end()));
 
         // calculate range once and set a small epsilon to avoid division by zero
         const double std_dev_range = (max_std_dev - min_std_dev) > 1e-5 ? (max_std_dev - min_std_dev) : 1e-5;
 
-        // 2. Binarize using local std. deviation
-#pragma omp parallel for collapse(3)
+        // 2. Binarize: only the threshold evaluation is left, so the image can be overwritten in place
+#pragma omp parallel for collapse(2)
         for (int z = 0; z < img_depth; ++z)
         {
             for (int y = 0; y < img_height; ++y)
             {
+                const uint16_t* mean_in = final_stats.data(0, y, z, 0);
+                const uint16_t* std_dev_in = final_stats.data(0, y, z, 1);
+                uint* row = input_image.data(0, y, z);
                 for (int x = 0; x < img_width; ++x)
                 {
-                    // Define the local window (clamp to edges)
-                    const int x1 = std::max(0, x - pw_x_half);
-                    const int y1 = std::max(0, y - pw_y_half);
-                    const int x2 = std::min(img_width - 1, x + pw_x_half);
-                    const int y2 = std::min(img_height - 1, y + pw_y_half);
+                    const double threshold =
+                        bataineh_threshold(from_stats_fixed(mean_in[x]), from_stats_fixed(std_dev_in[x]), params.mean_global, min_std_dev, std_dev_range);
+                    row[x] = (static_cast<double>(row[x]) > threshold) * 255;
+                }
+            }
+        }
+    }
 
-                    // ============================================================================
-                    // adaptive window size steps 4-5
-                    // ============================================================================
-                    // Fourth step: Set final window size W_size based on pw_size and image dimensions count number of black and red pixels in primary window
-                    long n_w_black = 0;
-                    long n_w_red = 0;
-                    for (int i = y1; i < y2; ++i)
-                    {
-                        for (int j = x1; j < x2; ++j)
-                        {
-                            double w_pixel_value = input_image(j, i, z);
-                            if (w_pixel_value <= T_con - offset)
-                            {
-                                n_w_black++;
-                            }
-                            else if (w_pixel_value < T_con + offset)
-                            {
-                                n_w_red++;
-                            }
-                        }
-                    }
-                    // if more red pixels than black pixels, decrease window size if not use
-                    // normal pw_size
-                    bool use_sub_window = (n_w_red > n_w_black);
-                    int final_w_x_half = use_sub_window ? pw_x_half / 2 : pw_x_half;
-                    int final_w_y_half = use_sub_window ? pw_y_half / 2 : pw_y_half;
-
-                    // Fifth step: redefine the local window with final window size
-                    const int x1_final = std::max(0, x - final_w_x_half);
-                    const int y1_final = std::max(0, y - final_w_y_half);
-                    const int x2_final = std::min(img_width - 1, x + final_w_x_half);
-                    const int y2_final = std::min(img_height - 1, y + final_w_y_half);
-
-                    // ============================================================================
-                    // end adaptive window size steps 4-5
-                    // ============================================================================
-
-                    // Get sum and sum of squares from integral images
-                    double sum = core::get_area_sum(integral_img, x1_final, y1_final, z, 0, x2_final, y2_final);
-                    double sum_sq = core::get_area_sum(integral_sq_img, x1_final, y1_final, z, 0, x2_final, y2_final);
-                    const double N = (x2_final - x1_final + 1) * (y2_final - y1_final + 1); // Number of pixels in window
-
-                    // Calculate local mean and std. deviation
-                    const double mean_window_val = sum / N;
-                    const double std_dev_window_val = std::sqrt(std::max(0.0, (sum_sq / N) - (mean_window_val * mean_window_val)));
-
-                    // not part of Bataineh's method, but needed for fourther adjusting
-                    // threshold
-                    double k = 1.0;
-                    if (std_dev_window_val < 5.0)
-                    {
-                        k = 1.4;
-                    }
-                    else if (std_dev_window_val > 30.0)
-                    {
-                        k = 0.8;
-                    }
+    double f_measure(const CImg<uint> &result, const CImg<uint> &reference)
+    {
+        if (result.width() != reference.width() || result.height() != reference.height() || result.depth() != reference.depth() ||
+            result.spectrum() != reference.spectrum())
+        {
+            throw std::runtime_error("F-measure requires images of the same dimensions.");
+        }
 
-                    // Calculate adaptive threshold
-                    double std_dev_adaptive = (std_dev_window_val - min_std_dev) / std_dev_range;
+        uint64_t tp = 0, fp = 0, fn = 0;
+        const uint* r = result.data();
+        const uint* g = reference.data();
+        const long long n = static_cast<long long>(result.size());
 
-                    // define threshold based on adaptive std deviation
-                    const double threshold = mean_window_val -
-                        k *
-                            (((mean_window_val * mean_window_val) - std_dev_window_val) /
-                             ((mean_global + std_dev_window_val) * (std_dev_adaptive + std_dev_window_val)));
+#pragma omp parallel for reduction(+ : tp, fp, fn) schedule(static)
+        for (long long i = 0; i < n; ++i)
+        {
+            const bool r_fg = (r[i] == 0);
+            const bool g_fg = (g[i] == 0);
+            tp += (r_fg && g_fg);
+            fp += (r_fg && !g_fg);
+            fn += (!r_fg && g_fg);
+        }
 
-                    // Apply threshold - new image needed because of race conditions in the parallel for loops
-                    output_image(x, y, z) = (img_double(x, y, z) > threshold) * 255;
-                }
-            }
+        if (tp == 0)
+        {
+            // No common foreground: identical only if both are empty
+            return (fp == 0 && fn == 0) ? 1.0 : 0.0;
         }
-        input_image = output_image;
+        const double precision = static_cast<double>(tp) / static_cast<double>(tp + fp);
+        const double recall = static_cast<double>(tp) / static_cast<double>(tp + fn);
+        return 2.0 * precision * recall / (precision + recall);
     }
 
 } // namespace ite::binarization
@@ -1,9 +1,12 @@
 #pragma once
 /**
  * @file binarization.h
- * @brief Image binarization algorithms (Sauvola, Otsu).
+ * @brief Image binarization algorithms (Sauvola, Niblack, Wolf-Jolion, Phansalkar, NICK, Otsu, Bataineh).
  */
 
+#include <vector>
+
+#include "../core/pyramid.h"
 #include "CImg.h"
 
 using namespace cimg_library;
@@ -18,24 +21,95 @@ namespace ite::binarization
      * to compute a threshold for each pixel, making it robust against
      * uneven illumination.
      *
+     * The window statistics are streamed row by row from running integer column sums,
+     * so apart from the output only O(width) memory per thread is needed.
+     *
      * @param image The grayscale image to binarize (modified in-place).
      * @param window_size The size of the local window (default: 15).
      * @param k Sauvola's parameter controlling threshold sensitivity (default: 0.2).
      * @param delta Optional offset subtracted from threshold (default: 0.0).
+     * @param threshold_scale Grid spacing of the threshold surface (1 = per pixel, 2..8 = thresholds are computed
+     *        from block statistics on a 1/scale grid and bilinearly interpolated; default: 1).
+     * @throws std::runtime_error if the image is not grayscale (1-channel).
+     */
+    void binarize_sauvola(CImg<uint> &image, int window_size = 15, float k = 0.2f, float delta = 0.0f, int threshold_scale = 1);
+
+    /**
+     * @brief Binarizes a grayscale image in-place using Niblack's method, T = m + k * s.
+     *
+     * Uses the same streamed local mean/std. deviation as Sauvola (O(1) per pixel).
+     *
+     * @param image The grayscale image to binarize (modified in-place).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the local std. deviation, negative for dark text (default: -0.2).
      * @throws std::runtime_error if the image is not grayscale (1-channel).
      */
-    void binarize_sauvola(CImg<uint> &image, int window_size = 15, float k = 0.2f, float delta = 0.0f);
+    void binarize_niblack(CImg<uint> &image, int window_size = 15, float k = -0.2f);
+
+    /**
+     * @brief Binarizes a grayscale image in-place using Wolf and Jolion's method.
+     *
+     * T = (1 - k) * m + k * M + k * (s / R) * (m - M), with M the darkest gray value of the image
+     * and R the largest local std. deviation. Suited to low-contrast, degraded documents.
+     * R is only known after the statistics sweep, so mean and std. deviation are buffered as float
+     * (8 bytes per pixel) and the thresholds are evaluated in a second, light pass.
+     *
+     * @param image The grayscale image to binarize (modified in-place).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the contrast terms (default: 0.5).
+     * @throws std::runtime_error if the image is not grayscale (1-channel).
+     */
+    void binarize_wolf(CImg<uint> &image, int window_size = 15, float k = 0.5f);
+
+    /**
+     * @brief Binarizes a grayscale image in-place using Phansalkar's method.
+     *
+     * T = m * (1 + p * exp(-q * m) + k * (s / R - 1)) on intensities normalized to [0, 1], with p = 2, q = 10 and R = 0.5.
+     * The exponential term raises the threshold in dark regions, which helps on stained historic documents.
+     *
+     * @param image The grayscale image to binarize (modified in-place).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the local std. deviation (default: 0.25).
+     * @throws std::runtime_error if the image is not grayscale (1-channel).
+     */
+    void binarize_phansalkar(CImg<uint> &image, int window_size = 15, float k = 0.25f);
+
+    /**
+     * @brief Binarizes a grayscale image in-place using the NICK method, T = m + k * sqrt(s^2 + m^2).
+     *
+     * Shifts Niblack's threshold down on light backgrounds, which reduces background noise.
+     *
+     * @param image The grayscale image to binarize (modified in-place).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the shifted deviation, typically -0.2 to -0.1 (default: -0.1).
+     * @throws std::runtime_error if the image is not grayscale (1-channel).
+     */
+    void binarize_nick(CImg<uint> &image, int window_size = 15, float k = -0.1f);
 
     /**
      * @brief Computes Otsu's threshold for a grayscale image.
      *
      * Otsu's method finds the threshold that minimizes intra-class variance
      * (or equivalently maximizes inter-class variance).
+     * The histogram is built in one parallel pass over the image; values above 255 count as 255.
+     *
+     * @param gray The grayscale image.
+     * @return The optimal threshold value (0-255), the last gray value of the dark class.
+     */
+    int compute_otsu_threshold(const CImg<uint> &gray);
+
+    /**
+     * @brief Computes multi-level Otsu thresholds for a grayscale image.
+     *
+     * Splits the histogram into `count + 1` classes with maximal between-class variance, found exactly
+     * with a dynamic-programming table over the 256 bins. The image itself is read once.
      *
-     * @param gray The grayscale image (8-bit).
-     * @return The optimal threshold value (0-255).
+     * @param gray The grayscale image.
+     * @param count Number of thresholds, 1 to 3 (1 is the same as compute_otsu_threshold).
+     * @return The thresholds in increasing order, each the last gray value of its class.
+     * @throws std::invalid_argument if count is outside 1..3.
      */
-    int compute_otsu_threshold(const CImg<unsigned char> &gray);
+    std::vector<int> compute_otsu_thresholds(const CImg<uint> &gray, int count);
 
     /**
      * @brief Computes the mean intensity of border pixels.
@@ -45,7 +119,19 @@ namespace ite::binarization
      * @param gray The grayscale image.
      * @return The average intensity of border pixels.
      */
-    double compute_border_mean(const CImg<unsigned char> &gray);
+    double compute_border_mean(const CImg<uint> &gray);
+
+    /**
+     * @brief Detects light text on a dark background, i.e. a page that needs inverting before binarization.
+     *
+     * Works on a strided luma proxy with a long side of about 512 pixels. The page counts as dark if its two Otsu
+     * classes are well separated (between-class variance at least half of the total), the border mean falls into the
+     * dark class and the dark class covers most of the page. Low-contrast or unimodal pages keep their polarity.
+     *
+     * @param image Grayscale or color (3-channel) image.
+     * @return True if the page is light-on-dark.
+     */
+    bool detect_dark_background(const CImg<uint> &image);
 
     /**
      * @brief Binarizes a grayscale image in-place using Otsu's method.
@@ -54,10 +140,20 @@ namespace ite::binarization
      * The border mean is used to determine if the background is light or dark,
      * and adjust the binarization accordingly (dark text on light background vs. light text on dark background).
      *
+     * With `tile_size > 0`, a threshold is computed per tile from the tile's histogram (in parallel). Tiles without
+     * a usable split (e.g. plain background) inherit their neighbours' thresholds, the threshold grid is smoothed
+     * and bilinearly interpolated per pixel. This adapts to uneven lighting at close to global-Otsu cost.
+     *
+     * With `thresholds > 1` (global mode only), the histogram is split into several classes and only the darkest
+     * class (brightest on a dark background) is foreground, so mid-tone stamps or highlights drop out.
+     *
      * @param image The grayscale image to binarize (modified in-place).
+     * @param tile_size Tile edge length in pixels, 0 = one global threshold (default: 0).
+     * @param thresholds Number of Otsu thresholds, 1 to 3; ignored in tiled mode (default: 1).
      * @throws std::runtime_error if the image is not grayscale (1-channel).
+     * @throws std::invalid_argument if thresholds is outside 1..3.
      */
-    void binarize_otsu(CImg<uint> &image);
+    void binarize_otsu(CImg<uint> &image, int tile_size = 0, int thresholds = 1);
 
     /**
      * @brief Binarizes a grayscale image in-place using Bataineh's method.
@@ -67,8 +163,25 @@ namespace ite::binarization
      * Uses adaptive local thresholds computed from local mean and standard deviation for separation.
      *
      * @param image The grayscale image to binarize (modified in-place).
+     * @param threshold_scale Grid spacing of the threshold surface (1 = per pixel, 2..8 = window statistics and
+     *        window selection are evaluated on a 1/scale block grid and the thresholds bilinearly interpolated; default: 1).
+     * @param pyramid Optional pyramid of `image`; the global statistics that select the window class are then
+     *        taken from a level with a long side of at least 1024 px instead of the full image.
      * @throws std::runtime_error if the image is not grayscale (1-channel).
      */
-    void binarize_bataineh(CImg<uint> &image);
+    void binarize_bataineh(CImg<uint> &image, int threshold_scale = 1, const core::Pyramid* pyramid = nullptr);
+
+    /**
+     * @brief Computes the F-measure of a binarization result against a reference binarization.
+     *
+     * Foreground is black (0) in both images. Useful to quantify how much an approximation
+     * (e.g. a coarser threshold surface) deviates from the exact result.
+     *
+     * @param result The binarization to evaluate.
+     * @param reference The reference binarization.
+     * @return Harmonic mean of precision and recall in [0, 1] (1.0 = identical foreground).
+     * @throws std::runtime_error if the image dimensions differ.
+     */
+    double f_measure(const CImg<uint> &result, const CImg<uint> &reference);
 
 } // namespace ite::binarization
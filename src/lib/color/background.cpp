@@ -0,0 +1,130 @@
+#include "background.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+#include "../core/local_stats.h"
+
+
+namespace ite::color
+{
+
+    namespace
+    {
+        /**
+         * @brief (Internal) Bilinear sampling positions of the grid cells for every full-resolution coordinate.
+         * Cell i is centered on full-resolution coordinate (i + 0.5) * factor - 0.5.
+         */
+        struct Taps
+        {
+            std::vector<int> i0, i1;
+            std::vector<float> w1;
+        };
+
+        Taps grid_taps(const int size, const int cells, const int factor)
+        {
+            Taps taps;
+            taps.i0.resize(size);
+            taps.i1.resize(size);
+            taps.w1.resize(size);
+            for (int x = 0; x < size; ++x)
+            {
+                const float g = std::clamp((x + 0.5f) / factor - 0.5f, 0.0f, static_cast<float>(cells - 1));
+                const int i0 = std::min(static_cast<int>(g), cells - 1);
+                taps.i0[x] = i0;
+                taps.i1[x] = std::min(i0 + 1, cells - 1);
+                taps.w1[x] = g - i0;
+            }
+            return taps;
+        }
+    } // namespace
+
+    int background_factor(const int window) { return std::max(1, window / 8); }
+
+    CImg<uint> estimate_background(const CImg<uint> &gray, const int window, const int factor)
+    {
+        if (gray.spectrum() != 1)
+        {
+            throw std::invalid_argument("Background estimation requires a single-channel image.");
+        }
+        if (window < 3 || factor < 1)
+        {
+            throw std::invalid_argument("Background window must be at least 3 and the grid factor at least 1.");
+        }
+        if (gray.is_empty())
+        {
+            return {};
+        }
+
+        const int w = gray.width();
+        const int h = gray.height();
+        const int gw = (w + factor - 1) / factor;
+        const int gh = (h + factor - 1) / factor;
+
+        // Block maxima: text darker than the paper drops out already inside a block. The grid gets a margin of r cells
+        // repeating its edges, so the closing does not brighten the borders of pages with a brightness gradient
+        const int r = std::max(1, window / factor / 2);
+        CImg<uint> grid(gw + 2 * r, gh + 2 * r, 1, 1, 0);
+#pragma omp parallel for schedule(static)
+        for (int gy = 0; gy < gh; ++gy)
+        {
+            uint* dst = grid.data(r, gy + r);
+            for (int y = gy * factor; y < std::min(h, (gy + 1) * factor); ++y)
+            {
+                const uint* src = gray.data(0, y);
+                for (int x = 0; x < w; ++x)
+                    dst[x / factor] = std::max(dst[x / factor], src[x]);
+            }
+            for (int i = 0; i < r; ++i)
+            {
+                dst[-1 - i] = dst[0];
+                dst[gw + i] = dst[gw - 1];
+            }
+        }
+        for (int i = 0; i < r; ++i)
+        {
+            std::copy_n(grid.data(0, r), grid.width(), grid.data(0, i));
+            std::copy_n(grid.data(0, r + gh - 1), grid.width(), grid.data(0, r + gh + i));
+        }
+
+        // Closing on the grid: the maximum removes wider dark features, the minimum restores the extent of bright areas
+        return core::local_min(core::local_max(grid, {r, r}), {r, r}).get_crop(r, r, r + gw - 1, r + gh - 1);
+    }
+
+    void flatten_background(CImg<uint> &gray, const int window)
+    {
+        const int factor = background_factor(window);
+        const CImg<uint> background = estimate_background(gray, window, factor);
+        if (background.is_empty())
+        {
+            return;
+        }
+
+        const int w = gray.width();
+        const int h = gray.height();
+        const Taps cols = grid_taps(w, background.width(), factor);
+        const Taps rows = grid_taps(h, background.height(), factor);
+
+        // One pass: interpolate the background and divide it out
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < h; ++y)
+        {
+            const uint* b0 = background.data(0, rows.i0[y]);
+            const uint* b1 = background.data(0, rows.i1[y]);
+            const float wy = rows.w1[y];
+            uint* row = gray.data(0, y);
+            for (int x = 0; x < w; ++x)
+            {
+                const int i0 = cols.i0[x], i1 = cols.i1[x];
+                const float wx = cols.w1[x];
+                const float top = b0[i0] + wx * (static_cast<float>(b0[i1]) - b0[i0]);
+                const float bottom = b1[i0] + wx * (static_cast<float>(b1[i1]) - b1[i0]);
+                const float bg = std::max(1.0f, top + wy * (bottom - top));
+                row[x] = static_cast<uint>(std::min(255.0f, 255.0f * row[x] / bg) + 0.5f);
+            }
+        }
+    }
+
+} // namespace ite::color
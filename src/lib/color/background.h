@@ -0,0 +1,47 @@
+#pragma once
+/**
+ * @file background.h
+ * @brief Background estimation and shading correction.
+ */
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::color
+{
+
+    /**
+     * @brief Estimates the paper brightness of a grayscale page on a coarse grid.
+     *
+     * The page is reduced to the maximum of every `factor` x `factor` block, then closed with a window of about
+     * `window` full-resolution pixels (van Herk/Gil-Werman maximum followed by minimum), which removes dark
+     * features narrower than the window while keeping the extent of bright areas.
+     *
+     * @param gray Grayscale image (1 channel).
+     * @param window Side of the closing window in full-resolution pixels; should exceed the largest stroke width.
+     * @param factor Block size of the grid (see background_factor()).
+     * @return The background grid, ceil(width / factor) x ceil(height / factor).
+     * @throws std::invalid_argument if the image has more than one channel, `window` < 3 or `factor` < 1.
+     */
+    CImg<uint> estimate_background(const CImg<uint> &gray, int window, int factor);
+
+    /**
+     * @brief Grid block size used by flatten_background() for a window: the closing runs on about 8 grid cells.
+     */
+    int background_factor(int window);
+
+    /**
+     * @brief Divides the background out of a grayscale page in-place (shading correction).
+     *
+     * Every pixel becomes `255 * value / background`, with the background grid interpolated bilinearly in the same
+     * pass, so unevenly lit paper turns uniformly white and text keeps its contrast to the paper around it.
+     * Global or small-window binarization then works on photos and stained pages.
+     *
+     * @param gray Grayscale image (1 channel), modified in-place.
+     * @param window Side of the closing window in full-resolution pixels (default: 51).
+     * @throws std::invalid_argument if the image has more than one channel or `window` < 3.
+     */
+    void flatten_background(CImg<uint> &gray, int window = 51);
+
+} // namespace ite::color
@@ -1,52 +1,182 @@
 #include "color.h"
+#include <algorithm>
 #include <stdexcept>
 
 
 namespace ite::color
 {
 
+    namespace
+    {
+        /**
+         * @brief (Internal) Checks a color image and a mask of the given size; false if either is empty (nothing to do).
+         */
+        bool check_color_pass(const CImg<uint> &color_image, const int mask_width, const int mask_rows, const int mask_spectrum, const bool mask_empty)
+        {
+            if (mask_empty || color_image.is_empty())
+            {
+                return false;
+            }
+
+            if (mask_spectrum != 1)
+            {
+                throw std::invalid_argument("Binary mask must have a single channel.");
+            }
+            if (color_image.spectrum() != 3)
+            {
+                throw std::invalid_argument("Color image must have 3 channels.");
+            }
+            if (color_image.width() != mask_width || color_image.height() * color_image.depth() != mask_rows)
+            {
+                throw std::invalid_argument("Images must have the same dimensions.");
+            }
+            return true;
+        }
+
+        /**
+         * @brief (Internal) Runs `row_mask(row, dst, width)` on every row of every channel plane, in parallel.
+         * `row_mask` whitens the background pixels of one plane row `dst` from mask row `row`.
+         */
+        template <typename RowMask>
+        void whiten_planes(CImg<uint> &color_image, const RowMask &row_mask)
+        {
+            const int w = color_image.width();
+            const long long rows = static_cast<long long>(color_image.height()) * color_image.depth();
+            const int channels = color_image.spectrum();
+
+#pragma omp parallel for collapse(2) schedule(static)
+            for (int c = 0; c < channels; ++c)
+            {
+                for (long long r = 0; r < rows; ++r)
+                {
+                    uint* dst = color_image.data() + (c * rows + r) * w;
+                    row_mask(r, dst, w);
+                }
+            }
+        }
+    } // namespace
+
+    PackedMask pack_mask(const CImg<uint> &bin_image)
+    {
+        if (bin_image.spectrum() > 1)
+        {
+            throw std::invalid_argument("Binary mask must have a single channel.");
+        }
+
+        PackedMask mask;
+        mask.width = bin_image.width();
+        mask.rows = bin_image.height() * bin_image.depth();
+        mask.stride = (static_cast<size_t>(mask.width) + 7) / 8;
+        mask.bits.assign(mask.stride * mask.rows, 0);
+
+#pragma omp parallel for schedule(static)
+        for (int r = 0; r < mask.rows; ++r)
+        {
+            const uint* src = bin_image.data() + static_cast<size_t>(r) * mask.width;
+            uint8_t* dst = mask.bits.data() + static_cast<size_t>(r) * mask.stride;
+            for (int x = 0; x < mask.width; ++x)
+                dst[x / 8] |= static_cast<uint8_t>((src[x] == 255) << (x % 8));
+        }
+        return mask;
+    }
+
     void color_pass_inplace(CImg<uint> &color_image, const CImg<uint> &bin_image)
     {
-        if (bin_image.is_empty() || color_image.is_empty())
+        if (!check_color_pass(color_image, bin_image.width(), bin_image.height() * bin_image.depth(), bin_image.spectrum(), bin_image.is_empty()))
         {
             return;
         }
 
-        if (bin_image.spectrum() != 1)
+        // If Mask is White (Background), set output to White. If Mask is Black (Text), leave the original color alone.
+        whiten_planes(color_image,
+                      [&bin_image](const long long r, uint* dst, const int w)
+                      {
+                          const uint* m = bin_image.data() + r * w;
+#pragma omp simd
+                          for (int x = 0; x < w; ++x)
+                              dst[x] = (m[x] == 255) ? 255u : dst[x];
+                      });
+    }
+
+    void color_pass_inplace(CImg<uint> &color_image, const CImg<unsigned char> &bin_image)
+    {
+        if (!check_color_pass(color_image, bin_image.width(), bin_image.height() * bin_image.depth(), bin_image.spectrum(), bin_image.is_empty()))
         {
-            throw std::invalid_argument("Binary mask must have a single channel.");
+            return;
+        }
+
+        whiten_planes(color_image,
+                      [&bin_image](const long long r, uint* dst, const int w)
+                      {
+                          const unsigned char* m = bin_image.data() + r * w;
+#pragma omp simd
+                          for (int x = 0; x < w; ++x)
+                              dst[x] = (m[x] == 255) ? 255u : dst[x];
+                      });
+    }
+
+    void color_pass_inplace(CImg<uint> &color_image, const PackedMask &mask)
+    {
+        if (!check_color_pass(color_image, mask.width, mask.rows, 1, mask.bits.empty()))
+        {
+            return;
         }
-        if (color_image.spectrum() != 3)
+
+        whiten_planes(color_image,
+                      [&mask](const long long r, uint* dst, const int w)
+                      {
+                          const uint8_t* m = mask.bits.data() + r * mask.stride;
+                          // Whole bytes: 8 selects driven by one mask byte
+                          const int full = w / 8;
+                          for (int b = 0; b < full; ++b)
+                          {
+                              const unsigned bits = m[b];
+                              uint* d = dst + 8 * b;
+#pragma omp simd
+                              for (int k = 0; k < 8; ++k)
+                                  d[k] = ((bits >> k) & 1u) ? 255u : d[k];
+                          }
+                          for (int x = 8 * full; x < w; ++x)
+                              dst[x] = ((m[x / 8] >> (x % 8)) & 1u) ? 255u : dst[x];
+                      });
+    }
+
+    void color_pass_rows(const CImg<uint> &color_image, const CImg<uint> &bin_image, const int y0, const int rows, unsigned char* out, const size_t stride)
+    {
+        const int total_rows = color_image.height() * color_image.depth();
+        if (!check_color_pass(color_image, bin_image.width(), bin_image.height() * bin_image.depth(), bin_image.spectrum(), bin_image.is_empty()))
         {
-            throw std::invalid_argument("Color image must have 3 channels.");
+            return;
         }
-        if (color_image.width() != bin_image.width() || color_image.height() != bin_image.height())
+        if (y0 < 0 || rows < 0 || y0 + rows > total_rows)
         {
-            throw std::invalid_argument("Images must have the same dimensions.");
+            throw std::invalid_argument("Rows must lie inside the image.");
         }
 
-        int w = color_image.width();
-        int h = color_image.height();
-        int d = color_image.depth();
+        const int w = color_image.width();
+        if (stride < 3 * static_cast<size_t>(w))
+        {
+            throw std::invalid_argument("Output stride must hold a row of RGB pixels.");
+        }
 
-// Iterate over the image and apply mask
-#pragma omp parallel for collapse(2)
-        for (int z = 0; z < d; ++z)
+        const size_t plane = static_cast<size_t>(w) * total_rows;
+#pragma omp parallel for schedule(static)
+        for (int i = 0; i < rows; ++i)
         {
-            for (int y = 0; y < h; ++y)
+            const size_t row = static_cast<size_t>(y0 + i) * w;
+            const uint* r = color_image.data() + row;
+            const uint* g = r + plane;
+            const uint* b = g + plane;
+            const uint* m = bin_image.data() + row;
+            unsigned char* o = out + static_cast<size_t>(i) * stride;
+
+#pragma omp simd
+            for (int x = 0; x < w; ++x)
             {
-                for (int x = 0; x < w; ++x)
-                {
-                    // Check the mask pixel (Single channel)
-                    // If Mask is White (Background), set output to White.
-                    // If Mask is Black (Text), leave the original color alone.
-                    if (bin_image(x, y, z) == 255)
-                    {
-                        color_image(x, y, z, 0) = 255; // R
-                        color_image(x, y, z, 1) = 255; // G
-                        color_image(x, y, z, 2) = 255; // B
-                    }
-                }
+                const bool background = m[x] == 255;
+                o[3 * x] = background ? 255 : static_cast<unsigned char>(std::min(r[x], 255u));
+                o[3 * x + 1] = background ? 255 : static_cast<unsigned char>(std::min(g[x], 255u));
+                o[3 * x + 2] = background ? 255 : static_cast<unsigned char>(std::min(b[x], 255u));
             }
         }
     }
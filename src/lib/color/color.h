@@ -4,6 +4,10 @@
  * @brief Color operations.
  */
 
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
 #include "CImg.h"
 
 using namespace cimg_library;
@@ -11,12 +15,59 @@ using namespace cimg_library;
 namespace ite::color
 {
 
+    /**
+     * @brief Binary mask with one bit per pixel (1 = background), rows padded to whole bytes.
+     * A 32x smaller stand-in for a CImg<uint> mask; rows of all depth slices are stacked.
+     */
+    struct PackedMask
+    {
+        int width = 0;
+        int rows = 0; ///< height * depth of the packed image
+        size_t stride = 0; ///< Bytes per row
+        std::vector<uint8_t> bits; ///< Pixel x of row y is bit (x % 8) of byte y * stride + x / 8
+    };
+
+    /**
+     * @brief Packs a binary image (255 = background) into one bit per pixel, in parallel over rows.
+     * @throws std::invalid_argument if the image has more than one channel.
+     */
+    PackedMask pack_mask(const CImg<uint> &bin_image);
+
     /**
      * @brief Passes color through a binary image mask. The color image will be overwritten in place.
      *
+     * Pixels where the mask is 255 (background) become white; the others keep their color. Works plane by
+     * plane on whole rows with branch-free selects the compiler vectorizes, so the pass is bound by memory bandwidth.
+     *
      * @param color_image The color image to be passed through the mask.
      * @param bin_image The binary mask image.
      */
     void color_pass_inplace(CImg<uint> &color_image, const CImg<uint> &bin_image);
 
+    /**
+     * @brief color_pass_inplace() with an 8-bit mask (255 = background).
+     */
+    void color_pass_inplace(CImg<uint> &color_image, const CImg<unsigned char> &bin_image);
+
+    /**
+     * @brief color_pass_inplace() with a bit-packed mask (1 = background).
+     */
+    void color_pass_inplace(CImg<uint> &color_image, const PackedMask &mask);
+
+    /**
+     * @brief Color pass written as interleaved 8-bit RGB rows, e.g. straight into the scanline buffer of an encoder.
+     *
+     * Row `y0 + i` of the masked color image is written to `out + i * stride` as R, G, B bytes; the color image is
+     * not modified and no planar result is built. Rows run in parallel.
+     *
+     * @param color_image 3-channel color image (values above 255 are clamped).
+     * @param bin_image The binary mask image (255 = background), of the same size.
+     * @param y0 First row (rows of all depth slices are stacked).
+     * @param rows Number of rows to write.
+     * @param out Output buffer of at least `rows * stride` bytes.
+     * @param stride Bytes between output rows (at least 3 * width).
+     * @throws std::invalid_argument on mismatching images, rows outside the image or a too small stride.
+     */
+    void color_pass_rows(const CImg<uint> &color_image, const CImg<uint> &bin_image, int y0, int rows, unsigned char* out, size_t stride);
+
 } // namespace ite::color
@@ -1,48 +1,60 @@
 #include "contrast.h"
 
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "../core/histogram.h"
+
 
 namespace ite::color
 {
 
-    void contrast_linear_stretch(CImg<uint> &input_image)
+    StretchRange stretch_range(const std::array<uint64_t, 256> &hist, const long long cutoff)
     {
-        if (input_image.is_empty())
-        {
-            return;
-        }
+        StretchRange range;
 
-        // Compute Histogram (to find percentiles)
-        const CImg<uint> hist = input_image.get_histogram(256, 0, 255);
-        const uint total_pixels = input_image.size();
-
-        // Find lower (1%) and upper (99%) cutoffs
-        const uint cutoff = total_pixels / 100; // 1% threshold
-
-        uint min_val = 0;
-        uint count = 0;
         // Find the brightest pixel above cutoff
+        long long count = 0;
         for (int i = 0; i < 256; ++i)
         {
-            count += hist[i];
+            count += static_cast<long long>(hist[i]);
             if (count > cutoff)
             {
-                min_val = i;
+                range.low = i;
                 break;
             }
         }
 
         // Find the darkest pixel below cutoff
-        uint max_val = 255;
         count = 0;
         for (int i = 255; i >= 0; --i)
         {
-            count += hist[i];
+            count += static_cast<long long>(hist[i]);
             if (count > cutoff)
             {
-                max_val = i;
+                range.high = i;
                 break;
             }
         }
+        return range;
+    }
+
+    StretchRange contrast_stretch_range(const CImg<uint> &image)
+    {
+        // Histogram of the values 0..255 (to find percentiles); larger values are not binned
+        const core::Histogram hist = core::compute_histogram(image);
+        const uint total_pixels = image.size();
+
+        // Lower (1%) and upper (99%) cutoffs
+        const uint cutoff = total_pixels / 100; // 1% threshold
+        return stretch_range(hist.bins, cutoff);
+    }
+
+    void apply_linear_stretch(CImg<uint> &input_image, const StretchRange &range)
+    {
+        const uint min_val = range.low;
+        const uint max_val = range.high;
 
         // Safety check: if image is solid color, min might equal max
         if (max_val <= min_val)
@@ -53,6 +65,7 @@ namespace ite::color
         // Apply the stretch
         // Formula: 255 * (val - min) / (max - min)
         const float scale = 255.0f / (max_val - min_val);
+        const uint total_pixels = input_image.size();
 
 #pragma omp parallel for
         for (uint i = 0; i < total_pixels; ++i)
@@ -74,5 +87,138 @@ namespace ite::color
         }
     }
 
+    void contrast_linear_stretch(CImg<uint> &input_image)
+    {
+        if (input_image.is_empty())
+        {
+            return;
+        }
+
+        apply_linear_stretch(input_image, contrast_stretch_range(input_image));
+    }
+
+    namespace
+    {
+        /**
+         * @brief (Internal) The two tiles whose centers enclose each coordinate and the weight of the second, in 1/256.
+         * Tile i is centered on (i + 0.5) * tile_size - 0.5; coordinates outside the outer centers use one tile.
+         */
+        struct TileTaps
+        {
+            std::vector<int> t0, t1;
+            std::vector<int> w1;
+        };
+
+        TileTaps tile_taps(const int size, const int tiles, const int tile_size)
+        {
+            TileTaps taps;
+            taps.t0.resize(size);
+            taps.t1.resize(size);
+            taps.w1.resize(size);
+            for (int x = 0; x < size; ++x)
+            {
+                const float g = std::clamp((x + 0.5f) / tile_size - 0.5f, 0.0f, static_cast<float>(tiles - 1));
+                const int t0 = std::min(static_cast<int>(g), tiles - 1);
+                taps.t0[x] = t0;
+                taps.t1[x] = std::min(t0 + 1, tiles - 1);
+                taps.w1[x] = static_cast<int>((g - t0) * 256.0f + 0.5f);
+            }
+            return taps;
+        }
+    } // namespace
+
+    void contrast_clahe(CImg<uint> &input_image, const int tile_size, const float clip_limit)
+    {
+        if (tile_size < 8 || clip_limit <= 0.0f)
+        {
+            throw std::invalid_argument("CLAHE needs a tile size of at least 8 and a positive clip limit.");
+        }
+        if (input_image.is_empty())
+        {
+            return;
+        }
+
+        const int w = input_image.width();
+        const int h = input_image.height();
+        const int tx = (w + tile_size - 1) / tile_size;
+        const int ty = (h + tile_size - 1) / tile_size;
+        const int channels = input_image.spectrum();
+        const TileTaps cols = tile_taps(w, tx, tile_size);
+        const TileTaps rows = tile_taps(h, ty, tile_size);
+
+        // 1. One clipped-equalization LUT per tile and channel
+        std::vector<unsigned char> luts(static_cast<size_t>(channels) * tx * ty * 256);
+#pragma omp parallel for collapse(3) schedule(static)
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int j = 0; j < ty; ++j)
+            {
+                for (int i = 0; i < tx; ++i)
+                {
+                    const int x0 = i * tile_size, x1 = std::min(w, x0 + tile_size);
+                    const int y0 = j * tile_size, y1 = std::min(h, y0 + tile_size);
+                    uint hist[256] = {};
+                    for (int y = y0; y < y1; ++y)
+                    {
+                        const uint* src = input_image.data(0, y, 0, c);
+                        for (int x = x0; x < x1; ++x)
+                            ++hist[std::min(src[x], 255u)];
+                    }
+
+                    // Clip at the limit and spread the excess evenly, the remainder over every step-th bin
+                    const uint n = static_cast<uint>((x1 - x0) * (y1 - y0));
+                    const uint limit = std::max(1u, static_cast<uint>(clip_limit * n / 256.0f));
+                    uint excess = 0;
+                    for (uint &bin : hist)
+                    {
+                        if (bin > limit)
+                        {
+                            excess += bin - limit;
+                            bin = limit;
+                        }
+                    }
+                    const uint share = excess / 256, rest = excess % 256;
+                    for (int v = 0; v < 256; ++v)
+                        hist[v] += share;
+                    if (rest > 0)
+                    {
+                        for (uint v = 0, step = 256 / rest; v < 256 && v / step < rest; v += step)
+                            ++hist[v];
+                    }
+
+                    unsigned char* lut = luts.data() + ((static_cast<size_t>(c) * ty + j) * tx + i) * 256;
+                    uint cdf = 0;
+                    for (int v = 0; v < 256; ++v)
+                    {
+                        cdf += hist[v];
+                        lut[v] = static_cast<unsigned char>((static_cast<uint64_t>(cdf) * 255 + n / 2) / n);
+                    }
+                }
+            }
+        }
+
+        // 2. Bilinear blend of the four surrounding tile LUTs, weights in 1/256
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int y = 0; y < h; ++y)
+            {
+                const unsigned char* top = luts.data() + (static_cast<size_t>(c) * ty + rows.t0[y]) * tx * 256;
+                const unsigned char* bottom = luts.data() + (static_cast<size_t>(c) * ty + rows.t1[y]) * tx * 256;
+                const uint wy = static_cast<uint>(rows.w1[y]);
+                uint* row = input_image.data(0, y, 0, c);
+                for (int x = 0; x < w; ++x)
+                {
+                    const uint v = std::min(row[x], 255u);
+                    const size_t i0 = static_cast<size_t>(cols.t0[x]) * 256 + v, i1 = static_cast<size_t>(cols.t1[x]) * 256 + v;
+                    const uint wx = static_cast<uint>(cols.w1[x]);
+                    const uint t = top[i0] * (256 - wx) + top[i1] * wx;
+                    const uint b = bottom[i0] * (256 - wx) + bottom[i1] * wx;
+                    row[x] = (t * (256 - wy) + b * wy + 32768) >> 16;
+                }
+            }
+        }
+    }
+
 
 } // namespace ite::color
@@ -4,6 +4,9 @@
  * @brief Contrast enhancement operations.
  */
 
+#include <array>
+#include <cstdint>
+
 #include "CImg.h"
 
 using namespace cimg_library;
@@ -11,6 +14,34 @@ using namespace cimg_library;
 namespace ite::color
 {
 
+    /**
+     * @brief Input range [low, high] that the linear stretch maps to [0, 255].
+     */
+    struct StretchRange
+    {
+        uint low = 0;
+        uint high = 255;
+    };
+
+    /**
+     * @brief Robust stretch range from a 256-bin histogram.
+     *
+     * `low` is the first gray level at which more than `cutoff` samples are at or below it,
+     * `high` the last one with more than `cutoff` samples at or above it.
+     */
+    StretchRange stretch_range(const std::array<uint64_t, 256> &hist, long long cutoff);
+
+    /**
+     * @brief The range contrast_linear_stretch() uses for an image (1% and 99% percentiles).
+     */
+    StretchRange contrast_stretch_range(const CImg<uint> &image);
+
+    /**
+     * @brief Maps [range.low, range.high] linearly to [0, 255] in-place, clipping outside values.
+     * Does nothing if the range is empty (high <= low).
+     */
+    void apply_linear_stretch(CImg<uint> &image, const StretchRange &range);
+
     /**
      * @brief Applies robust linear contrast stretching in-place.
      *
@@ -21,4 +52,18 @@ namespace ite::color
      */
     void contrast_linear_stretch(CImg<uint> &image);
 
+    /**
+     * @brief Contrast-limited adaptive histogram equalization (CLAHE) in-place, channel by channel.
+     *
+     * Every `tile_size` x `tile_size` tile gets an equalization LUT from its histogram, clipped at `clip_limit` times
+     * the mean bin count with the excess spread over all bins. Each pixel blends the LUTs of the four nearest tile
+     * centers bilinearly, so the cost per pixel is constant. Histograms are built in parallel over tiles.
+     *
+     * @param image The image to enhance (values 0-255, modified in-place).
+     * @param tile_size Side of the tiles in pixels (default: 64).
+     * @param clip_limit Histogram clip limit relative to the mean bin count; 1 maps every tile linearly, larger values equalize more (default: 2).
+     * @throws std::invalid_argument if `tile_size` < 8 or `clip_limit` <= 0.
+     */
+    void contrast_clahe(CImg<uint> &image, int tile_size = 64, float clip_limit = 2.0f);
+
 } // namespace ite::color
@@ -1,14 +1,34 @@
 #include "grayscale.h"
+#include <algorithm>
 #include <cmath>
 
 namespace ite::color
 {
 
-    void to_grayscale_rec601(CImg<uint> &input_image)
+    void to_grayscale_rec601(CImg<uint> &input_image, const bool invert)
     {
         if (input_image.spectrum() == 1)
         {
-            return; // Already grayscale
+            // Already grayscale
+            if (invert)
+            {
+#pragma omp parallel for
+                for (long long i = 0; i < static_cast<long long>(input_image.size()); ++i)
+                    input_image[i] = 255u - std::min(input_image[i], 255u);
+            }
+            return;
+        }
+
+        input_image = get_grayscale_rec601(input_image, invert);
+    }
+
+    CImg<uint> get_grayscale_rec601(const CImg<uint> &input_image, const bool invert)
+    {
+        if (input_image.spectrum() == 1)
+        {
+            CImg<uint> copy = input_image;
+            to_grayscale_rec601(copy, invert);
+            return copy;
         }
 
         // Create a new image with the correct 1-channel dimensions
@@ -24,12 +44,13 @@ namespace ite::color
                     uint r = input_image(x, y, z, 0);
                     uint g = input_image(x, y, z, 1);
                     uint b = input_image(x, y, z, 2);
-                    gray_image(x, y, z, 0) = static_cast<uint>(std::round(WEIGHT_R * r + WEIGHT_G * g + WEIGHT_B * b));
+                    const uint luma = static_cast<uint>(std::round(WEIGHT_R * r + WEIGHT_G * g + WEIGHT_B * b));
+                    gray_image(x, y, z, 0) = invert ? 255u - std::min(luma, 255u) : luma;
                 }
             }
         }
 
-        input_image = gray_image;
+        return gray_image;
     }
 
 } // namespace ite::color
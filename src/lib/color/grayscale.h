@@ -29,7 +29,15 @@ namespace ite::color
      * If the image is already 1-channel, no conversion is performed.
      *
      * @param image The image to convert (modified in-place).
+     * @param invert Also invert the result (255 - Y, values clamped to 255 first), in the same pass for color images.
      */
-    void to_grayscale_rec601(CImg<uint> &image);
+    void to_grayscale_rec601(CImg<uint> &image, bool invert = false);
+
+    /**
+     * @brief Returns the Rec. 601 grayscale version of an image (a copy if it is already 1-channel).
+     * @param image The source image.
+     * @param invert Return 255 - Y instead (values clamped to 255 first).
+     */
+    CImg<uint> get_grayscale_rec601(const CImg<uint> &image, bool invert = false);
 
 } // namespace ite::color
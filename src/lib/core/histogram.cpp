@@ -0,0 +1,86 @@
+#include "histogram.h"
+
+#include <algorithm>
+#include <limits>
+
+
+namespace ite::core
+{
+
+    double Histogram::sum() const
+    {
+        uint64_t s = 0;
+        for (int v = 0; v < 256; ++v)
+            s += static_cast<uint64_t>(v) * bins[v];
+        return static_cast<double>(s) + overflow_sum;
+    }
+
+    double Histogram::sum_sq() const
+    {
+        uint64_t s = 0;
+        for (int v = 0; v < 256; ++v)
+            s += static_cast<uint64_t>(v * v) * bins[v];
+        return static_cast<double>(s) + overflow_sum_sq;
+    }
+
+    double Histogram::mean() const { return count ? sum() / static_cast<double>(count) : 0.0; }
+
+    double Histogram::variance() const
+    {
+        if (count < 2)
+            return 0.0;
+        const double S = sum();
+        const auto N = static_cast<double>(count);
+        return (sum_sq() - S * S / N) / (N - 1.0);
+    }
+
+    Histogram compute_histogram(const CImg<uint> &image)
+    {
+        Histogram hist;
+        hist.count = image.size();
+        if (image.is_empty())
+            return hist;
+
+        const uint* data = image.data();
+        const long long n = static_cast<long long>(image.size());
+        uint min_value = std::numeric_limits<uint>::max();
+        uint max_value = 0;
+        uint64_t overflow = 0;
+        double overflow_sum = 0.0, overflow_sum_sq = 0.0;
+
+#pragma omp parallel reduction(min : min_value) reduction(max : max_value) reduction(+ : overflow, overflow_sum, overflow_sum_sq)
+        {
+            std::array<uint64_t, 256> local{};
+#pragma omp for schedule(static)
+            for (long long i = 0; i < n; ++i)
+            {
+                const uint v = data[i];
+                min_value = std::min(min_value, v);
+                max_value = std::max(max_value, v);
+                if (v < 256u)
+                {
+                    local[v]++;
+                }
+                else
+                {
+                    overflow++;
+                    overflow_sum += v;
+                    overflow_sum_sq += static_cast<double>(v) * v;
+                }
+            }
+#pragma omp critical
+            {
+                for (int i = 0; i < 256; ++i)
+                    hist.bins[i] += local[i];
+            }
+        }
+
+        hist.min = min_value;
+        hist.max = max_value;
+        hist.overflow = overflow;
+        hist.overflow_sum = overflow_sum;
+        hist.overflow_sum_sq = overflow_sum_sq;
+        return hist;
+    }
+
+} // namespace ite::core
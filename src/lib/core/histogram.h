@@ -0,0 +1,54 @@
+#pragma once
+/**
+ * @file histogram.h
+ * @brief Parallel gray-level histogram with exact global moments.
+ */
+
+#include <array>
+#include <cstdint>
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::core
+{
+
+    /**
+     * @brief 256-bin histogram of an image plus the quantities derived from it.
+     *
+     * Values above 255 are not binned; they are counted in `overflow` and still contribute
+     * to the moments and the maximum, so the moments are exact for any input.
+     */
+    struct Histogram
+    {
+        std::array<uint64_t, 256> bins{};
+        uint64_t count = 0; ///< Total number of samples (binned + overflow)
+        uint64_t overflow = 0; ///< Number of samples above 255
+        double overflow_sum = 0.0; ///< Sum of the samples above 255
+        double overflow_sum_sq = 0.0; ///< Sum of squares of the samples above 255
+        uint min = 0;
+        uint max = 0;
+
+        /** @brief Sum of all samples. */
+        double sum() const;
+
+        /** @brief Sum of all squared samples. */
+        double sum_sq() const;
+
+        /** @brief Mean of all samples (0 for an empty histogram). */
+        double mean() const;
+
+        /**
+         * @brief Unbiased variance, (S2 - S^2 / N) / (N - 1), the same definition as CImg::variance().
+         */
+        double variance() const;
+    };
+
+    /**
+     * @brief Computes the histogram of all pixels of an image in one parallel pass
+     * (one private histogram per thread, merged at the end).
+     */
+    Histogram compute_histogram(const CImg<uint> &image);
+
+} // namespace ite::core
@@ -0,0 +1,375 @@
+#include "local_stats.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+
+namespace ite::core
+{
+
+    namespace
+    {
+        /**
+         * @brief Number of horizontal bands a streaming row pass is split into.
+         * Each band primes its own running sums, so one band per thread keeps that overhead minimal.
+         */
+        int streaming_band_count(const int height)
+        {
+#ifdef _OPENMP
+            return std::max(1, std::min(height, omp_get_max_threads()));
+#else
+            (void)height;
+            return 1;
+#endif
+        }
+
+        // Number of columns the vertical min/max pass processes together (one vector of lanes per row)
+        constexpr int STRIP_WIDTH = 64;
+
+        struct MinOp
+        {
+            static constexpr uint identity = std::numeric_limits<uint>::max();
+            uint operator()(const uint a, const uint b) const { return std::min(a, b); }
+        };
+
+        struct MaxOp
+        {
+            static constexpr uint identity = 0u;
+            uint operator()(const uint a, const uint b) const { return std::max(a, b); }
+        };
+
+        /**
+         * @brief (Internal) 1D running min/max of radius r along n elements of `lanes` independent lines.
+         * Element i of lane l is src[i * step + l]; positions outside [0, n) are ignored (clipped window).
+         * Radii <= 1 are scanned directly, larger ones use van Herk/Gil-Werman block prefix/suffix buffers.
+         */
+        template <typename Op>
+        void running_extremum(const uint* src, const std::ptrdiff_t src_step, uint* dst, const std::ptrdiff_t dst_step, const int n, const int lanes,
+                              const int r, std::vector<uint> &forward, std::vector<uint> &backward)
+        {
+            const Op op;
+
+            if (r <= 1)
+            {
+                for (int i = 0; i < n; ++i)
+                {
+                    const int lo = std::max(0, i - r);
+                    const int hi = std::min(n - 1, i + r);
+                    uint* out = dst + i * dst_step;
+                    std::copy(src + lo * src_step, src + lo * src_step + lanes, out);
+                    for (int j = lo + 1; j <= hi; ++j)
+                    {
+                        const uint* in = src + j * src_step;
+                        for (int l = 0; l < lanes; ++l)
+                            out[l] = op(out[l], in[l]);
+                    }
+                }
+                return;
+            }
+
+            // Padded sequence: r identity elements on both sides, split into blocks of the window length k
+            const int k = 2 * r + 1;
+            const int padded = n + 2 * r;
+            forward.resize(static_cast<size_t>(padded) * lanes);
+            backward.resize(static_cast<size_t>(padded) * lanes);
+
+            auto value = [&](const int p, const int l) { return (p >= r && p < r + n) ? src[(p - r) * src_step + l] : Op::identity; };
+
+            // forward[p]: extremum from the start of p's block up to p
+            for (int p = 0; p < padded; ++p)
+            {
+                uint* f = forward.data() + static_cast<size_t>(p) * lanes;
+                if (p % k == 0)
+                {
+                    for (int l = 0; l < lanes; ++l)
+                        f[l] = value(p, l);
+                }
+                else
+                {
+                    const uint* prev = f - lanes;
+                    for (int l = 0; l < lanes; ++l)
+                        f[l] = op(prev[l], value(p, l));
+                }
+            }
+
+            // backward[p]: extremum from p up to the end of p's block
+            for (int p = padded - 1; p >= 0; --p)
+            {
+                uint* b = backward.data() + static_cast<size_t>(p) * lanes;
+                if (p == padded - 1 || (p + 1) % k == 0)
+                {
+                    for (int l = 0; l < lanes; ++l)
+                        b[l] = value(p, l);
+                }
+                else
+                {
+                    const uint* next = b + lanes;
+                    for (int l = 0; l < lanes; ++l)
+                        b[l] = op(next[l], value(p, l));
+                }
+            }
+
+            // The window [p, p + 2r] spans at most two blocks
+            for (int i = 0; i < n; ++i)
+            {
+                const uint* b = backward.data() + static_cast<size_t>(i) * lanes;
+                const uint* f = forward.data() + static_cast<size_t>(i + 2 * r) * lanes;
+                uint* out = dst + i * dst_step;
+                for (int l = 0; l < lanes; ++l)
+                    out[l] = op(b[l], f[l]);
+            }
+        }
+
+        /**
+         * @brief (Internal) Separable rectangular min/max filter: horizontal pass per row, vertical pass per column strip.
+         */
+        template <typename Op>
+        CImg<uint> separable_extremum(const CImg<uint> &image, const LocalWindow window)
+        {
+            const int w = image.width();
+            const int h = image.height();
+            const int planes = image.depth() * image.spectrum();
+
+            CImg<uint> horizontal(w, h, image.depth(), image.spectrum());
+            CImg<uint> result(w, h, image.depth(), image.spectrum());
+            if (image.is_empty())
+            {
+                return result;
+            }
+
+#pragma omp parallel
+            {
+                std::vector<uint> forward, backward;
+
+#pragma omp for collapse(2) schedule(static)
+                for (int p = 0; p < planes; ++p)
+                {
+                    for (int y = 0; y < h; ++y)
+                    {
+                        const size_t offset = (static_cast<size_t>(p) * h + y) * w;
+                        running_extremum<Op>(image.data() + offset, 1, horizontal.data() + offset, 1, w, 1, window.half_width, forward, backward);
+                    }
+                }
+
+                const int strips = (w + STRIP_WIDTH - 1) / STRIP_WIDTH;
+#pragma omp for collapse(2) schedule(static)
+                for (int p = 0; p < planes; ++p)
+                {
+                    for (int s = 0; s < strips; ++s)
+                    {
+                        const int x0 = s * STRIP_WIDTH;
+                        const int lanes = std::min(STRIP_WIDTH, w - x0);
+                        const size_t offset = static_cast<size_t>(p) * h * w + x0;
+                        running_extremum<Op>(horizontal.data() + offset, w, result.data() + offset, w, h, lanes, window.half_height, forward, backward);
+                    }
+                }
+            }
+
+            return result;
+        }
+    } // namespace
+
+    LocalStats::LocalStats(const CImg<uint> &image, std::vector<LocalWindow> windows, const unsigned stats)
+        : image_(image), windows_(std::move(windows)), stats_(stats)
+    {
+        if (windows_.empty())
+        {
+            throw std::invalid_argument("LocalStats requires at least one window.");
+        }
+        for (const LocalWindow &window : windows_)
+        {
+            if (window.half_width < 0 || window.half_height < 0)
+            {
+                throw std::invalid_argument("LocalStats window half sizes must be non-negative.");
+            }
+        }
+
+        for (const LocalWindow &window : windows_)
+        {
+            if (stats_ & LOCAL_MIN)
+                min_maps_.push_back(local_min(image_, window));
+            if (stats_ & LOCAL_MAX)
+                max_maps_.push_back(local_max(image_, window));
+        }
+    }
+
+    void LocalStats::for_each_row(const RowCallback &fn) const
+    {
+        const int w = image_.width();
+        const int h = image_.height();
+        const int d = image_.depth();
+        const int s = image_.spectrum();
+        if (image_.is_empty())
+        {
+            return;
+        }
+
+        const bool want_moments = (stats_ & (LOCAL_MEAN | LOCAL_STD_DEV)) != 0;
+        const bool want_std = (stats_ & LOCAL_STD_DEV) != 0;
+        const int bands = streaming_band_count(h);
+        const size_t n_windows = windows_.size();
+
+        // Windows with the same height share one set of column sums
+        std::vector<int> heights;
+        std::vector<size_t> column_set(n_windows);
+        for (size_t i = 0; i < n_windows; ++i)
+        {
+            const auto it = std::find(heights.begin(), heights.end(), windows_[i].half_height);
+            column_set[i] = static_cast<size_t>(it - heights.begin());
+            if (it == heights.end())
+                heights.push_back(windows_[i].half_height);
+        }
+        const size_t n_sets = heights.size();
+
+#pragma omp parallel for collapse(3) schedule(static)
+        for (int c = 0; c < s; ++c)
+        {
+            for (int z = 0; z < d; ++z)
+            {
+                for (int b = 0; b < bands; ++b)
+                {
+                    const int y_begin = static_cast<int>(static_cast<int64_t>(h) * b / bands);
+                    const int y_end = static_cast<int>(static_cast<int64_t>(h) * (b + 1) / bands);
+                    if (y_begin >= y_end)
+                    {
+                        continue;
+                    }
+
+                    // Per column set: sums (and sums of squares) of the rows currently covered by the window,
+                    // and their prefix sums along the row
+                    std::vector<std::vector<uint64_t>> col_sum(n_sets), col_sq(n_sets), row_sum(n_sets), row_sq(n_sets);
+                    std::vector<std::vector<double>> mean(n_windows), std_dev(n_windows);
+                    std::vector<LocalStatsRow> rows(n_windows, LocalStatsRow{nullptr, nullptr, nullptr, nullptr});
+
+                    if (want_moments)
+                    {
+                        for (size_t i = 0; i < n_sets; ++i)
+                        {
+                            col_sum[i].assign(w, 0);
+                            col_sq[i].assign(w, 0);
+                            row_sum[i].assign(w + 1, 0);
+                            row_sq[i].assign(w + 1, 0);
+                        }
+                        for (size_t i = 0; i < n_windows; ++i)
+                        {
+                            mean[i].resize(w);
+                            std_dev[i].resize(w);
+                        }
+                    }
+
+                    auto update_row = [&](const size_t set, const int yy, const bool add)
+                    {
+                        const uint* row = image_.data(0, yy, z, c);
+                        uint64_t* sum = col_sum[set].data();
+                        uint64_t* sq = col_sq[set].data();
+                        if (add)
+                        {
+                            for (int x = 0; x < w; ++x)
+                            {
+                                const uint64_t v = row[x];
+                                sum[x] += v;
+                                sq[x] += v * v;
+                            }
+                        }
+                        else
+                        {
+                            for (int x = 0; x < w; ++x)
+                            {
+                                const uint64_t v = row[x];
+                                sum[x] -= v;
+                                sq[x] -= v * v;
+                            }
+                        }
+                    };
+
+                    // Prime the column sums with the full window of the first row in this band
+                    if (want_moments)
+                    {
+                        for (size_t i = 0; i < n_sets; ++i)
+                        {
+                            for (int yy = std::max(0, y_begin - heights[i]); yy <= std::min(h - 1, y_begin + heights[i]); ++yy)
+                                update_row(i, yy, true);
+                        }
+                    }
+
+                    for (int y = y_begin; y < y_end; ++y)
+                    {
+                        if (want_moments)
+                        {
+                            for (size_t i = 0; i < n_sets; ++i)
+                            {
+                                const int r = heights[i];
+                                if (y > y_begin)
+                                {
+                                    if (y + r < h)
+                                        update_row(i, y + r, true);
+                                    if (y - r - 1 >= 0)
+                                        update_row(i, y - r - 1, false);
+                                }
+
+                                uint64_t* rs = row_sum[i].data();
+                                uint64_t* rq = row_sq[i].data();
+                                const uint64_t* cs = col_sum[i].data();
+                                const uint64_t* cq = col_sq[i].data();
+                                for (int x = 0; x < w; ++x)
+                                {
+                                    rs[x + 1] = rs[x] + cs[x];
+                                    rq[x + 1] = rq[x] + cq[x];
+                                }
+                            }
+
+                            for (size_t i = 0; i < n_windows; ++i)
+                            {
+                                const int rx = windows_[i].half_width;
+                                const int ry = windows_[i].half_height;
+                                const uint64_t* rs = row_sum[column_set[i]].data();
+                                const uint64_t* rq = row_sq[column_set[i]].data();
+                                const int rows_in_window = std::min(h - 1, y + ry) - std::max(0, y - ry) + 1;
+                                double* m = mean[i].data();
+                                double* sd = std_dev[i].data();
+
+                                for (int x = 0; x < w; ++x)
+                                {
+                                    const int x1 = std::max(0, x - rx);
+                                    const int x2 = std::min(w - 1, x + rx);
+
+                                    const double N = (x2 - x1 + 1) * rows_in_window; // Number of pixels in window
+                                    const auto sum = static_cast<double>(rs[x2 + 1] - rs[x1]);
+                                    m[x] = sum / N;
+                                    if (want_std)
+                                    {
+                                        const auto sum_sq = static_cast<double>(rq[x2 + 1] - rq[x1]);
+                                        sd[x] = std::sqrt(std::max(0.0, (sum_sq / N) - (m[x] * m[x])));
+                                    }
+                                }
+
+                                rows[i].mean = (stats_ & LOCAL_MEAN) ? m : nullptr;
+                                rows[i].std_dev = want_std ? sd : nullptr;
+                            }
+                        }
+
+                        for (size_t i = 0; i < n_windows; ++i)
+                        {
+                            rows[i].min = (stats_ & LOCAL_MIN) ? min_maps_[i].data(0, y, z, c) : nullptr;
+                            rows[i].max = (stats_ & LOCAL_MAX) ? max_maps_[i].data(0, y, z, c) : nullptr;
+                        }
+
+                        fn(y, z, c, rows.data());
+                    }
+                }
+            }
+        }
+    }
+
+    CImg<uint> local_min(const CImg<uint> &image, const LocalWindow window) { return separable_extremum<MinOp>(image, window); }
+
+    CImg<uint> local_max(const CImg<uint> &image, const LocalWindow window) { return separable_extremum<MaxOp>(image, window); }
+
+} // namespace ite::core
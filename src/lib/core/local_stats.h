@@ -0,0 +1,105 @@
+#pragma once
+/**
+ * @file local_stats.h
+ * @brief Windowed local statistics (mean, std. deviation, min, max) over rectangular windows.
+ */
+
+#include <functional>
+#include <vector>
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::core
+{
+
+    /**
+     * @brief Rectangular window centered on a pixel.
+     * Covers [x - half_width, x + half_width] x [y - half_height, y + half_height], clipped to the image.
+     */
+    struct LocalWindow
+    {
+        int half_width;
+        int half_height;
+    };
+
+    /**
+     * @brief Statistics that can be requested from LocalStats (combine with |).
+     */
+    enum LocalStat : unsigned
+    {
+        LOCAL_MEAN = 1u << 0,
+        LOCAL_STD_DEV = 1u << 1,
+        LOCAL_MIN = 1u << 2,
+        LOCAL_MAX = 1u << 3,
+    };
+
+    /**
+     * @brief One row of statistics for one window. Pointers of statistics that were not requested are null.
+     */
+    struct LocalStatsRow
+    {
+        const double* mean;
+        const double* std_dev;
+        const uint* min;
+        const uint* max;
+    };
+
+    /**
+     * @brief Local statistics engine for one image and a set of windows.
+     *
+     * Mean and std. deviation are streamed from sliding column sums (exact integer sums, O(1) per pixel
+     * independent of the window size, O(width) memory per thread). All windows are served by a single
+     * sweep over the image; windows with the same height share their column sums.
+     * Min and max use the separable van Herk/Gil-Werman filter (3 comparisons per pixel and axis),
+     * or a direct scan for radii <= 1.
+     *
+     * Mean and std. deviation are computed as mean = sum / N and std = sqrt(max(0, sum_sq / N - mean^2))
+     * with N the number of pixels in the clipped window, i.e. bit-identical to the integral-image formulation.
+     */
+    class LocalStats
+    {
+    public:
+        /**
+         * @brief Called once per image row with one LocalStatsRow per requested window (in request order).
+         * Rows are delivered concurrently from several threads, so the callback must only write row-local data.
+         */
+        using RowCallback = std::function<void(int y, int z, int c, const LocalStatsRow* rows)>;
+
+        /**
+         * @brief Prepares the statistics of `image` for the given windows.
+         * Min/max maps are computed here; mean/std are computed on the fly by for_each_row().
+         * @param image Source image (must outlive this object).
+         * @param windows The windows to evaluate.
+         * @param stats Combination of LocalStat flags (default: mean and std. deviation).
+         * @throws std::invalid_argument if no window is given or a window has a negative half size.
+         */
+        LocalStats(const CImg<uint> &image, std::vector<LocalWindow> windows, unsigned stats = LOCAL_MEAN | LOCAL_STD_DEV);
+
+        /**
+         * @brief Sweeps the image once and hands the statistics of every row to `fn` (in parallel).
+         */
+        void for_each_row(const RowCallback &fn) const;
+
+        const std::vector<LocalWindow> &windows() const { return windows_; }
+
+    private:
+        const CImg<uint> &image_;
+        std::vector<LocalWindow> windows_;
+        unsigned stats_;
+        std::vector<CImg<uint>> min_maps_;
+        std::vector<CImg<uint>> max_maps_;
+    };
+
+    /**
+     * @brief Minimum over the window around every pixel (grayscale erosion with a rectangular element).
+     */
+    CImg<uint> local_min(const CImg<uint> &image, LocalWindow window);
+
+    /**
+     * @brief Maximum over the window around every pixel (grayscale dilation with a rectangular element).
+     */
+    CImg<uint> local_max(const CImg<uint> &image, LocalWindow window);
+
+} // namespace ite::core
@@ -0,0 +1,72 @@
+#include "pyramid.h"
+
+#include <algorithm>
+
+
+namespace ite::core
+{
+
+    CImg<uint> downsample_2x(const CImg<uint> &image)
+    {
+        const int w = image.width();
+        const int h = image.height();
+        const int out_w = (w + 1) / 2;
+        const int out_h = (h + 1) / 2;
+        const int channels = image.spectrum();
+        CImg<uint> output(out_w, out_h, 1, channels);
+
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int y = 0; y < out_h; ++y)
+            {
+                const uint* row0 = image.data(0, 2 * y, 0, c);
+                const uint* row1 = (2 * y + 1 < h) ? image.data(0, 2 * y + 1, 0, c) : row0;
+                const uint rows = (2 * y + 1 < h) ? 2u : 1u;
+                uint* dst = output.data(0, y, 0, c);
+
+                for (int x = 0; x < w / 2; ++x)
+                {
+                    const uint sum = row0[2 * x] + row0[2 * x + 1] + (rows == 2 ? row1[2 * x] + row1[2 * x + 1] : 0u);
+                    const uint n = 2 * rows;
+                    dst[x] = (sum + n / 2) / n;
+                }
+                if (w % 2 != 0)
+                {
+                    const uint sum = row0[w - 1] + (rows == 2 ? row1[w - 1] : 0u);
+                    dst[out_w - 1] = (sum + rows / 2) / rows;
+                }
+            }
+        }
+        return output;
+    }
+
+    Pyramid::Pyramid(const CImg<uint> &image, const int min_long_side) : base_width_(image.width()), base_height_(image.height())
+    {
+        const CImg<uint>* current = &image;
+        while (std::max((current->width() + 1) / 2, (current->height() + 1) / 2) >= std::max(1, min_long_side) && std::max(current->width(), current->height()) > 1)
+        {
+            levels_.push_back(downsample_2x(*current));
+            current = &levels_.back();
+        }
+    }
+
+    const CImg<uint>* Pyramid::find(const int min_long_side) const
+    {
+        const CImg<uint>* best = nullptr;
+        for (const auto &level : levels_)
+        {
+            if (std::max(level.width(), level.height()) < min_long_side)
+                break;
+            best = &level;
+        }
+        return best;
+    }
+
+    void Pyramid::apply(const std::function<void(CImg<uint> &)> &op)
+    {
+        for (auto &level : levels_)
+            op(level);
+    }
+
+} // namespace ite::core
@@ -0,0 +1,70 @@
+#pragma once
+/**
+ * @file pyramid.h
+ * @brief Image pyramid of 2x box-downsampled levels for analysis passes.
+ */
+
+#include <functional>
+#include <vector>
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::core
+{
+
+    /**
+     * @brief Downsampled copies of an image, each half the size of the previous one.
+     *
+     * Every level averages 2x2 blocks of the previous one (an odd last row or column averages the pixels it has),
+     * computed in parallel. Analysis steps that only need global or coarse information (skew proxy, histogram
+     * classification) read the smallest level that is large enough instead of the full-resolution image.
+     * The full-resolution image itself is not stored; all levels together hold about a third of its pixels.
+     */
+    class Pyramid
+    {
+    public:
+        /**
+         * @brief Builds the levels of `image` down to the last one whose long side is at least `min_long_side`.
+         * @param image Source image (any number of channels).
+         * @param min_long_side Long side below which no further level is built (default: 256).
+         */
+        explicit Pyramid(const CImg<uint> &image, int min_long_side = 256);
+
+        /** @brief Number of downsampled levels (level i has 1/2^i of the source size, i = 1..levels()). */
+        int levels() const { return static_cast<int>(levels_.size()); }
+
+        /** @brief Downsampled level `i` (1 = half size). */
+        const CImg<uint> &level(int i) const { return levels_[static_cast<size_t>(i - 1)]; }
+
+        /** @brief Width of the image the pyramid was built from. */
+        int base_width() const { return base_width_; }
+
+        /** @brief Height of the image the pyramid was built from. */
+        int base_height() const { return base_height_; }
+
+        /**
+         * @brief The smallest level whose long side is at least `min_long_side`.
+         * @return The level, or null if only the full-resolution image is large enough.
+         */
+        const CImg<uint>* find(int min_long_side) const;
+
+        /**
+         * @brief Applies a pointwise operation (e.g. a contrast stretch) to every level,
+         * so the pyramid keeps approximating the image the operation was applied to.
+         */
+        void apply(const std::function<void(CImg<uint> &)> &op);
+
+    private:
+        std::vector<CImg<uint>> levels_;
+        int base_width_ = 0;
+        int base_height_ = 0;
+    };
+
+    /**
+     * @brief Halves an image by averaging 2x2 blocks (rounded), in parallel over rows.
+     */
+    CImg<uint> downsample_2x(const CImg<uint> &image);
+
+} // namespace ite::core
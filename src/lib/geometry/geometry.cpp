@@ -1,9 +1,12 @@
 #include "geometry.h"
 #include <algorithm>
 #include <cmath>
+#include <map>
 #include <utility>
+#include <vector>
 #include "../binarization/binarization.h"
 #include "../core/utils.h"
+#include "resample.h"
 
 using namespace ite::utils;
 
@@ -38,66 +41,144 @@ namespace ite::geometry
         return sum_sq * invH - mean * mean;
     }
 
-    static std::pair<double, double> search_best_angle(const CImg<unsigned char> &bin, int roi_x0, int roi_y0, int roi_w, int roi_h, double start_deg,
-                                                       double end_deg, double step_deg)
+    /**
+     * @brief Projection-profile scores of one proxy, cached by angle, within an optional budget of evaluations.
+     */
+    class AngleScorer
     {
-        if (step_deg <= 0.0)
-            return {0.0, -1.0};
-        if (end_deg < start_deg)
-            std::swap(start_deg, end_deg);
+    public:
+        AngleScorer(const CImg<unsigned char> &bin, int roi_x0, int roi_y0, int roi_w, int roi_h, int max_evaluations)
+            : bin_(bin), roi_x0_(roi_x0), roi_y0_(roi_y0), roi_w_(roi_w), roi_h_(roi_h), max_evaluations_(max_evaluations)
+        {
+        }
 
-        const int N = static_cast<int>(std::floor((end_deg - start_deg) / step_deg)) + 1;
-        double best_angle = 0.0;
-        double best_score = -1.0;
+        int evaluations() const { return static_cast<int>(scores_.size()); }
 
-#pragma omp parallel
+        bool exhausted() const { return max_evaluations_ > 0 && evaluations() >= max_evaluations_; }
+
+        /** @brief Score of `angle`; -1 if it was not scored yet and the budget is used up. */
+        double score(const double angle)
         {
-            double local_best_a = 0.0;
-            double local_best_s = -1.0;
+            const auto it = scores_.find(key(angle));
+            if (it != scores_.end())
+                return it->second;
+            if (exhausted())
+                return -1.0;
+            const double s = score_angle_variance(bin_, roi_x0_, roi_y0_, roi_w_, roi_h_, angle);
+            scores_.emplace(key(angle), s);
+            return s;
+        }
 
-#pragma omp for schedule(static) nowait
+        /**
+         * @brief Scores the angles start, start + step, ..., end in parallel.
+         * With a budget, the angles closest to 0 are scored first and the rest is skipped once it is used up.
+         */
+        void grid(double start, double end, const double step)
+        {
+            if (step <= 0.0)
+                return;
+            if (end < start)
+                std::swap(start, end);
+
+            const int N = static_cast<int>(std::floor((end - start) / step + 1e-9)) + 1;
+            std::vector<double> angles;
             for (int i = 0; i < N; ++i)
             {
-                const double a = start_deg + static_cast<double>(i) * step_deg;
-                const double s = score_angle_variance(bin, roi_x0, roi_y0, roi_w, roi_h, a);
-                if (s > local_best_s)
-                {
-                    local_best_s = s;
-                    local_best_a = a;
-                }
+                const double a = start + static_cast<double>(i) * step;
+                if (scores_.find(key(a)) == scores_.end())
+                    angles.push_back(a);
+            }
+            if (max_evaluations_ > 0)
+            {
+                std::stable_sort(angles.begin(), angles.end(), [](const double x, const double y) { return std::abs(x) < std::abs(y); });
+                angles.resize(std::min(angles.size(), static_cast<size_t>(std::max(0, max_evaluations_ - evaluations()))));
             }
 
-#pragma omp critical
+            std::vector<double> values(angles.size());
+#pragma omp parallel for schedule(static)
+            for (int i = 0; i < static_cast<int>(angles.size()); ++i)
+                values[static_cast<size_t>(i)] = score_angle_variance(bin_, roi_x0_, roi_y0_, roi_w_, roi_h_, angles[static_cast<size_t>(i)]);
+            for (size_t i = 0; i < angles.size(); ++i)
+                scores_.emplace(key(angles[i]), values[i]);
+        }
+
+        /** @brief The best scored angle and its score (the smallest angle among equal scores). */
+        std::pair<double, double> best() const
+        {
+            std::pair<double, double> result{0.0, -1.0};
+            for (const auto &[k, s] : scores_)
             {
-                if (local_best_s > best_score)
-                {
-                    best_score = local_best_s;
-                    best_angle = local_best_a;
-                }
+                if (s > result.second)
+                    result = {static_cast<double>(k) / ANGLE_KEY_SCALE, s};
             }
+            return result;
         }
 
-        return {best_angle, best_score};
-    }
+    private:
+        static constexpr double ANGLE_KEY_SCALE = 1e4; // angles equal to 1e-4 degrees share a score
+
+        static long long key(const double angle) { return std::llround(angle * ANGLE_KEY_SCALE); }
+
+        const CImg<unsigned char> &bin_;
+        int roi_x0_, roi_y0_, roi_w_, roi_h_;
+        int max_evaluations_;
+        std::map<long long, double> scores_;
+    };
+
+    // Long side of the binary proxy that deskew and content detection work on
+    constexpr double PROXY_LONG_SIDE = 600.0;
 
-    void deskew_projection_profile(CImg<uint> &input_image, int boundary_conditions, int window_size, float k, float delta)
+    // Dark scanner borders are stripped only up to this fraction of the image per side
+    constexpr double MAX_BORDER_FRACTION = 0.25;
+
+    // Orientation: the turned profile must be this much clearer to call a page sideways
+    constexpr double SIDEWAYS_CONTRAST_RATIO = 1.3;
+
+    // Orientation: fewer text lines than this, or a weaker ascender/descender asymmetry, keep a page as it is
+    constexpr int MIN_ORIENTATION_LINES = 3;
+    constexpr double MIN_LINE_ASYMMETRY = 0.1;
+
+    // Docstrum: neighbours per component and the minimum number of components
+    constexpr int DOCSTRUM_NEIGHBOURS = 5;
+    constexpr int DOCSTRUM_MIN_COMPONENTS = 8;
+
+    // Skew corrections are searched (projection profile) or accepted (docstrum) within +-MAX_SKEW degrees
+    constexpr double MAX_SKEW = 15.0;
+
+    // Smaller skew corrections are not applied
+    constexpr double MIN_SKEW = 0.05;
+
+    // Angle search: coarse grid step, and the neighbours of 0 degrees compared for the early exit
+    constexpr double COARSE_STEP = 1.0;
+    constexpr double EARLY_EXIT_STEP = 0.1;
+
+    /**
+     * @brief Downscaled grayscale copy of an image and its Sauvola binarization (1 = foreground, the minority class).
+     */
+    struct BinaryProxy
+    {
+        CImg<uint> gray;
+        CImg<unsigned char> bin;
+        double scale = 1.0; ///< Proxy size / image size
+    };
+
+    static BinaryProxy make_binary_proxy(const CImg<uint> &input_image, int window_size, float k, float delta, const core::Pyramid* pyramid)
     {
         const int inW = input_image.width();
         const int inH = input_image.height();
-        if (inW <= 1 || inH <= 1)
-            return;
 
         // Downscale for speed
-        constexpr double target_long = 600.0;
         const int long_side = std::max(inW, inH);
-        double scale = target_long / static_cast<double>(long_side);
+        double scale = PROXY_LONG_SIDE / static_cast<double>(long_side);
         if (scale > 1.0)
             scale = 1.0;
 
         int new_w = std::max(1, static_cast<int>(std::lround(inW * scale)));
         int new_h = std::max(1, static_cast<int>(std::lround(inH * scale)));
 
-        CImg<uint> small = input_image.get_resize(new_w, new_h, 1, input_image.spectrum());
+        // The smallest pyramid level that still covers the proxy saves reading the full-resolution image
+        const CImg<uint>* level = pyramid ? pyramid->find(std::max(new_w, new_h)) : nullptr;
+        CImg<uint> small = resize_area(level ? *level : input_image, new_w, new_h);
 
         // Convert to grayscale (as CImg<uint> for Sauvola)
         CImg<uint> gray(new_w, new_h, 1, 1);
@@ -122,6 +203,10 @@ namespace ite::geometry
                     gray(x, y) = clamp_to_u8(small(x, y, 0, 0));
         }
 
+        BinaryProxy proxy;
+        proxy.gray = gray;
+        proxy.scale = scale;
+
         // Binarize with Sauvola
         binarization::binarize_sauvola(gray, window_size, k, delta);
 
@@ -147,41 +232,183 @@ namespace ite::geometry
                     pb[i] = static_cast<unsigned char>(1u - pb[i]);
             }
         }
+        proxy.bin = bin;
+        return proxy;
+    }
 
-        // Crop to content
-        int minx = new_w, miny = new_h, maxx = -1, maxy = -1;
+    /**
+     * @brief Bounding box of the foreground pixels of `bin` inside `within` (empty if there are none).
+     */
+    static Box foreground_bounds(const CImg<unsigned char> &bin, const Box &within)
+    {
+        Box box{within.x1 + 1, within.y1 + 1, -1, -1};
+        for (int y = within.y0; y <= within.y1; ++y)
         {
-            const unsigned char* pb = bin.data();
-            for (int y = 0; y < new_h; ++y)
+            const unsigned char* row = bin.data() + static_cast<size_t>(y) * bin.width();
+            for (int x = within.x0; x <= within.x1; ++x)
             {
-                const unsigned char* row = pb + y * new_w;
-                for (int x = 0; x < new_w; ++x)
+                if (row[x])
                 {
-                    if (row[x])
-                    {
-                        minx = std::min(minx, x);
-                        miny = std::min(miny, y);
-                        maxx = std::max(maxx, x);
-                        maxy = std::max(maxy, y);
-                    }
+                    box.x0 = std::min(box.x0, x);
+                    box.y0 = std::min(box.y0, y);
+                    box.x1 = std::max(box.x1, x);
+                    box.y1 = std::max(box.y1, y);
                 }
             }
         }
+        return box;
+    }
 
-        if (maxx < 0 || maxy < 0)
-            return;
+    /**
+     * @brief Strips dark bands (scanner lids, shadows) from the edges of a light page.
+     * A row or column belongs to a band if most of its pixels are darker than half the page's median.
+     */
+    static Box strip_dark_borders(const CImg<uint> &gray)
+    {
+        const int w = gray.width();
+        const int h = gray.height();
+        Box box{0, 0, w - 1, h - 1};
+
+        std::vector<uint> values(gray.data(), gray.data() + gray.size());
+        std::nth_element(values.begin(), values.begin() + values.size() / 2, values.end());
+        const uint median = values[values.size() / 2];
+        if (median < 96)
+            return box; // dark page: no light content to separate from dark borders
+
+        const uint dark = median / 2;
+        auto dark_row = [&](const int y)
+        {
+            int n = 0;
+            for (int x = box.x0; x <= box.x1; ++x)
+                n += gray(x, y) < dark;
+            return n * 5 > (box.x1 - box.x0 + 1) * 3;
+        };
+        auto dark_column = [&](const int x)
+        {
+            int n = 0;
+            for (int y = box.y0; y <= box.y1; ++y)
+                n += gray(x, y) < dark;
+            return n * 5 > (box.y1 - box.y0 + 1) * 3;
+        };
+
+        // Rows first, then columns measured between the remaining rows
+        const int max_y = static_cast<int>(h * MAX_BORDER_FRACTION);
+        while (box.y0 < max_y && dark_row(box.y0))
+            ++box.y0;
+        while (box.y1 > h - 1 - max_y && dark_row(box.y1))
+            --box.y1;
+        const int max_x = static_cast<int>(w * MAX_BORDER_FRACTION);
+        while (box.x0 < max_x && dark_column(box.x0))
+            ++box.x0;
+        while (box.x1 > w - 1 - max_x && dark_column(box.x1))
+            --box.x1;
+
+        // Guard band: the soft edge between a border and the page must not count as ink
+        constexpr int guard = 2;
+        if (box.y0 > 0)
+            box.y0 = std::min(box.y0 + guard, max_y);
+        if (box.y1 < h - 1)
+            box.y1 = std::max(box.y1 - guard, h - 1 - max_y);
+        if (box.x0 > 0)
+            box.x0 = std::min(box.x0 + guard, max_x);
+        if (box.x1 < w - 1)
+            box.x1 = std::max(box.x1 - guard, w - 1 - max_x);
+        return box;
+    }
 
-        const int margin = std::max(2, static_cast<int>(std::lround(0.02 * std::min(new_w, new_h))));
-        minx = std::max(0, minx - margin);
-        miny = std::max(0, miny - margin);
-        maxx = std::min(new_w - 1, maxx + margin);
-        maxy = std::min(new_h - 1, maxy + margin);
+    Box detect_content_bounds(const CImg<uint> &image, const core::Pyramid* pyramid)
+    {
+        const int inW = image.width();
+        const int inH = image.height();
+        const Box whole{0, 0, inW - 1, inH - 1};
+        if (inW <= 8 || inH <= 8)
+            return whole;
+
+        const BinaryProxy proxy = make_binary_proxy(image, 15, 0.2f, 0.0f, pyramid);
+        const int pw = proxy.bin.width();
+        const int ph = proxy.bin.height();
+
+        const Box page = strip_dark_borders(proxy.gray);
+        Box ink = foreground_bounds(proxy.bin, page);
+        if (ink.empty())
+            ink = page;
+
+        // Same margin as the deskew crop, kept inside the borders
+        const int margin = std::max(2, static_cast<int>(std::lround(0.02 * std::min(pw, ph))));
+        ink.x0 = std::max(page.x0, ink.x0 - margin);
+        ink.y0 = std::max(page.y0, ink.y0 - margin);
+        ink.x1 = std::min(page.x1, ink.x1 + margin);
+        ink.y1 = std::min(page.y1, ink.y1 + margin);
+
+        // Back to image pixels, rounding outwards
+        const double inv = 1.0 / proxy.scale;
+        Box box;
+        box.x0 = std::clamp(static_cast<int>(std::floor(ink.x0 * inv)), 0, inW - 1);
+        box.y0 = std::clamp(static_cast<int>(std::floor(ink.y0 * inv)), 0, inH - 1);
+        box.x1 = std::clamp(static_cast<int>(std::ceil((ink.x1 + 1) * inv)) - 1, box.x0, inW - 1);
+        box.y1 = std::clamp(static_cast<int>(std::ceil((ink.y1 + 1) * inv)) - 1, box.y0, inH - 1);
+        return box;
+    }
 
-        CImg<unsigned char> work = bin.get_crop(minx, miny, maxx, maxy);
+    /**
+     * @brief Result of the skew search on a binary proxy.
+     */
+    struct SkewSearch
+    {
+        double angle = 0.0; ///< Correction in degrees, 0 if the improvement is not significant
+        double contrast = 0.0; ///< Best profile variance relative to the squared mean row sum (how clearly the rows form text lines)
+        int evaluations = 0; ///< Number of scored angles
+    };
+
+    // Maximum of a unimodal score on [lo, hi] by golden-section or ternary search, down to MIN_SKEW wide brackets
+    static void section_search(AngleScorer &scorer, double lo, double hi, const AngleSearch strategy)
+    {
+        if (strategy == AngleSearch::Golden)
+        {
+            const double inv_phi = (std::sqrt(5.0) - 1.0) / 2.0;
+            double c = hi - inv_phi * (hi - lo);
+            double d = lo + inv_phi * (hi - lo);
+            double sc = scorer.score(c);
+            double sd = scorer.score(d);
+            while (hi - lo > MIN_SKEW && !scorer.exhausted())
+            {
+                if (sc >= sd)
+                {
+                    hi = d;
+                    d = c;
+                    sd = sc;
+                    c = hi - inv_phi * (hi - lo);
+                    sc = scorer.score(c);
+                }
+                else
+                {
+                    lo = c;
+                    c = d;
+                    sc = sd;
+                    d = lo + inv_phi * (hi - lo);
+                    sd = scorer.score(d);
+                }
+            }
+        }
+        else
+        {
+            while (hi - lo > MIN_SKEW && !scorer.exhausted())
+            {
+                const double m1 = lo + (hi - lo) / 3.0;
+                const double m2 = hi - (hi - lo) / 3.0;
+                if (scorer.score(m1) >= scorer.score(m2))
+                    hi = m2;
+                else
+                    lo = m1;
+            }
+        }
+    }
+
+    // Score and angle search on the central 80% of the proxy; the text lines must beat the unrotated profile
+    static SkewSearch search_skew(const CImg<unsigned char> &work, const AngleSearchOptions &options)
+    {
         const int W = work.width();
         const int H = work.height();
-        if (W <= 8 || H <= 8)
-            return;
 
         // Central ROI
         const double pad = 0.10;
@@ -190,23 +417,359 @@ namespace ite::geometry
         const int roi_x0 = (W - roi_w) / 2;
         const int roi_y0 = (H - roi_h) / 2;
 
-        const double base_score = score_angle_variance(work, roi_x0, roi_y0, roi_w, roi_h, 0.0);
+        long long ink = 0;
+        for (int y = roi_y0; y < roi_y0 + roi_h; ++y)
+            for (int x = roi_x0; x < roi_x0 + roi_w; ++x)
+                ink += work(x, y);
+        const double mean = static_cast<double>(ink) / roi_h;
 
-        // Coarse-to-fine search
-        auto [a1, s1] = search_best_angle(work, roi_x0, roi_y0, roi_w, roi_h, -15.0, 15.0, 1.0);
-        auto [a2, s2] = search_best_angle(work, roi_x0, roi_y0, roi_w, roi_h, a1 - 1.0, a1 + 1.0, 0.2);
-        auto [a3, s3] = search_best_angle(work, roi_x0, roi_y0, roi_w, roi_h, a2 - 0.3, a2 + 0.3, 0.05);
+        AngleScorer scorer(work, roi_x0, roi_y0, roi_w, roi_h, options.max_evaluations);
+        const double base_score = scorer.score(0.0);
 
-        const double best_angle = a3;
-        const double best_score = s3;
+        SkewSearch result;
+        auto finish = [&](const double angle, const double best_score)
+        {
+            result.angle = angle;
+            result.contrast = mean > 0.0 ? std::max(best_score, base_score) / (mean * mean) : 0.0;
+            result.evaluations = scorer.evaluations();
+            return result;
+        };
+
+        // Early exit: 0 degrees is a clear peak whose parabolic vertex lies within MIN_SKEW
+        if (options.early_exit_margin > 0.0 && base_score > 0.0)
+        {
+            const double left = scorer.score(-EARLY_EXIT_STEP);
+            const double right = scorer.score(EARLY_EXIT_STEP);
+            const double curvature = left - 2.0 * base_score + right;
+            if (left >= 0.0 && right >= 0.0 && base_score - std::max(left, right) >= options.early_exit_margin * base_score && curvature < 0.0 &&
+                std::abs(EARLY_EXIT_STEP * (left - right) / (2.0 * curvature)) <= MIN_SKEW)
+            {
+                return finish(0.0, base_score);
+            }
+        }
 
-        const double abs_a = std::abs(best_angle);
-        const bool angle_ok = (abs_a > 0.05);
+        // Coarse grid, then refinement around its peak
+        scorer.grid(-MAX_SKEW, MAX_SKEW, COARSE_STEP);
+        const double a1 = scorer.best().first;
+        if (options.strategy == AngleSearch::Grid)
+        {
+            scorer.grid(a1 - COARSE_STEP, a1 + COARSE_STEP, 0.2);
+            const double a2 = scorer.best().first;
+            scorer.grid(a2 - 0.3, a2 + 0.3, MIN_SKEW);
+        }
+        else
+        {
+            section_search(scorer, a1 - COARSE_STEP, a1 + COARSE_STEP, options.strategy);
+        }
+
+        const auto [best_angle, best_score] = scorer.best();
+        const bool angle_ok = (std::abs(best_angle) > MIN_SKEW);
         const bool improve_ok = (best_score > base_score + 1e-9) && (base_score <= 0.0 ? true : (best_score >= base_score * 1.002));
+        return finish((angle_ok && improve_ok) ? best_angle : 0.0, best_score);
+    }
 
-        if (angle_ok && improve_ok)
+    /**
+     * @brief Ink above minus ink below the core (x-height band) of the text lines, relative to both.
+     * Ascenders outnumber descenders in Latin script, so upright text gives a positive value, upside-down text a negative one.
+     * @return The asymmetry in [-1, 1]; 0 if fewer than MIN_ORIENTATION_LINES lines were found.
+     */
+    static double line_asymmetry(const CImg<unsigned char> &bin)
+    {
+        const int w = bin.width();
+        const int h = bin.height();
+        std::vector<int> profile(static_cast<size_t>(h), 0);
+        for (int y = 0; y < h; ++y)
+        {
+            const unsigned char* row = bin.data() + static_cast<size_t>(y) * w;
+            for (int x = 0; x < w; ++x)
+                profile[y] += row[x];
+        }
+
+        long long above = 0, below = 0;
+        int lines = 0;
+        for (int y = 0; y < h;)
+        {
+            if (profile[y] == 0)
+            {
+                ++y;
+                continue;
+            }
+
+            // A line is a run of rows with ink; its core are the rows with at least half the peak
+            const int top = y;
+            int peak = 0;
+            while (y < h && profile[y] > 0)
+                peak = std::max(peak, profile[y++]);
+            const int bottom = y - 1;
+            int core_top = top;
+            while (profile[core_top] * 2 < peak)
+                ++core_top;
+            int core_bottom = bottom;
+            while (profile[core_bottom] * 2 < peak)
+                --core_bottom;
+
+            for (int i = top; i < core_top; ++i)
+                above += profile[i];
+            for (int i = core_bottom + 1; i <= bottom; ++i)
+                below += profile[i];
+            ++lines;
+        }
+
+        if (lines < MIN_ORIENTATION_LINES || above + below == 0)
+            return 0.0;
+        return static_cast<double>(above - below) / static_cast<double>(above + below);
+    }
+
+    // Angle in degrees folded into [-period / 2, period / 2)
+    static double fold_angle(const double angle, const double period)
+    {
+        const double folded = std::fmod(angle + period / 2.0, period);
+        return (folded < 0.0 ? folded + period : folded) - period / 2.0;
+    }
+
+    /**
+     * @brief Docstrum-style direction of the text lines: the peak of the angle histogram of the vectors from every
+     * connected component to its nearest neighbours (centroids), which mostly lie on the same line.
+     * @param direction Set to the line direction in degrees within [-90, 90) (positive = clockwise, y pointing down).
+     * @return Whether there were enough letter-like components.
+     */
+    static bool docstrum_line_direction(const CImg<unsigned char> &bin, double &direction)
+    {
+        const int w = bin.width();
+        const int h = bin.height();
+
+        // Component statistics in one pass over the labels
+        const CImg<uint> labels = bin.get_label(true);
+        const size_t n = static_cast<size_t>(labels.max()) + 1;
+        std::vector<int> area(n, 0), top(n, h), bottom(n, -1), left(n, w), right(n, -1);
+        std::vector<double> sum_x(n, 0.0), sum_y(n, 0.0);
+        for (int y = 0; y < h; ++y)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                if (!bin(x, y))
+                    continue;
+                const uint l = labels(x, y);
+                ++area[l];
+                sum_x[l] += x;
+                sum_y[l] += y;
+                top[l] = std::min(top[l], y);
+                bottom[l] = std::max(bottom[l], y);
+                left[l] = std::min(left[l], x);
+                right[l] = std::max(right[l], x);
+            }
+        }
+
+        // Letter-like components: no specks, rules, frames or pictures
+        std::vector<float> cx, cy;
+        for (size_t l = 0; l < n; ++l)
+        {
+            const int ch = bottom[l] - top[l] + 1;
+            const int cw = right[l] - left[l] + 1;
+            if (area[l] < 3 || ch > h / 10 || cw > w / 4)
+                continue;
+            cx.push_back(static_cast<float>(sum_x[l] / area[l]));
+            cy.push_back(static_cast<float>(sum_y[l] / area[l]));
+        }
+        const int count = static_cast<int>(cx.size());
+        if (count < DOCSTRUM_MIN_COMPONENTS)
+            return false;
+
+        // Grid of about two components per cell; the neighbour search visits rings of cells until no closer one can be left
+        const double cell = std::max(1.0, std::sqrt(2.0 * w * h / count));
+        const int gw = static_cast<int>(w / cell) + 1;
+        const int gh = static_cast<int>(h / cell) + 1;
+        std::vector<int> cell_start(static_cast<size_t>(gw) * gh + 1, 0), cell_items(static_cast<size_t>(count));
+        auto cell_of = [&](const int i) { return static_cast<int>(cy[i] / cell) * gw + static_cast<int>(cx[i] / cell); };
+        for (int i = 0; i < count; ++i)
+            ++cell_start[static_cast<size_t>(cell_of(i)) + 1];
+        for (size_t c = 1; c < cell_start.size(); ++c)
+            cell_start[c] += cell_start[c - 1];
+        {
+            std::vector<int> fill(cell_start.begin(), cell_start.end() - 1);
+            for (int i = 0; i < count; ++i)
+                cell_items[static_cast<size_t>(fill[static_cast<size_t>(cell_of(i))]++)] = i;
+        }
+
+        // Histogram of the nearest-neighbour angles, 0.25 degree bins over [-90, 90)
+        constexpr int bins = 720;
+        std::vector<double> histogram(bins, 0.0);
+#pragma omp parallel
+        {
+            std::vector<double> local(bins, 0.0);
+            std::vector<std::pair<double, int>> candidates;
+#pragma omp for schedule(static) nowait
+            for (int i = 0; i < count; ++i)
+            {
+                candidates.clear();
+                const int gx = static_cast<int>(cx[i] / cell);
+                const int gy = static_cast<int>(cy[i] / cell);
+                for (int r = 0; r <= std::max(gw, gh); ++r)
+                {
+                    for (int ny = gy - r; ny <= gy + r; ++ny)
+                    {
+                        if (ny < 0 || ny >= gh)
+                            continue;
+                        // Inner rows of the ring only have their two end cells
+                        const int step = (ny == gy - r || ny == gy + r) ? 1 : std::max(1, 2 * r);
+                        for (int nx = gx - r; nx <= gx + r; nx += step)
+                        {
+                            if (nx < 0 || nx >= gw)
+                                continue;
+                            const int c = ny * gw + nx;
+                            for (int t = cell_start[static_cast<size_t>(c)]; t < cell_start[static_cast<size_t>(c) + 1]; ++t)
+                            {
+                                const int j = cell_items[static_cast<size_t>(t)];
+                                const double dx = cx[j] - cx[i];
+                                const double dy = cy[j] - cy[i];
+                                if (j != i)
+                                    candidates.emplace_back(dx * dx + dy * dy, j);
+                            }
+                        }
+                    }
+
+                    // Components outside ring r are farther than r cells
+                    if (candidates.size() >= static_cast<size_t>(DOCSTRUM_NEIGHBOURS))
+                    {
+                        std::nth_element(candidates.begin(), candidates.begin() + (DOCSTRUM_NEIGHBOURS - 1), candidates.end());
+                        if (candidates[DOCSTRUM_NEIGHBOURS - 1].first <= (r * cell) * (r * cell))
+                            break;
+                    }
+                }
+
+                const size_t k = std::min(candidates.size(), static_cast<size_t>(DOCSTRUM_NEIGHBOURS));
+                std::partial_sort(candidates.begin(), candidates.begin() + k, candidates.end());
+                for (size_t t = 0; t < k; ++t)
+                {
+                    const int j = candidates[t].second;
+                    const double angle = fold_angle(std::atan2(cy[j] - cy[i], cx[j] - cx[i]) * 180.0 / M_PI, 180.0);
+                    local[static_cast<size_t>(std::clamp(static_cast<int>((angle + 90.0) * 4.0), 0, bins - 1))] += 1.0;
+                }
+            }
+#pragma omp critical
+            {
+                for (int b = 0; b < bins; ++b)
+                    histogram[static_cast<size_t>(b)] += local[static_cast<size_t>(b)];
+            }
+        }
+
+        // Peak of the circularly smoothed histogram (+-1 degree), refined to the weighted mean around it
+        int peak = 0;
+        double peak_value = -1.0;
+        for (int b = 0; b < bins; ++b)
+        {
+            double v = 0.0;
+            for (int d = -4; d <= 4; ++d)
+                v += histogram[static_cast<size_t>((b + d + bins) % bins)];
+            if (v > peak_value)
+            {
+                peak_value = v;
+                peak = b;
+            }
+        }
+        if (peak_value <= 0.0)
+            return false;
+
+        double weighted = 0.0;
+        for (int d = -4; d <= 4; ++d)
+            weighted += d * histogram[static_cast<size_t>((peak + d + bins) % bins)];
+        direction = fold_angle((peak + 0.5 + weighted / peak_value) / 4.0 - 90.0, 180.0);
+        return true;
+    }
+
+    PageRotation detect_page_rotation(const CImg<uint> &input_image, bool detect_orientation, SkewEstimator estimator, int window_size, float k,
+                                      float delta, const core::Pyramid* pyramid, const AngleSearchOptions &search)
+    {
+        const int inW = input_image.width();
+        const int inH = input_image.height();
+        if (inW <= 1 || inH <= 1)
+            return {};
+
+        const BinaryProxy proxy = make_binary_proxy(input_image, window_size, k, delta, pyramid);
+        const CImg<unsigned char> &bin = proxy.bin;
+        const int new_w = bin.width();
+        const int new_h = bin.height();
+
+        // Crop to content
+        Box ink = foreground_bounds(bin, {0, 0, new_w - 1, new_h - 1});
+        if (ink.empty())
+            return {};
+
+        const int margin = std::max(2, static_cast<int>(std::lround(0.02 * std::min(new_w, new_h))));
+        const int minx = std::max(0, ink.x0 - margin);
+        const int miny = std::max(0, ink.y0 - margin);
+        const int maxx = std::min(new_w - 1, ink.x1 + margin);
+        const int maxy = std::min(new_h - 1, ink.y1 + margin);
+
+        CImg<unsigned char> work = bin.get_crop(minx, miny, maxx, maxy);
+        const int W = work.width();
+        const int H = work.height();
+        if (W <= 8 || H <= 8)
+            return {};
+
+        PageRotation rotation;
+        CImg<unsigned char> leveled = work;
+        if (estimator == SkewEstimator::Docstrum)
+        {
+            double direction = 0.0;
+            if (!docstrum_line_direction(work, direction))
+                return {};
+
+            // Lines closer to vertical than to horizontal are sideways; without orientation detection they are leveled to vertical
+            if (detect_orientation && std::abs(direction) > 45.0)
+            {
+                rotation.orientation = 90;
+                leveled.rotate(90.0f, 0, 0);
+            }
+            const double skew = -fold_angle(direction + rotation.orientation, detect_orientation ? 180.0 : 90.0);
+            rotation.skew = (std::abs(skew) > MIN_SKEW && std::abs(skew) <= MAX_SKEW) ? skew : 0.0;
+            if (!detect_orientation)
+                return rotation;
+        }
+        else
+        {
+            const SkewSearch upright = search_skew(work, search);
+            rotation.skew = upright.angle;
+            rotation.evaluations = upright.evaluations;
+            if (!detect_orientation)
+                return rotation;
+
+            // Sideways text: the lines show in the column profile, i.e. in the row profile of the proxy turned by a quarter
+            CImg<unsigned char> turned = work.get_rotate(90.0f, 0, 0);
+            const SkewSearch sideways = search_skew(turned, search);
+            rotation.evaluations += sideways.evaluations;
+            if (sideways.contrast > upright.contrast * SIDEWAYS_CONTRAST_RATIO)
+            {
+                rotation.orientation = 90;
+                rotation.skew = sideways.angle;
+                leveled.swap(turned);
+            }
+        }
+
+        // Upside down: the ascender/descender asymmetry of the leveled lines is reversed
+        if (rotation.skew != 0.0)
+            leveled.rotate(static_cast<float>(rotation.skew), 0, 0);
+        if (line_asymmetry(leveled) < -MIN_LINE_ASYMMETRY)
+            rotation.orientation += 180;
+        return rotation;
+    }
+
+    double detect_skew_angle_projection_profile(const CImg<uint> &input_image, int window_size, float k, float delta, const core::Pyramid* pyramid)
+    {
+        return detect_page_rotation(input_image, false, SkewEstimator::ProjectionProfile, window_size, k, delta, pyramid).skew;
+    }
+
+    double detect_skew_angle_docstrum(const CImg<uint> &input_image, const core::Pyramid* pyramid)
+    {
+        return detect_page_rotation(input_image, false, SkewEstimator::Docstrum, 15, 0.2f, 0.0f, pyramid).skew;
+    }
+
+    void deskew_projection_profile(CImg<uint> &input_image, int boundary_conditions, int window_size, float k, float delta, const core::Pyramid* pyramid)
+    {
+        const double angle = detect_skew_angle_projection_profile(input_image, window_size, k, delta, pyramid);
+        if (angle != 0.0)
         {
-            input_image.rotate(best_angle, 2, boundary_conditions);
+            input_image = rotate(input_image, angle, Interpolation::Cubic, boundary_conditions);
         }
     }
 } // namespace ite::geometry
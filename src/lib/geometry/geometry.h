@@ -4,6 +4,7 @@
  * @brief Geometric transformations (deskew, rotation).
  */
 
+#include "../core/pyramid.h"
 #include "CImg.h"
 
 using namespace cimg_library;
@@ -11,13 +12,72 @@ using namespace cimg_library;
 namespace ite::geometry
 {
 
+    /**
+     * @brief Inclusive pixel box [x0, x1] x [y0, y1].
+     */
+    struct Box
+    {
+        int x0 = 0;
+        int y0 = 0;
+        int x1 = -1;
+        int y1 = -1;
+
+        int width() const { return x1 - x0 + 1; }
+        int height() const { return y1 - y0 + 1; }
+        bool empty() const { return x1 < x0 || y1 < y0; }
+    };
+
+    /**
+     * @brief How the skew angle is estimated.
+     */
+    enum class SkewEstimator
+    {
+        ProjectionProfile, ///< Angle search maximizing the variance of the row profile; robust on dense text
+        Docstrum ///< Nearest-neighbour angles of connected components; cost grows with the components, suits sparse pages
+    };
+
+    /**
+     * @brief Refinement of the projection-profile angle search around the best angle of its 1 degree grid.
+     */
+    enum class AngleSearch
+    {
+        Grid, ///< Grids of 0.2 and then 0.05 degree steps (about 18 new angles)
+        Golden, ///< Golden-section search down to 0.05 degrees (about 9 angles); assumes a unimodal peak
+        Ternary ///< Ternary search down to 0.05 degrees (about 20 angles); assumes a unimodal peak
+    };
+
+    /**
+     * @brief Cost controls of the projection-profile angle search.
+     */
+    struct AngleSearchOptions
+    {
+        AngleSearch strategy = AngleSearch::Grid;
+        /** @brief Skip the search if the scores at +-0.1 degrees fall below the one at 0 by this fraction and the peak lies within 0.05 degrees (0 = off). */
+        double early_exit_margin = 0.0;
+        /** @brief Maximum number of scored angles, the grid angles closest to 0 first (0 = no limit). */
+        int max_evaluations = 0;
+    };
+
+    /**
+     * @brief Rotation that brings a page upright, split into its quarter-turn and skew parts.
+     */
+    struct PageRotation
+    {
+        int orientation = 0; ///< Quarter turns in degrees (0, 90, 180 or 270, clockwise)
+        double skew = 0.0; ///< Remaining correction in degrees (positive = clockwise), within +-15
+        int evaluations = 0; ///< Angles scored by the projection-profile search (0 with docstrum)
+
+        /** @brief The whole correction, to apply in a single rotation. */
+        double angle() const { return orientation + skew; }
+    };
+
     /**
      * @brief Detects and corrects skew (rotation) in an image (in-place).
      *
      * Uses the Projection Profile method:
-     * 1. Converts to grayscale and binarizes using Sauvola
+     * 1. Downscales (area average), converts to grayscale and binarizes using Sauvola
      * 2. Searches for the angle that maximizes horizontal projection profile variance
-     * 3. Rotates the image to correct the skew
+     * 3. Rotates the image to correct the skew (parallel cubic resampling, see resample.h)
      *
      * Features:
      * - Polarity-safe (detects light vs. dark background)
@@ -29,17 +89,66 @@ namespace ite::geometry
      * @param window_size The size of the local window for Sauvola (default: 15).
      * @param k Sauvola's parameter controlling threshold sensitivity (default: 0.2).
      * @param delta Optional offset subtracted from threshold (default: 0.0).
+     * @param pyramid Optional pyramid of the (grayscale) image; the angle search proxy is then taken from its smallest sufficient level.
      */
-    void deskew_projection_profile(CImg<uint> &input_image, int boundary_conditions = 1, int window_size = 15, float k = 0.2f, float delta = 0.0f);
+    void deskew_projection_profile(CImg<uint> &input_image, int boundary_conditions = 1, int window_size = 15, float k = 0.2f, float delta = 0.0f,
+                                   const core::Pyramid* pyramid = nullptr);
 
     /**
      * @brief Detects the skew angle without applying the correction.
      *
-     * Useful for diagnostics or when you want to apply the rotation separately.
+     * Useful for diagnostics or when you want to apply the rotation separately, e.g. the same angle to
+     * a grayscale and a color copy. Parameters as in deskew_projection_profile().
      *
      * @param image The image to analyze.
-     * @return The detected skew angle in degrees. Positive = clockwise.
+     * @return The rotation in degrees (positive = clockwise) that levels the text, or 0 if no correction is needed.
+     */
+    double detect_skew_angle_projection_profile(const CImg<uint> &image, int window_size = 15, float k = 0.2f, float delta = 0.0f,
+                                                const core::Pyramid* pyramid = nullptr);
+
+    /**
+     * @brief Detects the skew angle and, optionally, the page orientation (0/90/180/270 degrees).
+     *
+     * The orientation is read from the deskew proxy: a page is sideways if the text lines show more clearly
+     * in the row profile of the proxy turned by a quarter than in its own, and upside down if its leveled
+     * text lines have more ink below their x-height band than above it (descenders instead of ascenders).
+     * Parameters as in deskew_projection_profile().
+     *
+     * @param image The image to analyze.
+     * @param detect_orientation Whether to look for quarter turns; otherwise only the skew is searched.
+     * @param estimator How the skew is estimated; with docstrum, the line direction also tells sideways pages apart.
+     * @param search Strategy, early exit and budget of the projection-profile search.
+     * @return The rotation that brings the page upright; `angle()` can be applied with one call to `rotate`.
+     */
+    PageRotation detect_page_rotation(const CImg<uint> &image, bool detect_orientation = true, SkewEstimator estimator = SkewEstimator::ProjectionProfile,
+                                      int window_size = 15, float k = 0.2f, float delta = 0.0f, const core::Pyramid* pyramid = nullptr,
+                                      const AngleSearchOptions &search = {});
+
+    /**
+     * @brief Detects the skew angle from the layout of connected components (docstrum).
+     *
+     * Labels the components of the deskew proxy once and builds a histogram of the angles from every
+     * letter-like component to its 5 nearest neighbours; the peak is the direction of the text lines.
+     * The cost grows with the number of components instead of pixels times angles, and sparse pages
+     * (music sheets, forms) still yield enough neighbour pairs for a clear peak.
+     *
+     * @param image The image to analyze.
+     * @param pyramid Optional pyramid of the (grayscale) image to take the proxy from.
+     * @return The rotation in degrees (positive = clockwise) that levels the text, or 0 if no correction is needed.
+     */
+    double detect_skew_angle_docstrum(const CImg<uint> &image, const core::Pyramid* pyramid = nullptr);
+
+    /**
+     * @brief Finds the page content: the box around all ink, inside any dark scanner borders.
+     *
+     * Works on the same downscaled Sauvola proxy (600 px long side) as deskew. Dark bands along the edges of
+     * a light page (scanner lids, shadows; at most a quarter of each side) are stripped first, then the ink box
+     * is padded by 2% of the proxy's short side, as in the deskew crop.
+     *
+     * @param image Grayscale or color image.
+     * @param pyramid Optional pyramid of the (grayscale) image to take the proxy from.
+     * @return The content box in pixels of `image`; the whole image if there is nothing to crop.
      */
-    double detect_skew_angle_projection_profile(const CImg<uint> &image);
+    Box detect_content_bounds(const CImg<uint> &image, const core::Pyramid* pyramid = nullptr);
 
 } // namespace ite::geometry
@@ -0,0 +1,477 @@
+#include "resample.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+
+#include "../core/utils.h"
+
+using namespace ite::utils;
+
+
+namespace ite::geometry
+{
+
+    namespace
+    {
+        // Side length of the output tiles processed by one thread at a time
+        constexpr int TILE_SIZE = 64;
+
+        /**
+         * @brief Source pixels and weights contributing to one output pixel along one axis (area resize).
+         */
+        struct AreaTaps
+        {
+            int first = 0;
+            int count = 0;
+            size_t weights = 0; ///< Offset into the shared weight array
+        };
+
+        /**
+         * @brief Splits [0, in) into `out` equal spans and lists the covered source pixels of each with the covered fraction.
+         */
+        std::vector<AreaTaps> area_taps(const int in, const int out, std::vector<float> &weights)
+        {
+            std::vector<AreaTaps> taps(static_cast<size_t>(out));
+            const double scale = static_cast<double>(in) / static_cast<double>(out);
+
+            for (int i = 0; i < out; ++i)
+            {
+                const double a = i * scale;
+                const double b = std::min(static_cast<double>(in), (i + 1) * scale);
+                const int first = std::min(in - 1, static_cast<int>(std::floor(a)));
+                const int last = std::max(first, std::min(in - 1, static_cast<int>(std::ceil(b)) - 1));
+
+                AreaTaps &t = taps[static_cast<size_t>(i)];
+                t.first = first;
+                t.count = last - first + 1;
+                t.weights = weights.size();
+
+                const double span = b - a;
+                for (int s = first; s <= last; ++s)
+                {
+                    const double covered = std::min(b, s + 1.0) - std::max(a, static_cast<double>(s));
+                    weights.push_back(static_cast<float>((span > 0.0 ? covered / span : 1.0)));
+                }
+            }
+            return taps;
+        }
+
+        /**
+         * @brief Maps an index outside [0, n) into the image according to the boundary conditions, or -1 for zero.
+         */
+        inline int fold_index(const int i, const int n, const int boundary_conditions)
+        {
+            if (i >= 0 && i < n)
+                return i;
+
+            switch (boundary_conditions)
+            {
+            case 0:
+                return -1;
+            case 1:
+                return i < 0 ? 0 : n - 1;
+            case 2:
+                return ((i % n) + n) % n;
+            default:
+            {
+                const int period = 2 * n;
+                const int m = ((i % period) + period) % period;
+                return m < n ? m : period - 1 - m;
+            }
+            }
+        }
+
+        /**
+         * @brief Source indices (folded) and weights of one sample position along one axis.
+         * N = 1 picks the nearest pixel, N = 2 interpolates linearly, N = 4 uses Catmull-Rom weights.
+         * @return Whether all taps lie inside [0, n), i.e. are consecutive and unfolded.
+         */
+        template <int N>
+        inline bool axis_taps(const float pos, const int n, const int boundary_conditions, int* idx, float* w)
+        {
+            int first;
+            if constexpr (N == 1)
+            {
+                first = static_cast<int>(std::floor(pos + 0.5f));
+                w[0] = 1.0f;
+            }
+            else
+            {
+                const float base = std::floor(pos);
+                const float t = pos - base;
+                first = static_cast<int>(base) - (N / 2 - 1);
+
+                if constexpr (N == 2)
+                {
+                    w[0] = 1.0f - t;
+                    w[1] = t;
+                }
+                else
+                {
+                    const float t2 = t * t;
+                    const float t3 = t2 * t;
+                    w[0] = 0.5f * (-t3 + 2.0f * t2 - t);
+                    w[1] = 0.5f * (3.0f * t3 - 5.0f * t2 + 2.0f);
+                    w[2] = 0.5f * (-3.0f * t3 + 4.0f * t2 + t);
+                    w[3] = 0.5f * (t3 - t2);
+                }
+            }
+
+            const bool inside = first >= 0 && first + N <= n;
+            for (int k = 0; k < N; ++k)
+                idx[k] = inside ? first + k : fold_index(first + k, n, boundary_conditions);
+            return inside;
+        }
+
+        /**
+         * @brief Output pixels that are filled with a constant instead of being sampled.
+         */
+        struct OutputMask
+        {
+            const uint* values = nullptr; ///< One value per output pixel, or null to sample every pixel
+            uint skip = 255; ///< Pixels with this mask value are not sampled
+            uint fill = 255; ///< Value of the skipped pixels in every channel
+        };
+
+        /**
+         * @brief (Internal) Fills `output` tile by tile; `coords(x, y, X, Y)` gives the source position of output pixel (x, y).
+         */
+        template <int N, typename Coords>
+        void resample_tiles(const CImg<uint> &input, CImg<uint> &output, const int boundary_conditions, const Coords &coords, const OutputMask &mask)
+        {
+            const int in_w = input.width();
+            const int in_h = input.height();
+            const int out_w = output.width();
+            const int out_h = output.height();
+            const int channels = input.spectrum();
+            const size_t in_plane = static_cast<size_t>(in_w) * in_h;
+            const size_t out_plane = static_cast<size_t>(out_w) * out_h;
+            const int tiles_x = (out_w + TILE_SIZE - 1) / TILE_SIZE;
+            const int tiles_y = (out_h + TILE_SIZE - 1) / TILE_SIZE;
+            const uint* src = input.data();
+            uint* dst = output.data();
+
+#pragma omp parallel for collapse(2) schedule(dynamic)
+            for (int ty = 0; ty < tiles_y; ++ty)
+            {
+                for (int tx = 0; tx < tiles_x; ++tx)
+                {
+                    const int x_end = std::min(out_w, (tx + 1) * TILE_SIZE);
+                    const int y_end = std::min(out_h, (ty + 1) * TILE_SIZE);
+
+                    for (int y = ty * TILE_SIZE; y < y_end; ++y)
+                    {
+                        for (int x = tx * TILE_SIZE; x < x_end; ++x)
+                        {
+                            const size_t o = static_cast<size_t>(y) * out_w + x;
+                            if (mask.values && mask.values[o] == mask.skip)
+                            {
+                                for (int c = 0; c < channels; ++c)
+                                    dst[c * out_plane + o] = mask.fill;
+                                continue;
+                            }
+
+                            float X, Y;
+                            coords(x, y, X, Y);
+
+                            int ix[N], iy[N];
+                            float wx[N], wy[N];
+                            const bool inside_x = axis_taps<N>(X, in_w, boundary_conditions, ix, wx);
+                            const bool inside_y = axis_taps<N>(Y, in_h, boundary_conditions, iy, wy);
+
+                            if (inside_x && inside_y)
+                            {
+                                // All taps inside: fixed offsets from the first one, no folding
+                                const size_t first = static_cast<size_t>(iy[0]) * in_w + ix[0];
+                                for (int c = 0; c < channels; ++c)
+                                {
+                                    const uint* p = src + c * in_plane + first;
+                                    float sum = 0.0f;
+                                    for (int j = 0; j < N; ++j)
+                                    {
+                                        float row_sum = 0.0f;
+                                        for (int i = 0; i < N; ++i)
+                                            row_sum += wx[i] * static_cast<float>(p[i]);
+                                        sum += wy[j] * row_sum;
+                                        p += in_w;
+                                    }
+                                    dst[c * out_plane + o] = clamp_float_to_u8(sum);
+                                }
+                                continue;
+                            }
+
+                            for (int c = 0; c < channels; ++c)
+                            {
+                                const uint* plane = src + c * in_plane;
+                                float sum = 0.0f;
+                                for (int j = 0; j < N; ++j)
+                                {
+                                    if (iy[j] < 0)
+                                        continue;
+                                    const uint* row = plane + static_cast<size_t>(iy[j]) * in_w;
+                                    float row_sum = 0.0f;
+                                    for (int i = 0; i < N; ++i)
+                                        if (ix[i] >= 0)
+                                            row_sum += wx[i] * static_cast<float>(row[ix[i]]);
+                                    sum += wy[j] * row_sum;
+                                }
+                                dst[c * out_plane + o] = clamp_float_to_u8(sum);
+                            }
+                        }
+                    }
+                }
+            }
+        }
+
+        template <typename Coords>
+        void resample(const CImg<uint> &input, CImg<uint> &output, const Interpolation interpolation, const int boundary_conditions,
+                      const Coords &coords, const OutputMask &mask = {})
+        {
+            switch (interpolation)
+            {
+            case Interpolation::Nearest:
+                resample_tiles<1>(input, output, boundary_conditions, coords, mask);
+                break;
+            case Interpolation::Linear:
+                resample_tiles<2>(input, output, boundary_conditions, coords, mask);
+                break;
+            default:
+                resample_tiles<4>(input, output, boundary_conditions, coords, mask);
+                break;
+            }
+        }
+
+        /**
+         * @brief Angle in [0, 360).
+         */
+        double normalize_angle(const double angle_deg) { return std::fmod(std::fmod(angle_deg, 360.0) + 360.0, 360.0); }
+
+        /**
+         * @brief Inverse mapping of a rotation: output canvas size and source position of every output pixel.
+         */
+        struct RotationTransform
+        {
+            int width = 0;
+            int height = 0;
+            float ca = 1.0f, sa = 0.0f;
+            float w2 = 0.0f, h2 = 0.0f; ///< Source center
+            float rw2 = 0.0f, rh2 = 0.0f; ///< Output center
+
+            RotationTransform(const int in_w, const int in_h, const double angle_deg)
+            {
+                const double rad = angle_deg * M_PI / 180.0;
+                ca = static_cast<float>(std::cos(rad));
+                sa = static_cast<float>(std::sin(rad));
+
+                const float ux = std::abs((in_w - 1) * ca), uy = std::abs((in_w - 1) * sa);
+                const float vx = std::abs((in_h - 1) * sa), vy = std::abs((in_h - 1) * ca);
+                width = static_cast<int>(std::lround(1.0f + ux + vx));
+                height = static_cast<int>(std::lround(1.0f + uy + vy));
+
+                w2 = 0.5f * (in_w - 1);
+                h2 = 0.5f * (in_h - 1);
+                rw2 = 0.5f * (width - 1);
+                rh2 = 0.5f * (height - 1);
+            }
+
+            void operator()(const int x, const int y, float &X, float &Y) const
+            {
+                const float xc = x - rw2;
+                const float yc = y - rh2;
+                X = w2 + xc * ca + yc * sa;
+                Y = h2 - xc * sa + yc * ca;
+            }
+        };
+
+        /**
+         * @brief Rotation by quarter turns (1 = 90 degrees clockwise) as a pixel permutation.
+         */
+        CImg<uint> rotate_quarter_turns(const CImg<uint> &input, const int quarters)
+        {
+            const int w = input.width();
+            const int h = input.height();
+            const int channels = input.spectrum();
+            const bool swap_axes = (quarters % 2) != 0;
+            CImg<uint> output(swap_axes ? h : w, swap_axes ? w : h, 1, channels);
+            const int out_w = output.width();
+            const int out_h = output.height();
+
+#pragma omp parallel for collapse(2) schedule(static)
+            for (int c = 0; c < channels; ++c)
+            {
+                for (int y = 0; y < out_h; ++y)
+                {
+                    uint* dst = output.data(0, y, 0, c);
+                    for (int x = 0; x < out_w; ++x)
+                    {
+                        switch (quarters)
+                        {
+                        case 1:
+                            dst[x] = input(y, h - 1 - x, 0, c);
+                            break;
+                        case 2:
+                            dst[x] = input(w - 1 - x, h - 1 - y, 0, c);
+                            break;
+                        default:
+                            dst[x] = input(w - 1 - y, x, 0, c);
+                            break;
+                        }
+                    }
+                }
+            }
+            return output;
+        }
+    } // namespace
+
+    CImg<uint> resize_area(const CImg<uint> &input, const int width, const int height)
+    {
+        if (width <= 0 || height <= 0)
+            throw std::invalid_argument("resize_area: output size must be positive");
+        if (input.is_empty())
+            return {};
+        if (width == input.width() && height == input.height())
+            return input;
+
+        const int in_w = input.width();
+        const int in_h = input.height();
+        const int channels = input.spectrum();
+
+        std::vector<float> wx_weights, wy_weights;
+        const std::vector<AreaTaps> tx = area_taps(in_w, width, wx_weights);
+        const std::vector<AreaTaps> ty = area_taps(in_h, height, wy_weights);
+
+        // Horizontal pass: in_h rows of `width` averaged values per channel
+        std::vector<float> rows(static_cast<size_t>(width) * in_h * channels);
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int y = 0; y < in_h; ++y)
+            {
+                const uint* src = input.data(0, y, 0, c);
+                float* dst = rows.data() + (static_cast<size_t>(c) * in_h + y) * width;
+                for (int x = 0; x < width; ++x)
+                {
+                    const AreaTaps &t = tx[static_cast<size_t>(x)];
+                    const float* w = wx_weights.data() + t.weights;
+                    float sum = 0.0f;
+                    for (int k = 0; k < t.count; ++k)
+                        sum += w[k] * static_cast<float>(src[t.first + k]);
+                    dst[x] = sum;
+                }
+            }
+        }
+
+        // Vertical pass: weighted sums of whole rows
+        CImg<uint> output(width, height, 1, channels);
+#pragma omp parallel
+        {
+            std::vector<float> acc(static_cast<size_t>(width));
+
+#pragma omp for collapse(2) schedule(static)
+            for (int c = 0; c < channels; ++c)
+            {
+                for (int y = 0; y < height; ++y)
+                {
+                    const AreaTaps &t = ty[static_cast<size_t>(y)];
+                    const float* w = wy_weights.data() + t.weights;
+                    std::fill(acc.begin(), acc.end(), 0.0f);
+
+                    for (int k = 0; k < t.count; ++k)
+                    {
+                        const float* row = rows.data() + (static_cast<size_t>(c) * in_h + t.first + k) * width;
+                        const float wk = w[k];
+                        for (int x = 0; x < width; ++x)
+                            acc[static_cast<size_t>(x)] += wk * row[x];
+                    }
+
+                    uint* dst = output.data(0, y, 0, c);
+                    for (int x = 0; x < width; ++x)
+                        dst[x] = static_cast<uint>(std::max(0.0f, acc[static_cast<size_t>(x)]) + 0.5f);
+                }
+            }
+        }
+
+        return output;
+    }
+
+    CoordinateMap rotation_map(const int width, const int height, const double angle_deg)
+    {
+        const RotationTransform transform(width, height, normalize_angle(angle_deg));
+
+        CoordinateMap map;
+        map.width = transform.width;
+        map.height = transform.height;
+        const size_t n = static_cast<size_t>(map.width) * map.height;
+        map.x.resize(n);
+        map.y.resize(n);
+
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < map.height; ++y)
+        {
+            const size_t row = static_cast<size_t>(y) * map.width;
+            for (int x = 0; x < map.width; ++x)
+                transform(x, y, map.x[row + x], map.y[row + x]);
+        }
+        return map;
+    }
+
+    CImg<uint> remap(const CImg<uint> &input, const CoordinateMap &map, const Interpolation interpolation, const int boundary_conditions)
+    {
+        const size_t n = static_cast<size_t>(map.width) * map.height;
+        if (map.width < 0 || map.height < 0 || map.x.size() != n || map.y.size() != n)
+            throw std::invalid_argument("remap: coordinate map does not match its dimensions");
+        if (input.is_empty() || n == 0)
+            return {};
+
+        CImg<uint> output(map.width, map.height, 1, input.spectrum());
+        const float* mx = map.x.data();
+        const float* my = map.y.data();
+        const int map_w = map.width;
+        resample(input, output, interpolation, boundary_conditions,
+                 [mx, my, map_w](const int x, const int y, float &X, float &Y)
+                 {
+                     const size_t i = static_cast<size_t>(y) * map_w + x;
+                     X = mx[i];
+                     Y = my[i];
+                 });
+        return output;
+    }
+
+    CImg<uint> rotate(const CImg<uint> &input, const double angle_deg, const Interpolation interpolation, const int boundary_conditions)
+    {
+        if (input.is_empty())
+            return {};
+
+        const double normalized = normalize_angle(angle_deg);
+        if (normalized == 0.0)
+            return input;
+        if (std::fmod(normalized, 90.0) == 0.0)
+            return rotate_quarter_turns(input, static_cast<int>(normalized / 90.0));
+
+        const RotationTransform transform(input.width(), input.height(), normalized);
+        CImg<uint> output(transform.width, transform.height, 1, input.spectrum());
+        resample(input, output, interpolation, boundary_conditions, transform);
+        return output;
+    }
+
+    CImg<uint> rotate_masked(const CImg<uint> &input, const double angle_deg, const CImg<uint> &mask, const uint skip_value, const uint fill,
+                             const Interpolation interpolation, const int boundary_conditions)
+    {
+        if (input.is_empty())
+            return {};
+
+        const double normalized = normalize_angle(angle_deg);
+        const RotationTransform transform(input.width(), input.height(), normalized);
+        if (mask.spectrum() != 1 || mask.width() != transform.width || mask.height() != transform.height)
+            throw std::invalid_argument("rotate_masked: mask must be a single-channel image of the rotated size");
+
+        // Quarter turns map pixel centers onto pixel centers: nearest sampling keeps them exact
+        const Interpolation effective = std::fmod(normalized, 90.0) == 0.0 ? Interpolation::Nearest : interpolation;
+        CImg<uint> output(transform.width, transform.height, 1, input.spectrum());
+        resample(input, output, effective, boundary_conditions, transform, {mask.data(), skip_value, fill});
+        return output;
+    }
+
+} // namespace ite::geometry
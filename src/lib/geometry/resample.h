@@ -0,0 +1,98 @@
+#pragma once
+/**
+ * @file resample.h
+ * @brief Parallel image resampling (area-average downscale, rotation, coordinate-map warps).
+ */
+
+#include <vector>
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::geometry
+{
+
+    /**
+     * @brief Interpolation used when sampling between source pixels (values match CImg's rotate codes).
+     */
+    enum class Interpolation
+    {
+        Nearest = 0,
+        Linear = 1,
+        Cubic = 2, ///< Catmull-Rom, 4x4 neighbours
+    };
+
+    /**
+     * @brief Source coordinates of every pixel of an output image, stored row-major.
+     * Pixel (x, y) of the output samples the source at (x[i], y[i]) with i = y * width + x.
+     * Costs 8 bytes per output pixel; worth building when the same warp is applied to several images.
+     */
+    struct CoordinateMap
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<float> x;
+        std::vector<float> y;
+    };
+
+    /**
+     * @brief Downscales an image by averaging the source area covered by each output pixel.
+     *
+     * Separable: a horizontal pass into a float buffer, then a vertical pass, both parallel over rows.
+     * Partially covered source pixels contribute with their covered fraction, so non-integer factors
+     * do not alias the way nearest-neighbour resizing does. Upscaling degenerates to a box filter.
+     *
+     * @param input Source image (any number of channels).
+     * @param width Output width.
+     * @param height Output height.
+     * @return The resized image with the spectrum of `input`.
+     * @throws std::invalid_argument if `width` or `height` is not positive.
+     */
+    CImg<uint> resize_area(const CImg<uint> &input, int width, int height);
+
+    /**
+     * @brief Builds the coordinate map of a rotation by `angle_deg` (clockwise) around the image center.
+     * The output canvas encloses the whole rotated image, as with CImg's `get_rotate`.
+     */
+    CoordinateMap rotation_map(int width, int height, double angle_deg);
+
+    /**
+     * @brief Samples `input` at the coordinates of `map`.
+     *
+     * Interpolation weights are computed once per output pixel and shared by all channels.
+     * The output is processed in parallel over square tiles; results are rounded and clamped to [0, 255].
+     *
+     * @param boundary_conditions Value of samples outside the source: 0 = zero (Dirichlet), 1 = nearest edge (Neumann),
+     *                            2 = periodic, 3 = mirror.
+     * @throws std::invalid_argument if the map's coordinate arrays do not match its dimensions.
+     */
+    CImg<uint> remap(const CImg<uint> &input, const CoordinateMap &map, Interpolation interpolation = Interpolation::Linear,
+                     int boundary_conditions = 0);
+
+    /**
+     * @brief Rotates an image clockwise by `angle_deg` around its center onto a canvas enclosing the result.
+     *
+     * Same geometry as `remap(input, rotation_map(...))`, with the coordinates computed on the fly.
+     * Multiples of 90 degrees are exact pixel permutations without interpolation.
+     *
+     * @param boundary_conditions See remap().
+     */
+    CImg<uint> rotate(const CImg<uint> &input, double angle_deg, Interpolation interpolation = Interpolation::Cubic,
+                      int boundary_conditions = 1);
+
+    /**
+     * @brief Rotates like rotate(), but only samples the output pixels whose mask value differs from `skip_value`;
+     * the others are set to `fill` in every channel.
+     *
+     * With a sparse mask (the text of a binarized page) most of the interpolation is skipped and no rotated
+     * copy of the whole image is made: `enhance` pulls the color of the text pixels straight from the
+     * unrotated color copy this way.
+     *
+     * @param mask Single-channel image of the size of the rotated canvas.
+     * @throws std::invalid_argument if the mask has another size or more than one channel.
+     */
+    CImg<uint> rotate_masked(const CImg<uint> &input, double angle_deg, const CImg<uint> &mask, uint skip_value = 255, uint fill = 255,
+                             Interpolation interpolation = Interpolation::Cubic, int boundary_conditions = 1);
+
+} // namespace ite::geometry
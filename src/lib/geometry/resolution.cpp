@@ -0,0 +1,127 @@
+#include "resolution.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "../binarization/binarization.h"
+#include "../color/grayscale.h"
+#include "resample.h"
+
+
+namespace ite::geometry
+{
+
+    namespace
+    {
+        // Long side of the proxy the components are measured on; keeps the x-height of 300-1200 DPI pages above 10 px
+        constexpr int PROXY_LONG_SIDE = 2048;
+
+        // Fewer letter-like components than this give no estimate
+        constexpr int MIN_COMPONENTS = 20;
+
+        // Components lower than this (proxy pixels) are noise, punctuation or dots
+        constexpr int MIN_COMPONENT_HEIGHT = 3;
+
+        // Scale factors above this are not worth the resampling blur
+        constexpr double MAX_USEFUL_SCALE = 0.9;
+    } // namespace
+
+    double estimate_x_height(const CImg<uint> &image)
+    {
+        if (image.is_empty())
+            return 0.0;
+
+        const int w = image.width();
+        const int h = image.height();
+        const double scale = std::min(1.0, static_cast<double>(PROXY_LONG_SIDE) / std::max(w, h));
+        const CImg<uint> proxy = color::get_grayscale_rec601(
+            scale < 1.0 ? resize_area(image, std::max(1, static_cast<int>(std::lround(w * scale))), std::max(1, static_cast<int>(std::lround(h * scale))))
+                        : image);
+        const int pw = proxy.width();
+        const int ph = proxy.height();
+
+        // Ink mask: the class opposite to the background
+        const int threshold = binarization::compute_otsu_threshold(proxy);
+        const bool light_background = binarization::compute_border_mean(proxy) > threshold;
+        CImg<uint> ink(pw, ph, 1, 1);
+#pragma omp parallel for
+        for (long long i = 0; i < static_cast<long long>(ink.size()); ++i)
+        {
+            const bool dark = proxy[i] <= static_cast<uint>(threshold);
+            ink[i] = (dark == light_background) ? 1u : 0u;
+        }
+
+        // Bounding box of every ink component
+        const CImg<uint> labels = ink.get_label(true);
+        const size_t n = static_cast<size_t>(labels.max()) + 1;
+        std::vector<int> top(n, std::numeric_limits<int>::max()), bottom(n, -1);
+        std::vector<int> left(n, std::numeric_limits<int>::max()), right(n, -1);
+        std::vector<unsigned char> is_ink(n, 0);
+        for (int y = 0; y < ph; ++y)
+        {
+            for (int x = 0; x < pw; ++x)
+            {
+                const uint l = labels(x, y);
+                is_ink[l] = static_cast<unsigned char>(ink(x, y));
+                top[l] = std::min(top[l], y);
+                bottom[l] = std::max(bottom[l], y);
+                left[l] = std::min(left[l], x);
+                right[l] = std::max(right[l], x);
+            }
+        }
+
+        // Histogram of the heights of letter-like components (no rules, frames or pictures)
+        std::vector<int> counts(static_cast<size_t>(ph) + 2, 0);
+        int total = 0;
+        for (size_t l = 0; l < n; ++l)
+        {
+            if (!is_ink[l])
+                continue;
+            const int ch = bottom[l] - top[l] + 1;
+            const int cw = right[l] - left[l] + 1;
+            if (ch >= MIN_COMPONENT_HEIGHT && ch <= ph / 8 && cw <= 10 * ch)
+            {
+                ++counts[static_cast<size_t>(ch)];
+                ++total;
+            }
+        }
+        if (total < MIN_COMPONENTS)
+            return 0.0;
+
+        // Mode of the 3-bin smoothed histogram, refined to the weighted mean of its bins
+        int best = MIN_COMPONENT_HEIGHT;
+        int best_count = -1;
+        for (int i = MIN_COMPONENT_HEIGHT; i <= ph; ++i)
+        {
+            const int c = counts[static_cast<size_t>(i - 1)] + counts[static_cast<size_t>(i)] + counts[static_cast<size_t>(i + 1)];
+            if (c > best_count)
+            {
+                best_count = c;
+                best = i;
+            }
+        }
+        double weighted = 0.0;
+        for (int i = best - 1; i <= best + 1; ++i)
+            weighted += static_cast<double>(i) * counts[static_cast<size_t>(i)];
+
+        return weighted / best_count / scale;
+    }
+
+    double dpi_normalization_scale(const CImg<uint> &image, const int target_dpi)
+    {
+        if (target_dpi <= 0)
+            throw std::invalid_argument("dpi_normalization_scale: target DPI must be positive");
+
+        const double x_height = estimate_x_height(image);
+        if (x_height <= 0.0)
+            return 1.0;
+
+        const double dpi = 300.0 * x_height / REFERENCE_X_HEIGHT_300DPI;
+        const double scale = static_cast<double>(target_dpi) / dpi;
+        return scale < MAX_USEFUL_SCALE ? scale : 1.0;
+    }
+
+} // namespace ite::geometry
@@ -0,0 +1,41 @@
+#pragma once
+/**
+ * @file resolution.h
+ * @brief Estimation of the effective text resolution of a page, for normalizing it to a working DPI.
+ */
+
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::geometry
+{
+
+    /** @brief x-height in pixels of 10-12 pt body text scanned at 300 DPI; maps a measured x-height to a resolution. */
+    constexpr double REFERENCE_X_HEIGHT_300DPI = 20.0;
+
+    /**
+     * @brief Estimates the x-height (height of lowercase letters without ascenders) of the text in an image.
+     *
+     * Binarizes an area-downsampled proxy (long side at most 2048 px) with Otsu's method, labels the
+     * connected components of the ink and takes the most frequent component height. Lowercase letters
+     * without ascenders or descenders dominate running text, so the mode is the x-height.
+     *
+     * @param image Grayscale or color image.
+     * @return The x-height in pixels of `image`, or 0 if too few letter-like components were found.
+     */
+    double estimate_x_height(const CImg<uint> &image);
+
+    /**
+     * @brief Factor that brings the text of an image to `target_dpi`.
+     *
+     * The effective resolution is 300 * x-height / REFERENCE_X_HEIGHT_300DPI. Only downscaling is proposed:
+     * images at or below the target, or without measurable text, get 1.
+     *
+     * @param image Grayscale or color image.
+     * @param target_dpi Working resolution (e.g. 300).
+     * @return Scale factor in (0, 1].
+     */
+    double dpi_normalization_scale(const CImg<uint> &image, int target_dpi);
+
+} // namespace ite::geometry
@@ -0,0 +1,220 @@
+#include "mrc.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+#include <zlib.h>
+
+
+namespace ite::io
+{
+
+    namespace
+    {
+        void put_u32(std::vector<unsigned char> &out, const uint32_t v)
+        {
+            out.push_back(static_cast<unsigned char>(v >> 24));
+            out.push_back(static_cast<unsigned char>(v >> 16));
+            out.push_back(static_cast<unsigned char>(v >> 8));
+            out.push_back(static_cast<unsigned char>(v));
+        }
+
+        /**
+         * @brief (Internal) Appends a PNG chunk (length, type, data, CRC of type and data).
+         */
+        void put_chunk(std::vector<unsigned char> &out, const char* type, const unsigned char* data, const size_t size)
+        {
+            put_u32(out, static_cast<uint32_t>(size));
+            const size_t type_pos = out.size();
+            out.insert(out.end(), type, type + 4);
+            out.insert(out.end(), data, data + size);
+            put_u32(out, static_cast<uint32_t>(crc32(0L, out.data() + type_pos, static_cast<uInt>(size + 4))));
+        }
+    } // namespace
+
+    MrcLayers split_mrc(const CImg<uint> &image, const int scale)
+    {
+        if (scale < 1)
+        {
+            throw std::invalid_argument("MRC scale must be at least 1.");
+        }
+
+        MrcLayers layers;
+        layers.scale = scale;
+        if (image.is_empty())
+        {
+            return layers;
+        }
+
+        const int w = image.width();
+        const int h = image.height();
+        const int channels = image.spectrum();
+        const size_t plane = static_cast<size_t>(w) * h;
+
+        // Mask: any channel below white is foreground
+        layers.mask.assign(w, h, 1, 1);
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < h; ++y)
+        {
+            const uint* src = image.data() + static_cast<size_t>(y) * w;
+            uint* dst = layers.mask.data() + static_cast<size_t>(y) * w;
+            for (int x = 0; x < w; ++x)
+            {
+                bool white = true;
+                for (int c = 0; c < channels; ++c)
+                    white = white && src[c * plane + x] >= 255;
+                dst[x] = white ? 255 : 0;
+            }
+        }
+
+        // Foreground: mean color of the foreground pixels of each block
+        const int bw = (w + scale - 1) / scale;
+        const int bh = (h + scale - 1) / scale;
+        layers.foreground.assign(bw, bh, 1, channels, 255);
+        std::vector<uint32_t> counts(static_cast<size_t>(bw) * bh, 0);
+        std::vector<uint64_t> totals(static_cast<size_t>(channels) + 1, 0);
+
+#pragma omp parallel
+        {
+            std::vector<uint64_t> sums(channels);
+            std::vector<uint64_t> local_totals(static_cast<size_t>(channels) + 1, 0);
+
+#pragma omp for schedule(static)
+            for (int by = 0; by < bh; ++by)
+            {
+                const int y1 = std::min(h, (by + 1) * scale);
+                for (int bx = 0; bx < bw; ++bx)
+                {
+                    const int x1 = std::min(w, (bx + 1) * scale);
+                    std::fill(sums.begin(), sums.end(), 0);
+                    uint32_t n = 0;
+                    for (int y = by * scale; y < y1; ++y)
+                    {
+                        const size_t row = static_cast<size_t>(y) * w;
+                        for (int x = bx * scale; x < x1; ++x)
+                        {
+                            if (layers.mask[row + x] != 0)
+                                continue;
+                            for (int c = 0; c < channels; ++c)
+                                sums[c] += image[c * plane + row + x];
+                            ++n;
+                        }
+                    }
+
+                    counts[static_cast<size_t>(by) * bw + bx] = n;
+                    if (n == 0)
+                        continue;
+                    for (int c = 0; c < channels; ++c)
+                    {
+                        layers.foreground(bx, by, 0, c) = static_cast<uint>((sums[c] + n / 2) / n);
+                        local_totals[c] += sums[c];
+                    }
+                    local_totals[channels] += n;
+                }
+            }
+
+#pragma omp critical
+            for (size_t i = 0; i < totals.size(); ++i)
+                totals[i] += local_totals[i];
+        }
+
+        // Blocks without foreground are never shown; the overall ink color keeps them smooth
+        const uint64_t n = totals[channels];
+        if (n == 0)
+        {
+            return layers;
+        }
+        for (int c = 0; c < channels; ++c)
+        {
+            const uint mean = static_cast<uint>((totals[c] + n / 2) / n);
+            uint* dst = layers.foreground.data(0, 0, 0, c);
+            for (size_t i = 0; i < counts.size(); ++i)
+                if (counts[i] == 0)
+                    dst[i] = mean;
+        }
+        return layers;
+    }
+
+    CImg<uint> compose_mrc(const MrcLayers &layers)
+    {
+        const CImg<uint> &mask = layers.mask;
+        const CImg<uint> &fg = layers.foreground;
+        if (mask.is_empty())
+        {
+            return {};
+        }
+        if (layers.scale < 1 || fg.width() * layers.scale < mask.width() || fg.height() * layers.scale < mask.height())
+        {
+            throw std::invalid_argument("Foreground layer does not cover the mask.");
+        }
+
+        const int w = mask.width();
+        const int h = mask.height();
+        const int channels = fg.spectrum();
+        CImg<uint> output(w, h, 1, channels);
+
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int c = 0; c < channels; ++c)
+        {
+            for (int y = 0; y < h; ++y)
+            {
+                const uint* m = mask.data(0, y);
+                const uint* f = fg.data(0, y / layers.scale, 0, c);
+                uint* dst = output.data(0, y, 0, c);
+                for (int x = 0; x < w; ++x)
+                    dst[x] = (m[x] == 255) ? 255u : f[x / layers.scale];
+            }
+        }
+        return output;
+    }
+
+    void save_bilevel_png(const CImg<uint> &mask, const std::string &filepath)
+    {
+        const int w = mask.width();
+        const int h = mask.height();
+
+        // Raw image data: every row is a filter byte (0 = none) and the pixels MSB first, 1 = white
+        const size_t row_bytes = 1 + (static_cast<size_t>(w) + 7) / 8;
+        std::vector<unsigned char> raw(row_bytes * h, 0);
+#pragma omp parallel for schedule(static)
+        for (int y = 0; y < h; ++y)
+        {
+            const uint* src = mask.data(0, y);
+            unsigned char* dst = raw.data() + static_cast<size_t>(y) * row_bytes + 1;
+            for (int x = 0; x < w; ++x)
+                dst[x / 8] |= static_cast<unsigned char>((src[x] == 255) << (7 - x % 8));
+        }
+
+        uLongf packed_size = compressBound(static_cast<uLong>(raw.size()));
+        std::vector<unsigned char> packed(packed_size);
+        if (compress2(packed.data(), &packed_size, raw.data(), static_cast<uLong>(raw.size()), Z_DEFAULT_COMPRESSION) != Z_OK)
+        {
+            throw std::runtime_error("Failed to compress " + filepath);
+        }
+
+        std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+        std::vector<unsigned char> header;
+        put_u32(header, static_cast<uint32_t>(w));
+        put_u32(header, static_cast<uint32_t>(h));
+        header.insert(header.end(), {1, 0, 0, 0, 0}); // 1 bit grayscale, deflate, adaptive filters, no interlace
+        put_chunk(png, "IHDR", header.data(), header.size());
+        put_chunk(png, "IDAT", packed.data(), packed_size);
+        put_chunk(png, "IEND", nullptr, 0);
+
+        std::ofstream file(filepath, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(png.data()), static_cast<std::streamsize>(png.size()));
+        if (!file)
+        {
+            throw std::runtime_error("Failed to write " + filepath);
+        }
+    }
+
+    void save_mrc(const MrcLayers &layers, const std::string &base_path, const int jpeg_quality)
+    {
+        save_bilevel_png(layers.mask, base_path + ".mask.png");
+        layers.foreground.save_jpeg((base_path + ".fg.jpg").c_str(), static_cast<unsigned int>(jpeg_quality));
+    }
+
+} // namespace ite::io
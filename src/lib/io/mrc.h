@@ -0,0 +1,62 @@
+#pragma once
+/**
+ * @file mrc.h
+ * @brief Mixed raster content (MRC) output: a full-resolution bilevel text layer plus a low-resolution color layer.
+ */
+
+#include <string>
+#include "CImg.h"
+
+using namespace cimg_library;
+
+namespace ite::io
+{
+
+    /**
+     * @brief The two layers of a mixed raster content page.
+     *
+     * The page is white where `mask` is 255 and `foreground(x / scale, y / scale)` where it is 0. Color-pass results
+     * are white almost everywhere, so the bilevel mask carries the shapes at full resolution and the color of the
+     * text only needs a coarse grid.
+     */
+    struct MrcLayers
+    {
+        CImg<uint> mask; ///< 1 channel, 0 = foreground, 255 = background
+        CImg<uint> foreground; ///< Mean foreground color per scale x scale block, same channels as the page
+        int scale = 8; ///< Block size of the foreground layer
+    };
+
+    /**
+     * @brief Splits a page into MRC layers. Every pixel that is not pure white (255 in all channels) is foreground.
+     *
+     * Each foreground block holds the mean color of its foreground pixels; blocks without any take the mean color of
+     * all foreground pixels, so the layer has no edges at the text that would cost bits in the encoder.
+     *
+     * @param image The page, e.g. the result of a color pass (1 or 3 channels).
+     * @param scale Block size of the foreground layer (default: 8).
+     * @throws std::invalid_argument if `scale` < 1.
+     */
+    MrcLayers split_mrc(const CImg<uint> &image, int scale = 8);
+
+    /**
+     * @brief Renders MRC layers back into a full-resolution page.
+     * @throws std::invalid_argument if the foreground layer does not cover the mask at the layer's scale.
+     */
+    CImg<uint> compose_mrc(const MrcLayers &layers);
+
+    /**
+     * @brief Writes MRC layers as paired files: `<base_path>.mask.png` (1 bit per pixel) and `<base_path>.fg.jpg`.
+     * @param layers The layers to write.
+     * @param base_path Output path without extension.
+     * @param jpeg_quality Quality of the foreground layer (default: 75).
+     * @throws std::runtime_error if the mask cannot be written, CImgIOException if the color layer cannot.
+     */
+    void save_mrc(const MrcLayers &layers, const std::string &base_path, int jpeg_quality = 75);
+
+    /**
+     * @brief Writes a binary image (255 = white) as a 1-bit grayscale PNG.
+     * @throws std::runtime_error if the file cannot be written.
+     */
+    void save_bilevel_png(const CImg<uint> &mask, const std::string &filepath);
+
+} // namespace ite::io
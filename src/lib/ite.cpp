@@ -9,35 +9,28 @@
 #include "ite.h"
 
 #include "binarization/binarization.h"
+#include "color/background.h"
 #include "color/color.h"
 #include "color/contrast.h"
 #include "color/grayscale.h"
+#include "core/histogram.h"
 #include "filters/filters.h"
 #include "geometry/geometry.h"
+#include "geometry/resample.h"
+#include "geometry/resolution.h"
 #include "io/image_io.h"
+#include "io/mrc.h"
 #include "morphology/morphology.h"
+#include "pipeline/pipeline.h"
 
-#include <chrono> // Added for high-resolution timing
-#include <iostream> // Added for logging output
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
 
 namespace ite
 {
-    namespace
-    {
-        void record_time(TimingLog* log, const std::string &name, long long us, bool verbose = false)
-        {
-            if (log)
-            {
-                log->push_back({name, us});
-            }
-
-            if (verbose)
-            {
-                std::cout << "[ITE] " << name + ":\t" << us << " us" << std::endl;
-            }
-        }
-    } // namespace
-
     // ============================================================================
     // I/O Operations
     // ============================================================================
@@ -46,6 +39,8 @@ namespace ite
 
     CImg<uint> writeimage(const CImg<uint> &image, const std::string &filepath) { return io::save_image(image, filepath); }
 
+    void writemrc(const CImg<uint> &image, const std::string &base_path, const int scale) { io::save_mrc(io::split_mrc(image, scale), base_path); }
+
     // ============================================================================
     // Color Operations
     // ============================================================================
@@ -57,6 +52,11 @@ namespace ite
         return result;
     }
 
+    CImg<uint> normalize_polarity(const CImg<uint> &input_image)
+    {
+        return color::get_grayscale_rec601(input_image, binarization::detect_dark_background(input_image));
+    }
+
     CImg<uint> contrast_enhancement(const CImg<uint> &input_image)
     {
         CImg<uint> result = input_image;
@@ -64,6 +64,20 @@ namespace ite
         return result;
     }
 
+    CImg<uint> contrast_clahe(const CImg<uint> &input_image, const int tile_size, const float clip_limit)
+    {
+        CImg<uint> result = input_image;
+        color::contrast_clahe(result, tile_size, clip_limit);
+        return result;
+    }
+
+    CImg<uint> flatten_background(const CImg<uint> &input_image, const int window)
+    {
+        CImg<uint> result = color::get_grayscale_rec601(input_image);
+        color::flatten_background(result, window);
+        return result;
+    }
+
     CImg<uint> color_pass(const CImg<uint> &bin_image, const CImg<uint> &color_image)
     {
         CImg<uint> result = color_image;
@@ -75,7 +89,7 @@ namespace ite
     // Binarization
     // ============================================================================
 
-    CImg<uint> binarize_sauvola(const CImg<uint> &input_image, int window_size, float k, float delta)
+    CImg<uint> binarize_sauvola(const CImg<uint> &input_image, int window_size, float k, float delta, int threshold_scale)
     {
         CImg<uint> result = input_image;
         // Ensure grayscale first
@@ -83,11 +97,11 @@ namespace ite
         {
             color::to_grayscale_rec601(result);
         }
-        binarization::binarize_sauvola(result, window_size, k, delta);
+        binarization::binarize_sauvola(result, window_size, k, delta, threshold_scale);
         return result;
     }
 
-    CImg<uint> binarize_otsu(const CImg<uint> &input_image)
+    CImg<uint> binarize_otsu(const CImg<uint> &input_image, const int tile_size, const int thresholds)
     {
         CImg<uint> result = input_image;
         // Ensure grayscale first
@@ -95,11 +109,11 @@ namespace ite
         {
             color::to_grayscale_rec601(result);
         }
-        binarization::binarize_otsu(result);
+        binarization::binarize_otsu(result, tile_size, thresholds);
         return result;
     }
 
-    CImg<uint> binarize_bataineh(const CImg<uint> &input_image)
+    CImg<uint> binarize_niblack(const CImg<uint> &input_image, int window_size, float k)
     {
         CImg<uint> result = input_image;
         // Ensure grayscale first
@@ -107,10 +121,76 @@ namespace ite
         {
             color::to_grayscale_rec601(result);
         }
-        binarization::binarize_bataineh(result);
+        binarization::binarize_niblack(result, window_size, k);
         return result;
     }
 
+    CImg<uint> binarize_wolf(const CImg<uint> &input_image, int window_size, float k)
+    {
+        CImg<uint> result = input_image;
+        // Ensure grayscale first
+        if (result.spectrum() != 1)
+        {
+            color::to_grayscale_rec601(result);
+        }
+        binarization::binarize_wolf(result, window_size, k);
+        return result;
+    }
+
+    CImg<uint> binarize_phansalkar(const CImg<uint> &input_image, int window_size, float k)
+    {
+        CImg<uint> result = input_image;
+        // Ensure grayscale first
+        if (result.spectrum() != 1)
+        {
+            color::to_grayscale_rec601(result);
+        }
+        binarization::binarize_phansalkar(result, window_size, k);
+        return result;
+    }
+
+    CImg<uint> binarize_nick(const CImg<uint> &input_image, int window_size, float k)
+    {
+        CImg<uint> result = input_image;
+        // Ensure grayscale first
+        if (result.spectrum() != 1)
+        {
+            color::to_grayscale_rec601(result);
+        }
+        binarization::binarize_nick(result, window_size, k);
+        return result;
+    }
+
+    CImg<uint> binarize_bataineh(const CImg<uint> &input_image, int threshold_scale)
+    {
+        CImg<uint> result = input_image;
+        // Ensure grayscale first
+        if (result.spectrum() != 1)
+        {
+            color::to_grayscale_rec601(result);
+        }
+        binarization::binarize_bataineh(result, threshold_scale);
+        return result;
+    }
+
+    double f_measure(const CImg<uint> &result, const CImg<uint> &reference) { return binarization::f_measure(result, reference); }
+
+    double threshold_scale_fmeasure(const CImg<uint> &input_image, BinarizationMethod method, int threshold_scale, int window_size, float k, float delta)
+    {
+        switch (method)
+        {
+        case BinarizationMethod::Sauvola:
+            return binarization::f_measure(binarize_sauvola(input_image, window_size, k, delta, threshold_scale),
+                                           binarize_sauvola(input_image, window_size, k, delta, 1));
+        case BinarizationMethod::Bataineh:
+            return binarization::f_measure(binarize_bataineh(input_image, threshold_scale), binarize_bataineh(input_image, 1));
+        default:
+            // Otsu is global, the other local methods are always evaluated per pixel
+            break;
+        }
+        return 1.0;
+    }
+
     // ============================================================================
     // Morphological Operations
     // ============================================================================
@@ -136,17 +216,51 @@ namespace ite
         return result;
     }
 
+    CImg<uint> remove_lines(const CImg<uint> &input_image, const int min_length)
+    {
+        CImg<uint> result = input_image;
+        morphology::remove_lines(result, min_length);
+        return result;
+    }
+
     // ============================================================================
     // Geometric Transformations
     // ============================================================================
 
-    CImg<uint> deskew(const CImg<uint> &input_image, int boundary_conditions)
+    CImg<uint> deskew(const CImg<uint> &input_image, int boundary_conditions, bool detect_orientation)
     {
         CImg<uint> result = input_image;
-        geometry::deskew_projection_profile(result, boundary_conditions);
+        if (!detect_orientation)
+        {
+            geometry::deskew_projection_profile(result, boundary_conditions);
+            return result;
+        }
+
+        const geometry::PageRotation rotation = geometry::detect_page_rotation(input_image, true);
+        if (rotation.angle() != 0.0)
+        {
+            result = geometry::rotate(input_image, rotation.angle(), geometry::Interpolation::Cubic, boundary_conditions);
+        }
         return result;
     }
 
+    CImg<uint> auto_crop(const CImg<uint> &input_image)
+    {
+        const geometry::Box box = geometry::detect_content_bounds(input_image);
+        return input_image.get_crop(box.x0, box.y0, box.x1, box.y1);
+    }
+
+    CImg<uint> normalize_dpi(const CImg<uint> &input_image, int target_dpi)
+    {
+        const double scale = geometry::dpi_normalization_scale(input_image, target_dpi);
+        if (scale >= 1.0)
+        {
+            return input_image;
+        }
+        return geometry::resize_area(input_image, std::max(1, static_cast<int>(std::lround(input_image.width() * scale))),
+                                     std::max(1, static_cast<int>(std::lround(input_image.height() * scale))));
+    }
+
     // ============================================================================
     // Filters / Denoising
     // ============================================================================
@@ -183,148 +297,156 @@ namespace ite
     // Full Enhancement Pipeline
     // ============================================================================
 
-    CImg<uint> enhance(const CImg<uint> &input_image, const EnhanceOptions &opt, const int block_h, TimingLog* log, bool verbose)
-    {
-        using Clock = std::chrono::steady_clock;
-        using Us = std::chrono::microseconds;
+    EnhanceCache::EnhanceCache() : chain_(std::make_unique<pipeline::StageChain>()) {}
+    EnhanceCache::~EnhanceCache() = default;
+    EnhanceCache::EnhanceCache(EnhanceCache &&) noexcept = default;
+    EnhanceCache &EnhanceCache::operator=(EnhanceCache &&) noexcept = default;
 
-        auto total_start = Clock::now();
-        auto step_start = total_start;
+    void EnhanceCache::clear() { chain_->clear(); }
 
-        CImg<uint> result = input_image;
-        CImg<uint> color_image;
+    size_t EnhanceCache::size() const { return chain_->size(); }
 
-        // Preserve color image if color pass is requested
-        if (opt.do_color_pass)
+    CImg<uint> enhance(const CImg<uint> &input_image, const EnhanceOptions &opt, const int block_h, TimingLog* log, bool verbose, EnhanceCache* cache)
+    {
+        if (!cache)
         {
-            color_image = input_image;
+            return pipeline::run_stages(pipeline::build_stages(input_image, opt, block_h), log, verbose);
         }
 
-        auto now = Clock::now();
-        record_time(log, "Init & Copy", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-        step_start = now;
+        const auto lookup_start = std::chrono::steady_clock::now();
+        pipeline::StageChain &chain = cache->chain();
+        chain.set_input(input_image);
+        pipeline::record_time(log, "Cache Lookup",
+                              std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - lookup_start).count(), verbose);
 
-        // 2. Grayscale
-        color::to_grayscale_rec601(result);
-        now = Clock::now();
-        record_time(log, "Grayscale", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-        step_start = now;
+        // The DPI estimate depends only on the input, so it is kept with the cached stages
+        const double dpi_scale = opt.do_dpi_normalization ? chain.dpi_scale(input_image, opt.target_dpi) : 1.0;
+        return chain.run(pipeline::build_stages(input_image, opt, block_h, nullptr, &dpi_scale), log, verbose);
+    }
 
-        // 3. Deskew
-        if (opt.do_deskew)
+    CImg<uint> enhance_region(const CImg<uint> &input_image, const Rect &rect, const EnhanceOptions &opt, const CImg<uint> &previous_result,
+                              const int block_h, TimingLog* log, bool verbose, const int global_tolerance)
+    {
+        using Clock = std::chrono::steady_clock;
+        using Us = std::chrono::microseconds;
+
+        // The output grid of DPI normalization and auto-crop depends on the whole page
+        if (opt.do_dpi_normalization || opt.do_auto_crop)
         {
-            geometry::deskew_projection_profile(result, opt.boundary_conditions);
-            if (opt.do_color_pass)
-            {
-                geometry::deskew_projection_profile(color_image, opt.boundary_conditions);
-            }
-            now = Clock::now();
-            record_time(log, "Deskew", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            return enhance(input_image, opt, block_h, log, verbose);
         }
 
-        // 4. Contrast
-        color::contrast_linear_stretch(result);
-        now = Clock::now();
-        record_time(log, "Contrast", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-        step_start = now;
-
-        // 5. Denoising
-        if (opt.do_adaptive_gaussian_blur)
+        const int w = input_image.width();
+        const int h = input_image.height();
+        if (previous_result.width() != w || previous_result.height() != h || previous_result.depth() != input_image.depth())
         {
-            filters::adaptive_gaussian_blur(result, opt.adaptive_sigma_low, opt.adaptive_sigma_high, opt.adaptive_edge_thresh, block_h,
-                                            opt.boundary_conditions);
-            now = Clock::now();
-            record_time(log, "Adaptive Gaussian", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            throw std::invalid_argument("The previous result must have the size of the input image.");
         }
-        else if (opt.do_gaussian_blur)
+
+        const int x0 = std::max(0, rect.x), y0 = std::max(0, rect.y);
+        const int x1 = std::min(w, rect.x + rect.width) - 1, y1 = std::min(h, rect.y + rect.height) - 1;
+        if (x1 < x0 || y1 < y0)
         {
-            filters::simple_gaussian_blur(result, opt.sigma, opt.boundary_conditions);
-            now = Clock::now();
-            record_time(log, "Gaussian Blur", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            return previous_result;
         }
 
-        if (opt.do_median_blur)
+        // 1. Contrast range of the edited image. Previous and new range share all pixels outside the rectangle,
+        // so both lie between the percentiles of the outside pixels at the cutoff and at the cutoff minus the rectangle's size.
+        auto step_start = Clock::now();
+        const CImg<uint> gray = color::get_grayscale_rec601(input_image);
+        core::Histogram outside = core::compute_histogram(gray);
+        const core::Histogram inside = core::compute_histogram(gray.get_crop(x0, y0, 0, 0, x1, y1, gray.depth() - 1, 0));
+        for (int i = 0; i < 256; ++i)
+            outside.bins[i] -= inside.bins[i];
+
+        const long long cutoff = static_cast<long long>(gray.size()) / 100;
+        const color::StretchRange range = color::contrast_stretch_range(gray);
+        const color::StretchRange tight = color::stretch_range(outside.bins, cutoff);
+        const color::StretchRange loose = color::stretch_range(outside.bins, cutoff - static_cast<long long>(inside.count));
+        const bool range_stable = static_cast<int>(tight.low - loose.low) <= global_tolerance &&
+                                  static_cast<int>(loose.high - tight.high) <= global_tolerance && tight.high > tight.low;
+        pipeline::record_time(log, "Region Statistics", std::chrono::duration_cast<Us>(Clock::now() - step_start).count(), verbose);
+
+        // 2. Halo of the region: the sum of the stage halos (a stage needs its input around the pixels of the next one)
+        const CImg<uint> probe;
+        int halo = 0;
+        bool local = range_stable;
+        int alignment = 1;
+        for (const auto &stage : pipeline::build_stages(probe, opt, block_h, &range))
         {
-            filters::simple_median_blur(result, opt.median_kernel_size, opt.median_threshold);
-            now = Clock::now();
-            record_time(log, "Median Blur", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            local = local && stage.halo != pipeline::GLOBAL;
+            halo += std::max(stage.halo, 0);
         }
-
-        if (opt.do_adaptive_median)
+        if (opt.binarization_method == BinarizationMethod::Sauvola && opt.threshold_scale > 1)
         {
-            filters::adaptive_median_filter(result, opt.adaptive_median_max_window, block_h);
-            now = Clock::now();
-            record_time(log, "Adaptive Median", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            alignment = opt.threshold_scale; // the threshold surface grid starts at the crop origin
         }
-
-        // 6. Binarization
-        switch (opt.binarization_method)
+        if (!local)
         {
-        case BinarizationMethod::Otsu:
-            binarization::binarize_otsu(result);
-            now = Clock::now();
-            record_time(log, "Binarization (Otsu)", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            break;
-        case BinarizationMethod::Sauvola:
-            binarization::binarize_sauvola(result, opt.sauvola_window_size, opt.sauvola_k, opt.sauvola_delta);
-            now = Clock::now();
-            record_time(log, "Binarization (Sauvola)", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            break;
-        case BinarizationMethod::Bataineh:
-            binarization::binarize_bataineh(result);
-            now = Clock::now();
-            record_time(log, "Binarization (Bataineh)", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            break;
+            return enhance(input_image, opt, block_h, log, verbose);
         }
-        step_start = now;
 
-        // 7. Morphology
-        if (opt.do_despeckle)
+        // 3. The edit changes the output up to one halo around the rectangle, which in turn needs one more halo of input.
+        // Enhance that crop using the contrast range of the whole image
+        const int ox0 = std::max(0, x0 - halo), oy0 = std::max(0, y0 - halo);
+        const int ox1 = std::min(w - 1, x1 + halo), oy1 = std::min(h - 1, y1 + halo);
+        const int cx0 = std::max(0, ox0 - halo) / alignment * alignment, cy0 = std::max(0, oy0 - halo) / alignment * alignment;
+        const int cx1 = std::min(w - 1, ox1 + halo), cy1 = std::min(h - 1, oy1 + halo);
+        const CImg<uint> patch = input_image.get_crop(cx0, cy0, 0, 0, cx1, cy1, input_image.depth() - 1, input_image.spectrum() - 1);
+        const CImg<uint> patch_result = pipeline::run_stages(pipeline::build_stages(patch, opt, block_h, &range), log, verbose);
+        if (patch_result.spectrum() != previous_result.spectrum())
         {
-            morphology::despeckle_ccl(result, static_cast<uint>(opt.despeckle_threshold), opt.diagonal_connections);
-            now = Clock::now();
-            record_time(log, "Despeckle", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            throw std::invalid_argument("The previous result does not match the options (color pass).");
         }
 
-        if (opt.do_dilation)
+        // 4. Splice the affected area into the previous result
+        step_start = Clock::now();
+        CImg<uint> result = previous_result;
+        const int out_w = ox1 - ox0 + 1;
+#pragma omp parallel for collapse(3)
+        for (int c = 0; c < result.spectrum(); ++c)
         {
-            morphology::dilation_square(result, opt.kernel_size);
-            now = Clock::now();
-            record_time(log, "Dilation", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            for (int z = 0; z < result.depth(); ++z)
+            {
+                for (int y = oy0; y <= oy1; ++y)
+                {
+                    std::copy_n(patch_result.data(ox0 - cx0, y - cy0, z, c), out_w, result.data(ox0, y, z, c));
+                }
+            }
         }
+        pipeline::record_time(log, "Region Splice", std::chrono::duration_cast<Us>(Clock::now() - step_start).count(), verbose);
+        return result;
+    }
 
-        if (opt.do_erosion)
+    void enhance_sweep(const CImg<uint> &input_image, const std::vector<EnhanceOptions> &combinations, const SweepCallback &on_result, const int block_h,
+                       TimingLog* log, bool verbose)
+    {
+        // The DPI estimate depends only on the input and the target resolution, so it is taken once for all combinations
+        pipeline::StageChain chain;
+        chain.set_input(input_image);
+        std::vector<std::vector<pipeline::Stage>> stages;
+        stages.reserve(combinations.size());
+        for (const auto &opt : combinations)
         {
-            morphology::erosion_square(result, opt.kernel_size);
-            now = Clock::now();
-            record_time(log, "Erosion", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-            step_start = now;
+            const double dpi_scale = opt.do_dpi_normalization ? chain.dpi_scale(input_image, opt.target_dpi) : 1.0;
+            stages.push_back(pipeline::build_stages(input_image, opt, block_h, nullptr, &dpi_scale));
         }
 
-        // 8. Color Pass
-        if (opt.do_color_pass)
+        // Sorting by the stage keys puts combinations with a common prefix next to each other,
+        // so every distinct prefix is computed once and later combinations resume from it
+        std::vector<size_t> order(combinations.size());
+        std::iota(order.begin(), order.end(), size_t{0});
+        std::ranges::stable_sort(order,
+                                 [&](const size_t a, const size_t b)
+                                 {
+                                     return std::ranges::lexicographical_compare(stages[a], stages[b], {}, &pipeline::Stage::key, &pipeline::Stage::key);
+                                 });
+
+        for (const size_t index : order)
         {
-            color::color_pass_inplace(color_image, result);
-            now = Clock::now();
-            record_time(log, "Color Pass", std::chrono::duration_cast<Us>(now - step_start).count(), verbose);
-
-            auto total_time = std::chrono::duration_cast<Us>(now - total_start).count();
-            record_time(log, "TOTAL", total_time, verbose);
-            return color_image;
+            const CImg<uint> result = chain.run(stages[index], log, verbose);
+            on_result(index, result);
         }
-
-        now = Clock::now();
-        auto total_time = std::chrono::duration_cast<Us>(now - total_start).count();
-        record_time(log, "TOTAL", total_time, verbose);
-
-        return result;
     }
 
 } // namespace ite
@@ -1,4 +1,6 @@
 #pragma once
+#include <functional>
+#include <memory>
 #include <string>
 #include <vector>
 #include "CImg.h"
@@ -11,10 +13,16 @@ using namespace cimg_library;
  */
 namespace ite
 {
+    namespace pipeline
+    {
+        class StageChain;
+    }
+
     struct TimingEvent
     {
         std::string name;
         long long duration_us;
+        std::string detail; ///< Optional note of the step, e.g. the number of angles deskew scored
     };
 
     using TimingLog = std::vector<TimingEvent>;
@@ -26,7 +34,30 @@ namespace ite
     {
         Otsu,
         Sauvola,
-        Bataineh
+        Bataineh,
+        Niblack,
+        Wolf,
+        Phansalkar,
+        Nick
+    };
+
+    /**
+     *  @brief Skew estimators available.
+     */
+    enum class SkewMethod
+    {
+        ProjectionProfile,
+        Docstrum
+    };
+
+    /**
+     *  @brief Refinements of the projection-profile angle search around its 1 degree peak.
+     */
+    enum class DeskewSearch
+    {
+        Grid,
+        Golden,
+        Ternary
     };
 
     /**
@@ -45,6 +76,17 @@ namespace ite
      */
     CImg<uint> writeimage(const CImg<uint> &image, const std::string &filepath);
 
+    /**
+     * @brief Saves a page as mixed raster content: `<base_path>.mask.png`, a 1-bit layer of all non-white pixels at
+     * full resolution, and `<base_path>.fg.jpg`, their color on a grid of `scale` x `scale` blocks.
+     * Much smaller and faster to encode than the full RGB image for color-pass results, which are mostly white.
+     * @param image The page to save (e.g. an `enhance` result with color pass).
+     * @param base_path Output path without extension.
+     * @param scale Block size of the color layer (default: 8).
+     * @throws std::runtime_error if the mask cannot be written, CImgIOException if the color layer cannot.
+     */
+    void writemrc(const CImg<uint> &image, const std::string &base_path, int scale = 8);
+
     /**
      * @brief Converts an image to grayscale.
      * If the image is already 1-channel, a copy is returned.
@@ -53,6 +95,14 @@ namespace ite
      */
     CImg<uint> to_grayscale(const CImg<uint> &input_image);
 
+    /**
+     * @brief Converts an image to grayscale with dark text on a light background.
+     * Light-on-dark pages (see `binarization::detect_dark_background`) are inverted in the same pass.
+     * @param input_image The source image (can be 1 or 3 channels).
+     * @return A new 1-channel image.
+     */
+    CImg<uint> normalize_polarity(const CImg<uint> &input_image);
+
     /**
      * @brief Converts a grayscale image to a binary (black and white) image using Sauvola's method.
      * If the image is not grayscale, it is first converted to grayscale.
@@ -62,28 +112,95 @@ namespace ite
      * @param window_size The size of the local window (default: 15).
      * @param k Sauvola's parameter controlling threshold sensitivity (default: 0.2).
      * @param delta Optional offset subtracted from threshold (default: 0.0).
+     * @param threshold_scale Compute the threshold surface on a 1/threshold_scale grid and interpolate it (1 = exact, max 8; default: 1).
+     * @return A new 1-channel binary image (values 0 or 255).
+     */
+    CImg<uint> binarize_sauvola(const CImg<uint> &input_image, int window_size = 15, float k = 0.2f, float delta = 0.0f, int threshold_scale = 1);
+
+    /**
+     * @brief Converts an image to a binary image using Niblack's method (T = m + k * s).
+     * If the image is not grayscale, it is first converted to grayscale.
+     * @param input_image The source image (will be converted to grayscale if needed).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the local std. deviation (default: -0.2).
+     * @return A new 1-channel binary image (values 0 or 255).
+     */
+    CImg<uint> binarize_niblack(const CImg<uint> &input_image, int window_size = 15, float k = -0.2f);
+
+    /**
+     * @brief Converts an image to a binary image using Wolf and Jolion's method (for low-contrast, degraded documents).
+     * If the image is not grayscale, it is first converted to grayscale.
+     * @param input_image The source image (will be converted to grayscale if needed).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the contrast terms (default: 0.5).
+     * @return A new 1-channel binary image (values 0 or 255).
+     */
+    CImg<uint> binarize_wolf(const CImg<uint> &input_image, int window_size = 15, float k = 0.5f);
+
+    /**
+     * @brief Converts an image to a binary image using Phansalkar's method (for stained and historic documents).
+     * If the image is not grayscale, it is first converted to grayscale.
+     * @param input_image The source image (will be converted to grayscale if needed).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the local std. deviation (default: 0.25).
      * @return A new 1-channel binary image (values 0 or 255).
      */
-    CImg<uint> binarize_sauvola(const CImg<uint> &input_image, int window_size = 15, float k = 0.2f, float delta = 0.0f);
+    CImg<uint> binarize_phansalkar(const CImg<uint> &input_image, int window_size = 15, float k = 0.25f);
+
+    /**
+     * @brief Converts an image to a binary image using the NICK method (Niblack with a mean-shifted deviation).
+     * If the image is not grayscale, it is first converted to grayscale.
+     * @param input_image The source image (will be converted to grayscale if needed).
+     * @param window_size The size of the local window (default: 15).
+     * @param k Weight of the shifted deviation (default: -0.1).
+     * @return A new 1-channel binary image (values 0 or 255).
+     */
+    CImg<uint> binarize_nick(const CImg<uint> &input_image, int window_size = 15, float k = -0.1f);
 
     /**
      * @brief Converts a grayscale image to a binary (black and white) image using Otsu's method.
      * If the image is not grayscale, it is first converted to grayscale.
      * Otsu's method finds the optimal threshold that minimizes intra-class variance.
      * @param input_image The source image (will be converted to grayscale if needed).
+     * @param tile_size Tile edge length for per-tile thresholds, 0 = one global threshold (default: 0).
+     * @param thresholds Number of global Otsu thresholds, 1 to 3; only the darkest class is foreground (default: 1).
      * @return A new 1-channel binary image (values 0 or 255).
      */
-    CImg<uint> binarize_otsu(const CImg<uint> &input_image);
+    CImg<uint> binarize_otsu(const CImg<uint> &input_image, int tile_size = 0, int thresholds = 1);
 
     /**
      * @brief Converts a grayscale image inplace to a binary (black and white) image using Bataineh's method.
      * If the image is not grayscale, it is first converted to grayscale.
      * Bataineh's method uses adaptive thresholding for local windows. Window size is determined adaptively based on image characteristics.
      * @param input_image The source grayscale image.
-     * @param window_size The size of the window used for adaptive thresholding.
+     * @param threshold_scale Compute the threshold surface on a 1/threshold_scale grid and interpolate it (1 = exact, max 8; default: 1).
      * @return A new 1-channel binary image (values 0 or 255).
      */
-    CImg<uint> binarize_bataineh(const CImg<uint> &input_image);
+    CImg<uint> binarize_bataineh(const CImg<uint> &input_image, int threshold_scale = 1);
+
+    /**
+     * @brief Computes the F-measure of a binary image against a reference binary image (foreground = black).
+     * @param result The binary image to evaluate.
+     * @param reference The reference binary image.
+     * @return F-measure in [0, 1]; 1.0 means the foreground is identical.
+     */
+    double f_measure(const CImg<uint> &result, const CImg<uint> &reference);
+
+    /**
+     * @brief Reports how much a coarser threshold surface changes the binarization of an image.
+     * The image is converted to grayscale and binarized twice with the given method, once with
+     * full-resolution thresholds and once with `threshold_scale`. The F-measure delta is `1.0 - result`.
+     * Only Sauvola and Bataineh support coarser surfaces; all other methods report 1.0.
+     * @param input_image The source image (will be converted to grayscale if needed).
+     * @param method The binarization method to evaluate.
+     * @param threshold_scale The grid spacing of the approximated threshold surface.
+     * @param window_size Sauvola window size (default: 15).
+     * @param k Sauvola's k (default: 0.2).
+     * @param delta Sauvola's delta (default: 0.0).
+     * @return F-measure of the scaled result against the full-resolution result.
+     */
+    double threshold_scale_fmeasure(const CImg<uint> &input_image, BinarizationMethod method, int threshold_scale, int window_size = 15, float k = 0.2f,
+                                    float delta = 0.0f);
 
     /**
      * @brief Applies a simple Gaussian blur to blur the image.
@@ -153,9 +270,28 @@ namespace ite
      * Finds the dominant text angle and rotates the image to be level.
      * @param input_image The source image (typically grayscale).
      * @param boundary_conditions The type of boundary conditions to use. See `CImg::blur()` in `CImg.h` for more info (default: 1 = Neumann).
+     * @param detect_orientation Whether to also turn sideways or upside-down pages upright (default: false).
      * @return A new, deskewed image.
      */
-    CImg<uint> deskew(const CImg<uint> &input_image, int boundary_conditions = 1);
+    CImg<uint> deskew(const CImg<uint> &input_image, int boundary_conditions = 1, bool detect_orientation = false);
+
+    /**
+     * @brief Crops the image to its content, removing empty margins and dark scanner borders.
+     * See `geometry::detect_content_bounds`; images without anything to crop are returned unchanged.
+     * @param input_image The source image (grayscale or color).
+     * @return A new, cropped image.
+     */
+    CImg<uint> auto_crop(const CImg<uint> &input_image);
+
+    /**
+     * @brief Downscales an image so that its text has the given resolution.
+     * The resolution is estimated from the x-height of the text (see `geometry::estimate_x_height`).
+     * Images at or below the target, or without measurable text, are returned unchanged.
+     * @param input_image The source image (grayscale or color).
+     * @param target_dpi The working resolution (default: 300).
+     * @return The downscaled image.
+     */
+    CImg<uint> normalize_dpi(const CImg<uint> &input_image, int target_dpi = 300);
 
     /**
      * @brief Enhances the contrast of the image.
@@ -165,6 +301,25 @@ namespace ite
      */
     CImg<uint> contrast_enhancement(const CImg<uint> &input_image);
 
+    /**
+     * @brief Enhances the local contrast with contrast-limited adaptive histogram equalization.
+     * See `color::contrast_clahe`; every channel is equalized on its own.
+     * @param input_image The source image (typically grayscale).
+     * @param tile_size Side of the tiles in pixels, at least 8 (default: 64).
+     * @param clip_limit Histogram clip limit relative to the mean bin count (default: 2).
+     * @return A new, locally equalized image.
+     */
+    CImg<uint> contrast_clahe(const CImg<uint> &input_image, int tile_size = 64, float clip_limit = 2.0f);
+
+    /**
+     * @brief Corrects uneven illumination by dividing out an estimate of the paper brightness.
+     * See `color::flatten_background`; color images are converted to grayscale first.
+     * @param input_image The source image (grayscale or color).
+     * @param window Side of the background window in pixels, larger than the widest stroke (default: 51).
+     * @return A new grayscale image on uniformly white paper.
+     */
+    CImg<uint> flatten_background(const CImg<uint> &input_image, int window = 51);
+
     /**
      * @brief Removes small connected components (speckles) from a binary image.
      * Components smaller than the specified threshold are removed.
@@ -175,6 +330,15 @@ namespace ite
      */
     CImg<uint> despeckle(const CImg<uint> &input_image, uint threshold, bool diagonal_connections = true);
 
+    /**
+     * @brief Removes long horizontal and vertical lines (staff lines, table rules, underlines) from a binary image.
+     * Strokes crossing a line keep their pixels on it. See `morphology::remove_lines`.
+     * @param input_image The source binary image (0 = text, 255 = background).
+     * @param min_length Shortest black run in pixels that counts as a line (default: 101).
+     * @return A new image without the lines.
+     */
+    CImg<uint> remove_lines(const CImg<uint> &input_image, int min_length = 101);
+
     /**
      * @brief Applies a color pass to the binary image using the color image.
      * This function overlays a color image onto a binary image, preserving the binary structure.
@@ -241,12 +405,110 @@ namespace ite
         BinarizationMethod binarization_method = BinarizationMethod::Sauvola;
 
         // --- Sauvola Binarization Options ---
-        /** @brief The size of the local window for Sauvola binarization (default: 15). */
+        /** @brief The size of the local window for Sauvola binarization, shared by Niblack, Wolf, Phansalkar and NICK (default: 15). */
         int sauvola_window_size = 15;
         /** @brief The sensitivity parameter 'k' for Sauvola binarization (default: 0.2f). */
         float sauvola_k = 0.2f;
         /** @brief The optional offset 'delta' for Sauvola binarization (default: 0.0f). */
         float sauvola_delta = 0.0f;
+
+        /** @brief Grid spacing of the local threshold surface for Sauvola/Bataineh (1 = per pixel, 2..8 = interpolated; default: 1). */
+        int threshold_scale = 1;
+
+        // --- Other local binarization options (window: sauvola_window_size) ---
+        /** @brief Niblack's weight of the local std. deviation (default: -0.2f). */
+        float niblack_k = -0.2f;
+        /** @brief Wolf-Jolion's weight of the contrast terms (default: 0.5f). */
+        float wolf_k = 0.5f;
+        /** @brief Phansalkar's weight of the local std. deviation (default: 0.25f). */
+        float phansalkar_k = 0.25f;
+        /** @brief NICK's weight of the shifted deviation (default: -0.1f). */
+        float nick_k = -0.1f;
+
+        /** @brief Tile size of Otsu's per-tile thresholds (0 = one global threshold; default: 0). */
+        int otsu_tile_size = 0;
+        /** @brief Number of global Otsu thresholds (1-3); with more than one, mid-tone classes join the background (default: 1). */
+        int otsu_thresholds = 1;
+
+        // --- Resolution Options ---
+        /** @brief Whether to first downscale the input to `target_dpi`; windows, kernels and sigmas are scaled along (default false). */
+        bool do_dpi_normalization = false;
+        /** @brief Working resolution of DPI normalization; the input resolution is estimated from the text's x-height (default: 300). */
+        int target_dpi = 300;
+
+        // --- Crop Options ---
+        /** @brief Whether to crop the page to its content (and inside dark scanner borders) before deskew (default false). */
+        bool do_auto_crop = false;
+        /** @brief Whether to paste the cropped result back onto a white page of the uncropped size (default false). */
+        bool crop_paste_back = false;
+
+        // --- Orientation Options ---
+        /** @brief Whether to detect sideways and upside-down pages and turn them upright, in the same rotation as deskew (default false). */
+        bool do_orientation = false;
+        /** @brief How deskew estimates the angle; docstrum suits sparse pages such as music sheets (default: ProjectionProfile). */
+        SkewMethod skew_method = SkewMethod::ProjectionProfile;
+        /** @brief Refinement of the projection-profile search: 0.2 and 0.05 degree grids, golden-section or ternary search (default: Grid). */
+        DeskewSearch deskew_search = DeskewSearch::Grid;
+        /** @brief Relative score drop at +-0.1 degrees that marks a page as straight without searching (0 = always search; default: 0.01f). */
+        float deskew_early_exit = 0.01f;
+        /** @brief Maximum number of angles the projection-profile search scores (0 = no limit; default: 0). */
+        int deskew_max_evaluations = 0;
+
+        // --- Background Options ---
+        /** @brief Whether to divide out uneven illumination (shading, photographed pages) before contrast stretching (default false). */
+        bool do_background_flattening = false;
+        /** @brief Background window of the flattening in pixels; must exceed the widest stroke (default: 51). */
+        int background_window = 51;
+
+        // --- CLAHE Options ---
+        /** @brief Whether to replace the global contrast stretch by contrast-limited adaptive histogram equalization (default false). */
+        bool do_clahe = false;
+        /** @brief Tile size of CLAHE in pixels, at least 8 (default: 64). */
+        int clahe_tile_size = 64;
+        /** @brief Histogram clip limit of CLAHE relative to the mean bin count (default: 2.0f). */
+        float clahe_clip_limit = 2.0f;
+
+        // --- Polarity Options ---
+        /**
+         * @brief Whether to detect light-on-dark pages and invert them during grayscale conversion, so every binarizer sees dark text (default false).
+         * The color pass then keeps the text of an inverted page in inverted colors, so light text stays visible on white.
+         */
+        bool do_auto_polarity = false;
+
+        // --- Line Removal Options ---
+        /** @brief Whether to remove long horizontal and vertical lines after binarization, keeping strokes that cross them (default false). */
+        bool do_line_removal = false;
+        /** @brief Shortest black run in pixels that counts as a line; must exceed the longest character stroke (default: 101). */
+        int line_min_length = 101;
+    };
+
+    /**
+     * @brief Intermediate results of `enhance`, for re-running it on the same image with changed options.
+     *
+     * Holds the output of every stage of the last run, keyed by the input content and the options each
+     * stage depends on. A re-run resumes from the deepest stage that is still valid, e.g. changing only
+     * `despeckle_threshold` re-runs despeckling and the steps after it. A different input starts over.
+     * Memory use is about one image per pipeline stage.
+     */
+    class EnhanceCache
+    {
+    public:
+        EnhanceCache();
+        ~EnhanceCache();
+        EnhanceCache(EnhanceCache &&) noexcept;
+        EnhanceCache &operator=(EnhanceCache &&) noexcept;
+
+        /** @brief Drops all cached stages. */
+        void clear();
+
+        /** @brief Number of cached stage outputs. */
+        size_t size() const;
+
+        /** @brief The underlying stage chain (used by `enhance`). */
+        pipeline::StageChain &chain() { return *chain_; }
+
+    private:
+        std::unique_ptr<pipeline::StageChain> chain_;
     };
 
     /**
@@ -255,7 +517,63 @@ namespace ite
      * @param input_image The source image.
      * @param opt The enhancement options.
      * @param block_h Height of the blocks for parallel processing (default: 64).
+     * @param cache Optional cache of intermediate results; re-runs on the same input resume from the deepest valid stage.
      * @return An enhanced image, ready for OCR.
      */
-    CImg<uint> enhance(const CImg<uint> &input_image, const EnhanceOptions &opt = {}, int block_h = 64, TimingLog* log = nullptr, bool verbose = false);
+    CImg<uint> enhance(const CImg<uint> &input_image, const EnhanceOptions &opt = {}, int block_h = 64, TimingLog* log = nullptr, bool verbose = false,
+                       EnhanceCache* cache = nullptr);
+
+    /**
+     * @brief Axis-aligned pixel rectangle.
+     */
+    struct Rect
+    {
+        int x = 0;
+        int y = 0;
+        int width = 0;
+        int height = 0;
+    };
+
+    /**
+     * @brief Re-enhances an edited region of an image and splices it into the previous result.
+     *
+     * Only the rectangle plus the halo the stages need (the sum of median radius, binarization window, despeckle size,
+     * morphology kernel, ...) is processed: the output changes up to one halo around the rectangle, and that area
+     * is computed from the input within one more halo. The contrast range is the one global statistic of the local pipeline:
+     * it is re-measured on the edited image, and the region is only spliced if the edit cannot have moved the
+     * range by more than `global_tolerance` gray levels; otherwise, and for stages that depend on the whole
+     * image (deskew, DPI normalization, Otsu, Wolf-Jolion, Bataineh), the full pipeline runs.
+     * Gaussian stages use a 4 sigma halo, so pixels near the rectangle may differ by rounding from a full run.
+     *
+     * @param input_image The edited source image.
+     * @param rect The edited rectangle (clipped to the image).
+     * @param opt The enhancement options used for `previous_result`.
+     * @param previous_result Output of `enhance` on the image before the edit.
+     * @param global_tolerance Allowed change of the contrast range in gray levels (default: 2).
+     * @return The updated result.
+     * @throws std::invalid_argument if `previous_result` does not have the size of the input.
+     */
+    CImg<uint> enhance_region(const CImg<uint> &input_image, const Rect &rect, const EnhanceOptions &opt, const CImg<uint> &previous_result,
+                              int block_h = 64, TimingLog* log = nullptr, bool verbose = false, int global_tolerance = 2);
+
+    /**
+     * @brief Called by `enhance_sweep` with the index of a combination and its result.
+     */
+    using SweepCallback = std::function<void(size_t index, const CImg<uint> &result)>;
+
+    /**
+     * @brief Runs `enhance` for every option combination, sharing the pipeline stages they have in common.
+     *
+     * Combinations are evaluated in an order that groups equal stage prefixes (e.g. the same denoising with
+     * different Sauvola parameters): the shared prefix is computed once and each combination resumes from
+     * the deepest cached intermediate. Results are identical to calling `enhance` per combination.
+     *
+     * @param input_image The source image.
+     * @param combinations The option sets to evaluate.
+     * @param on_result Receives each result with the index of its combination (not necessarily in index order).
+     * @param block_h Height of the blocks for parallel processing (default: 64).
+     * @param log Optional timing log; receives the events of all runs, with "Cache Restore" where a run resumed.
+     */
+    void enhance_sweep(const CImg<uint> &input_image, const std::vector<EnhanceOptions> &combinations, const SweepCallback &on_result, int block_h = 64,
+                       TimingLog* log = nullptr, bool verbose = false);
 } // namespace ite
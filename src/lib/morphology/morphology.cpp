@@ -1,11 +1,45 @@
 #include "morphology.h"
+#include <algorithm>
 #include <stdexcept>
 #include <vector>
+#include "../core/local_stats.h"
 
 
 namespace ite::morphology
 {
 
+    namespace
+    {
+        /**
+         * @brief (Internal) Whitens the pixels whose `half_width` x `half_height` window reaches outside the image.
+         * The min/max filters clip their windows at the border; for a dilation of the background, outside the image
+         * is background, so these pixels become white.
+         */
+        void whiten_border(CImg<uint> &image, const int half_width, const int half_height)
+        {
+            const int w = image.width();
+            const int h = image.height();
+            const int rows = h * image.depth();
+
+#pragma omp parallel for schedule(static)
+            for (int r = 0; r < rows; ++r)
+            {
+                uint* row = image.data() + static_cast<size_t>(r) * w;
+                const int y = r % h;
+                if (y < half_height || y >= h - half_height)
+                {
+                    std::fill_n(row, w, 255u);
+                    continue;
+                }
+                for (int x = 0; x < std::min(half_width, w); ++x)
+                {
+                    row[x] = 255;
+                    row[w - 1 - x] = 255;
+                }
+            }
+        }
+    } // namespace
+
     void dilation_square(CImg<uint> &input_image, int kernel_size)
     {
         if (input_image.spectrum() != 1)
@@ -18,51 +52,16 @@ namespace ite::morphology
             return;
         }
 
-        CImg<uint> source = input_image;
-
-        int r = kernel_size / 2;
-        int w = input_image.width();
-        int h = input_image.height();
-        int d = input_image.depth();
+        // A pixel becomes white if any pixel of its neighborhood is white (window clipped to the image)
+        const int r = kernel_size / 2;
+        const CImg<uint> neighborhood_max = core::local_max(input_image, {r, r});
 
-#pragma omp parallel for collapse(2)
-        for (int i_d = 0; i_d < d; ++i_d)
+#pragma omp parallel for
+        for (long long i = 0; i < static_cast<long long>(input_image.size()); ++i)
         {
-            for (int i_h = 0; i_h < h; ++i_h)
+            if (neighborhood_max[i] >= 255)
             {
-                for (int i_w = 0; i_w < w; ++i_w)
-                {
-                    // If the pixel is already white, it stays white
-                    if (source(i_w, i_h, i_d) == 255)
-                    {
-                        continue;
-                    }
-
-                    bool hit = false;
-
-                    // Scan neighborhood
-                    for (int k_h = -r; k_h <= r && !hit; ++k_h)
-                    {
-                        for (int k_w = -r; k_w <= r && !hit; ++k_w)
-                        {
-                            int n_w = i_w + k_w;
-                            int n_h = i_h + k_h;
-
-                            if (n_w >= 0 && n_w < w && n_h >= 0 && n_h < h)
-                            {
-                                if (source(n_w, n_h, i_d) == 255)
-                                {
-                                    hit = true;
-                                }
-                            }
-                        }
-                    }
-
-                    if (hit)
-                    {
-                        input_image(i_w, i_h, i_d) = 255;
-                    }
-                }
+                input_image[i] = 255;
             }
         }
     }
@@ -79,51 +78,16 @@ namespace ite::morphology
             return;
         }
 
-        CImg<uint> source = input_image;
-
-        int r = kernel_size / 2;
-        int w = input_image.width();
-        int h = input_image.height();
-        int d = input_image.depth();
+        // A pixel becomes black if any pixel of its neighborhood is black (window clipped to the image)
+        const int r = kernel_size / 2;
+        const CImg<uint> neighborhood_min = core::local_min(input_image, {r, r});
 
-#pragma omp parallel for collapse(2)
-        for (int i_d = 0; i_d < d; ++i_d)
+#pragma omp parallel for
+        for (long long i = 0; i < static_cast<long long>(input_image.size()); ++i)
         {
-            for (int i_h = 0; i_h < h; ++i_h)
+            if (neighborhood_min[i] == 0)
             {
-                for (int i_w = 0; i_w < w; ++i_w)
-                {
-                    // If the pixel is already black, it stays black
-                    if (source(i_w, i_h, i_d) == 0)
-                    {
-                        continue;
-                    }
-
-                    bool hit = false;
-
-                    // Scan neighborhood
-                    for (int k_h = -r; k_h <= r && !hit; ++k_h)
-                    {
-                        for (int k_w = -r; k_w <= r && !hit; ++k_w)
-                        {
-                            int n_w = i_w + k_w;
-                            int n_h = i_h + k_h;
-
-                            if (n_w >= 0 && n_w < w && n_h >= 0 && n_h < h)
-                            {
-                                if (source(n_w, n_h, i_d) == 0)
-                                {
-                                    hit = true;
-                                }
-                            }
-                        }
-                    }
-
-                    if (hit)
-                    {
-                        input_image(i_w, i_h, i_d) = 0;
-                    }
-                }
+                input_image[i] = 0;
             }
         }
     }
@@ -181,5 +145,96 @@ namespace ite::morphology
         }
     }
 
+    void remove_lines(CImg<uint> &input_image, const int min_length)
+    {
+        if (input_image.spectrum() != 1)
+        {
+            throw std::runtime_error("Line removal requires a single-channel image.");
+        }
+
+        if (min_length < 3 || input_image.is_empty())
+        {
+            return;
+        }
+
+        // Opening of the black pixels with a line element: white grows by r along the line, then shrinks back,
+        // so only black runs of at least 2r + 1 pixels stay black. Outside the image is white, so a stroke cut by the
+        // border is not mistaken for a line
+        const int r = min_length / 2;
+        CImg<uint> horizontal = core::local_max(input_image, {r, 0});
+        CImg<uint> vertical = core::local_max(input_image, {0, r});
+        whiten_border(horizontal, r, 0);
+        whiten_border(vertical, 0, r);
+        horizontal = core::local_min(horizontal, {r, 0});
+        vertical = core::local_min(vertical, {0, r});
+
+        const int w = input_image.width();
+        const int h = input_image.height();
+        const int d = input_image.depth();
+        auto is_line = [&](const size_t i) { return horizontal[i] == 0 || vertical[i] == 0; };
+        auto is_stroke = [&](const size_t i) { return input_image[i] == 0 && !is_line(i); };
+
+        // Decisions are taken on the unmodified image, then applied
+        CImg<unsigned char> keep(w, h, d, 1, 0);
+
+        // Horizontal lines: a vertical run of line pixels is kept if strokes continue above and below it
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int z = 0; z < d; ++z)
+        {
+            for (int x = 0; x < w; ++x)
+            {
+                const size_t plane = static_cast<size_t>(z) * h * w;
+                int y = 0;
+                while (y < h)
+                {
+                    if (horizontal(x, y, z) != 0)
+                    {
+                        ++y;
+                        continue;
+                    }
+                    const int y0 = y;
+                    while (y < h && horizontal(x, y, z) == 0)
+                        ++y;
+                    const bool crossed = y0 > 0 && y < h && is_stroke(plane + static_cast<size_t>(y0 - 1) * w + x) && is_stroke(plane + static_cast<size_t>(y) * w + x);
+                    for (int t = y0; crossed && t < y; ++t)
+                        keep(x, t, z) = 1;
+                }
+            }
+        }
+
+        // Vertical lines: a horizontal run of line pixels is kept if strokes continue left and right of it
+#pragma omp parallel for collapse(2) schedule(static)
+        for (int z = 0; z < d; ++z)
+        {
+            for (int y = 0; y < h; ++y)
+            {
+                const size_t row = (static_cast<size_t>(z) * h + y) * w;
+                int x = 0;
+                while (x < w)
+                {
+                    if (vertical[row + x] != 0)
+                    {
+                        ++x;
+                        continue;
+                    }
+                    const int x0 = x;
+                    while (x < w && vertical[row + x] == 0)
+                        ++x;
+                    const bool crossed = x0 > 0 && x < w && is_stroke(row + x0 - 1) && is_stroke(row + x);
+                    for (int t = x0; crossed && t < x; ++t)
+                        keep[row + t] = 1;
+                }
+            }
+        }
+
+#pragma omp parallel for
+        for (long long i = 0; i < static_cast<long long>(input_image.size()); ++i)
+        {
+            if (is_line(static_cast<size_t>(i)) && !keep[i])
+            {
+                input_image[i] = 255;
+            }
+        }
+    }
 
 } // namespace ite::morphology
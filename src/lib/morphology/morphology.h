@@ -16,6 +16,7 @@ namespace ite::morphology
      *
      * Dilation expands bright (white) regions. On binary images, this
      * can connect broken character parts or thicken strokes.
+     * Uses a separable van Herk/Gil-Werman max filter, so the cost per pixel does not grow with the kernel size.
      *
      * @param image The image to dilate (modified in-place).
      * @param kernel_size The size of the structuring element (e.g., 3 for 3x3).
@@ -28,6 +29,7 @@ namespace ite::morphology
      *
      * Erosion shrinks bright regions (expands dark regions). On binary images,
      * this can remove small noise specks or thin strokes.
+     * Uses a separable van Herk/Gil-Werman min filter, so the cost per pixel does not grow with the kernel size.
      *
      * @param image The image to erode (modified in-place).
      * @param kernel_size The size of the structuring element (e.g., 3 for 3x3).
@@ -46,4 +48,18 @@ namespace ite::morphology
      */
     void despeckle_ccl(CImg<uint> &image, uint threshold, bool diagonal_connections = true);
 
+    /**
+     * @brief Removes long horizontal and vertical lines (staff lines, table rules, underlines) from a binary image in-place.
+     *
+     * Line pixels are the black pixels that survive an opening with a `min_length` x 1 or 1 x `min_length` line
+     * element, computed with the van Herk/Gil-Werman min/max filters, so the cost does not grow with the length.
+     * Where a stroke crosses a line (black, non-line pixels directly on both sides across the line's thickness),
+     * the line pixels are kept, so characters and note stems stay connected; all other line pixels become white.
+     *
+     * @param image The binary image (0 = text, 255 = background), modified in-place.
+     * @param min_length Shortest run of black pixels that counts as a line (lengths below 3 do nothing).
+     * @throws std::runtime_error if the image is not single-channel.
+     */
+    void remove_lines(CImg<uint> &image, int min_length);
+
 } // namespace ite::morphology
@@ -0,0 +1,575 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+
+#include "../binarization/binarization.h"
+#include "../color/background.h"
+#include "../color/color.h"
+#include "../color/contrast.h"
+#include "../color/grayscale.h"
+#include "../filters/filters.h"
+#include "../geometry/geometry.h"
+#include "../geometry/resample.h"
+#include "../geometry/resolution.h"
+#include "../morphology/morphology.h"
+
+namespace ite::pipeline
+{
+
+    namespace
+    {
+        using Clock = std::chrono::steady_clock;
+        using Us = std::chrono::microseconds;
+
+        /**
+         * @brief (Internal) Builds a stage key "name:v1,v2,..." with floats at full precision.
+         */
+        template <typename... Args>
+        std::string stage_key(const char* name, const Args &...args)
+        {
+            std::ostringstream key;
+            key << std::setprecision(std::numeric_limits<float>::max_digits10) << name << ':';
+            ((key << args << ','), ...);
+            return key.str();
+        }
+
+        // Halo of the recursive Gaussian filters: their kernels are infinite, 4 sigma holds all but a rounding residue
+        int gaussian_halo(const float sigma) { return static_cast<int>(std::ceil(4.0f * sigma)); }
+
+        // Window size scaled by `scale`, at least `min_size`; odd sizes stay odd
+        int scale_window(const int size, const double scale, const int min_size)
+        {
+            const int scaled = std::max(min_size, static_cast<int>(std::lround(size * scale)));
+            return (size % 2 != 0 && scaled % 2 == 0) ? scaled + 1 : scaled;
+        }
+
+        /**
+         * @brief (Internal) Options for an image downscaled by `scale`: windows, kernels, sigmas, tiles and speck areas shrink along.
+         */
+        EnhanceOptions scale_window_options(EnhanceOptions opt, const double scale)
+        {
+            opt.sigma = static_cast<float>(opt.sigma * scale);
+            opt.adaptive_sigma_low = static_cast<float>(opt.adaptive_sigma_low * scale);
+            opt.adaptive_sigma_high = static_cast<float>(opt.adaptive_sigma_high * scale);
+            opt.median_kernel_size = scale_window(opt.median_kernel_size, scale, 1);
+            opt.adaptive_median_max_window = scale_window(opt.adaptive_median_max_window, scale, 3);
+            opt.sauvola_window_size = scale_window(opt.sauvola_window_size, scale, 3);
+            opt.kernel_size = scale_window(opt.kernel_size, scale, 1);
+            opt.background_window = scale_window(opt.background_window, scale, 3);
+            opt.clahe_tile_size = scale_window(opt.clahe_tile_size, scale, 8);
+            opt.line_min_length = scale_window(opt.line_min_length, scale, 3);
+            opt.despeckle_threshold = static_cast<int>(std::lround(opt.despeckle_threshold * scale * scale));
+            if (opt.otsu_tile_size > 0)
+            {
+                opt.otsu_tile_size = scale_window(opt.otsu_tile_size, scale, 16);
+            }
+            return opt;
+        }
+
+        /**
+         * @brief (Internal) Contrast stretch of the working image, applied to its pyramid as well so the pyramid stays usable.
+         */
+        void stretch_with_pyramid(PipelineState &s, const color::StretchRange &range)
+        {
+            color::apply_linear_stretch(s.image, range);
+            if (s.pyramid)
+            {
+                // Cached states share the old pyramid, so stretch a copy
+                auto stretched = std::make_shared<core::Pyramid>(*s.pyramid);
+                stretched->apply([&range](CImg<uint> &level) { color::apply_linear_stretch(level, range); });
+                s.pyramid = std::move(stretched);
+            }
+        }
+
+        /**
+         * @brief (Internal) Inverts the values of a color image in-place (values above 255 count as 255).
+         */
+        void invert_colors(CImg<uint> &image)
+        {
+            uint* data = image.data();
+            const long long n = static_cast<long long>(image.size());
+#pragma omp parallel for schedule(static)
+            for (long long i = 0; i < n; ++i)
+                data[i] = 255u - std::min(data[i], 255u);
+        }
+
+        /**
+         * @brief (Internal) Crops the working and the color copy to the page content, remembering where the crop lies on the page.
+         */
+        void crop_to_content(PipelineState &s)
+        {
+            const geometry::Box box = geometry::detect_content_bounds(s.image);
+            s.page_width = s.image.width();
+            s.page_height = s.image.height();
+            s.crop = box;
+            if (box.width() == s.page_width && box.height() == s.page_height)
+            {
+                return;
+            }
+            s.image.crop(box.x0, box.y0, box.x1, box.y1);
+            if (!s.color.is_empty())
+            {
+                s.color.crop(box.x0, box.y0, box.x1, box.y1);
+            }
+        }
+
+        /**
+         * @brief (Internal) Turns the uncropped page and the crop on it by quarter turns (clockwise), along with the content,
+         * so paste-back places a turned result on a page of the turned size.
+         */
+        void turn_page_frame(PipelineState &s, const int quarters)
+        {
+            const int w = s.page_width;
+            const int h = s.page_height;
+            const geometry::Box box = s.crop;
+            switch (((quarters % 4) + 4) % 4)
+            {
+            case 1:
+                s.crop = {h - 1 - box.y1, box.x0, h - 1 - box.y0, box.x1};
+                std::swap(s.page_width, s.page_height);
+                break;
+            case 2:
+                s.crop = {w - 1 - box.x1, h - 1 - box.y1, w - 1 - box.x0, h - 1 - box.y0};
+                break;
+            case 3:
+                s.crop = {box.y0, w - 1 - box.x1, box.y1, w - 1 - box.x0};
+                std::swap(s.page_width, s.page_height);
+                break;
+            default:
+                break;
+            }
+        }
+
+        /**
+         * @brief (Internal) Pastes the result onto a white page of the uncropped size, centered on the crop
+         * (deskew may have grown the result) and clipped to the page.
+         */
+        void paste_back(PipelineState &s)
+        {
+            if (s.crop.empty())
+            {
+                return;
+            }
+            CImg<uint> page(s.page_width, s.page_height, 1, s.image.spectrum(), 255);
+            const int x = s.crop.x0 + (s.crop.width() - s.image.width()) / 2;
+            const int y = s.crop.y0 + (s.crop.height() - s.image.height()) / 2;
+            page.draw_image(x, y, s.image);
+            s.image.swap(page);
+        }
+
+        /**
+         * @brief (Internal) Runs stages [first, stages.size()) on `state`, calling `after_stage(i, state)` after each one.
+         */
+        template <typename AfterStage>
+        void run_range(const std::vector<Stage> &stages, const size_t first, PipelineState &state, TimingLog* log, const bool verbose,
+                       AfterStage &&after_stage)
+        {
+            for (size_t i = first; i < stages.size(); ++i)
+            {
+                const auto start = Clock::now();
+                stages[i].run(state);
+                if (!stages[i].keeps_pyramid)
+                {
+                    state.pyramid.reset();
+                }
+                record_time(log, stages[i].name, std::chrono::duration_cast<Us>(Clock::now() - start).count(), verbose, state.detail);
+                state.detail.clear();
+                after_stage(i, state);
+            }
+        }
+    } // namespace
+
+    void record_time(TimingLog* log, const std::string &name, long long us, bool verbose, const std::string &detail)
+    {
+        if (log)
+        {
+            log->push_back({name, us, detail});
+        }
+
+        if (verbose)
+        {
+            std::cout << "[ITE] " << name + ":\t" << us << " us" << (detail.empty() ? "" : " (" + detail + ")") << std::endl;
+        }
+    }
+
+    std::vector<Stage> build_stages(const CImg<uint> &input, const EnhanceOptions &requested, const int block_h, const color::StretchRange* contrast_range,
+                                    const double* dpi_scale)
+    {
+        std::vector<Stage> stages;
+
+        // With DPI normalization, the stages after it work on the downscaled image with scaled windows
+        const double scale =
+            !requested.do_dpi_normalization ? 1.0 : dpi_scale ? *dpi_scale : geometry::dpi_normalization_scale(input, requested.target_dpi);
+        const EnhanceOptions opt = scale < 1.0 ? scale_window_options(requested, scale) : requested;
+
+        // 1. Init: the working copy, plus the color copy if the color pass is requested
+        stages.push_back({"Init & Copy", stage_key("init", opt.do_color_pass), true, 0,
+                          [&input, color = opt.do_color_pass](PipelineState &s)
+                          {
+                              s.image = input;
+                              if (color)
+                              {
+                                  s.color = input;
+                              }
+                          }});
+
+        // 2. DPI normalization
+        if (scale < 1.0)
+        {
+            const int w = std::max(1, static_cast<int>(std::lround(input.width() * scale)));
+            const int h = std::max(1, static_cast<int>(std::lround(input.height() * scale)));
+            stages.push_back({"DPI Normalization", stage_key("dpi", w, h), opt.do_color_pass, GLOBAL,
+                              [w, h, color = opt.do_color_pass](PipelineState &s)
+                              {
+                                  s.image = geometry::resize_area(s.image, w, h);
+                                  if (color)
+                                  {
+                                      s.color = s.image;
+                                  }
+                              }});
+        }
+
+        // 3. Grayscale; light-on-dark pages are inverted in the same pass, so all later steps see dark text
+        stages.push_back({"Grayscale", stage_key("gray", opt.do_auto_polarity), false, opt.do_auto_polarity ? GLOBAL : 0,
+                          [polarity = opt.do_auto_polarity](PipelineState &s)
+                          {
+                              const bool invert = polarity && binarization::detect_dark_background(s.image);
+                              if (invert)
+                              {
+                                  s.detail = "inverted";
+                              }
+                              color::to_grayscale_rec601(s.image, invert);
+                              s.inverted = invert;
+                          }});
+
+        // 4. Auto-crop: the later stages only process the page content
+        if (opt.do_auto_crop)
+        {
+            stages.push_back({"Auto Crop", stage_key("crop"), opt.do_color_pass, GLOBAL, crop_to_content});
+        }
+
+        // 5. Background flattening: uneven illumination is divided out before anything looks at the gray levels
+        if (opt.do_background_flattening)
+        {
+            stages.push_back({"Background", stage_key("background", opt.background_window), false, GLOBAL,
+                              [window = opt.background_window](PipelineState &s) { color::flatten_background(s.image, window); }});
+        }
+
+        // 6. Analysis pyramid for the steps that only need coarse statistics: the deskew proxy, and Bataineh's
+        // window classification as long as no denoising changes the image in between (contrast is applied to the levels too)
+        const bool denoised = opt.do_adaptive_gaussian_blur || opt.do_gaussian_blur || opt.do_median_blur || opt.do_adaptive_median;
+        const bool bataineh_pyramid = opt.binarization_method == BinarizationMethod::Bataineh && !denoised && !opt.do_clahe;
+        if (opt.do_deskew || opt.do_orientation || bataineh_pyramid)
+        {
+            stages.push_back({"Analysis Pyramid", stage_key("pyramid"), false, 0,
+                              [](PipelineState &s) { s.pyramid = std::make_shared<const core::Pyramid>(s.image); }, true});
+        }
+
+        // 7. Deskew and orientation: both are detected on the pyramid and applied to the working copy in one rotation
+        // (quarter turns alone are lossless pixel permutations). The color copy is rotated lazily by the color pass
+        if (opt.do_deskew || opt.do_orientation)
+        {
+            const geometry::SkewEstimator estimator =
+                opt.skew_method == SkewMethod::Docstrum ? geometry::SkewEstimator::Docstrum : geometry::SkewEstimator::ProjectionProfile;
+            geometry::AngleSearchOptions search;
+            search.strategy = opt.deskew_search == DeskewSearch::Golden    ? geometry::AngleSearch::Golden
+                              : opt.deskew_search == DeskewSearch::Ternary ? geometry::AngleSearch::Ternary
+                                                                           : geometry::AngleSearch::Grid;
+            search.early_exit_margin = opt.deskew_early_exit;
+            search.max_evaluations = opt.deskew_max_evaluations;
+            stages.push_back({opt.do_deskew ? "Deskew" : "Orientation",
+                              stage_key("deskew", opt.boundary_conditions, opt.do_deskew, opt.do_orientation, static_cast<int>(opt.skew_method),
+                                        static_cast<int>(opt.deskew_search), opt.deskew_early_exit, opt.deskew_max_evaluations, bataineh_pyramid),
+                              false, GLOBAL,
+                              [bc = opt.boundary_conditions, keep = bataineh_pyramid, deskew = opt.do_deskew, orientation = opt.do_orientation, estimator,
+                               search](PipelineState &s)
+                              {
+                                  const geometry::PageRotation rotation =
+                                      geometry::detect_page_rotation(s.image, orientation, estimator, 15, 0.2f, 0.0f, s.pyramid.get(), search);
+                                  if (estimator == geometry::SkewEstimator::ProjectionProfile)
+                                  {
+                                      s.detail = std::to_string(rotation.evaluations) + " angles";
+                                  }
+                                  const double angle = rotation.orientation + (deskew ? rotation.skew : 0.0);
+                                  if (angle == 0.0)
+                                  {
+                                      return;
+                                  }
+                                  s.image = geometry::rotate(s.image, angle, geometry::Interpolation::Cubic, bc);
+                                  s.color_rotation = angle;
+                                  if (!s.crop.empty())
+                                  {
+                                      turn_page_frame(s, rotation.orientation / 90);
+                                  }
+                                  s.pyramid = keep ? std::make_shared<const core::Pyramid>(s.image) : nullptr;
+                              },
+                              true});
+        }
+
+        // 8. Contrast: CLAHE is not pointwise, so the pyramid is dropped after it
+        if (opt.do_clahe)
+        {
+            stages.push_back({"Contrast (CLAHE)", stage_key("clahe", opt.clahe_tile_size, opt.clahe_clip_limit), false, GLOBAL,
+                              [tile = opt.clahe_tile_size, clip = opt.clahe_clip_limit](PipelineState &s) { color::contrast_clahe(s.image, tile, clip); }});
+        }
+        else if (contrast_range)
+        {
+            stages.push_back({"Contrast", stage_key("contrast", contrast_range->low, contrast_range->high), false, 0,
+                              [range = *contrast_range](PipelineState &s) { stretch_with_pyramid(s, range); }, true});
+        }
+        else
+        {
+            stages.push_back({"Contrast", stage_key("contrast"), false, GLOBAL,
+                              [](PipelineState &s) { stretch_with_pyramid(s, color::contrast_stretch_range(s.image)); }, true});
+        }
+
+        // 9. Denoising
+        if (opt.do_adaptive_gaussian_blur)
+        {
+            stages.push_back({"Adaptive Gaussian",
+                              stage_key("agauss", opt.adaptive_sigma_low, opt.adaptive_sigma_high, opt.adaptive_edge_thresh, block_h, opt.boundary_conditions),
+                              false, gaussian_halo(std::max(opt.adaptive_sigma_low, opt.adaptive_sigma_high)) + 1,
+                              [opt, block_h](PipelineState &s)
+                              {
+                                  filters::adaptive_gaussian_blur(s.image, opt.adaptive_sigma_low, opt.adaptive_sigma_high, opt.adaptive_edge_thresh,
+                                                                  block_h, opt.boundary_conditions);
+                              }});
+        }
+        else if (opt.do_gaussian_blur)
+        {
+            stages.push_back({"Gaussian Blur", stage_key("gauss", opt.sigma, opt.boundary_conditions), false, gaussian_halo(opt.sigma),
+                              [opt](PipelineState &s) { filters::simple_gaussian_blur(s.image, opt.sigma, opt.boundary_conditions); }});
+        }
+
+        if (opt.do_median_blur)
+        {
+            stages.push_back({"Median Blur", stage_key("median", opt.median_kernel_size, opt.median_threshold), false, opt.median_kernel_size / 2,
+                              [opt](PipelineState &s) { filters::simple_median_blur(s.image, opt.median_kernel_size, opt.median_threshold); }});
+        }
+
+        if (opt.do_adaptive_median)
+        {
+            stages.push_back({"Adaptive Median", stage_key("amedian", opt.adaptive_median_max_window, block_h), false, opt.adaptive_median_max_window / 2,
+                              [opt, block_h](PipelineState &s) { filters::adaptive_median_filter(s.image, opt.adaptive_median_max_window, block_h); }});
+        }
+
+        // 10. Binarization
+        switch (opt.binarization_method)
+        {
+        case BinarizationMethod::Otsu:
+            stages.push_back({"Binarization (Otsu)", stage_key("otsu", opt.otsu_tile_size, opt.otsu_thresholds), false, GLOBAL,
+                              [opt](PipelineState &s) { binarization::binarize_otsu(s.image, opt.otsu_tile_size, opt.otsu_thresholds); }});
+            break;
+        case BinarizationMethod::Sauvola:
+            stages.push_back({"Binarization (Sauvola)", stage_key("sauvola", opt.sauvola_window_size, opt.sauvola_k, opt.sauvola_delta, opt.threshold_scale),
+                              false, opt.sauvola_window_size / 2 + (opt.threshold_scale > 1 ? 3 * opt.threshold_scale : 0),
+                              [opt](PipelineState &s)
+                              { binarization::binarize_sauvola(s.image, opt.sauvola_window_size, opt.sauvola_k, opt.sauvola_delta, opt.threshold_scale); }});
+            break;
+        case BinarizationMethod::Bataineh:
+            stages.push_back({"Binarization (Bataineh)", stage_key("bataineh", opt.threshold_scale), false, GLOBAL,
+                              [opt](PipelineState &s) { binarization::binarize_bataineh(s.image, opt.threshold_scale, s.pyramid.get()); }});
+            break;
+        case BinarizationMethod::Niblack:
+            stages.push_back({"Binarization (Niblack)", stage_key("niblack", opt.sauvola_window_size, opt.niblack_k), false, opt.sauvola_window_size / 2,
+                              [opt](PipelineState &s) { binarization::binarize_niblack(s.image, opt.sauvola_window_size, opt.niblack_k); }});
+            break;
+        case BinarizationMethod::Wolf:
+            stages.push_back({"Binarization (Wolf)", stage_key("wolf", opt.sauvola_window_size, opt.wolf_k), false, GLOBAL,
+                              [opt](PipelineState &s) { binarization::binarize_wolf(s.image, opt.sauvola_window_size, opt.wolf_k); }});
+            break;
+        case BinarizationMethod::Phansalkar:
+            stages.push_back({"Binarization (Phansalkar)", stage_key("phansalkar", opt.sauvola_window_size, opt.phansalkar_k), false, opt.sauvola_window_size / 2,
+                              [opt](PipelineState &s) { binarization::binarize_phansalkar(s.image, opt.sauvola_window_size, opt.phansalkar_k); }});
+            break;
+        case BinarizationMethod::Nick:
+            stages.push_back({"Binarization (NICK)", stage_key("nick", opt.sauvola_window_size, opt.nick_k), false, opt.sauvola_window_size / 2,
+                              [opt](PipelineState &s) { binarization::binarize_nick(s.image, opt.sauvola_window_size, opt.nick_k); }});
+            break;
+        }
+
+        // 11. Morphology; line removal comes first so despeckle also clears what is left of the lines.
+        // Crossing strokes are found along runs of line pixels of any thickness, so the stage is image-wide
+        if (opt.do_line_removal)
+        {
+            stages.push_back({"Line Removal", stage_key("lines", opt.line_min_length), false, GLOBAL,
+                              [length = opt.line_min_length](PipelineState &s) { morphology::remove_lines(s.image, length); }});
+        }
+
+        if (opt.do_despeckle)
+        {
+            stages.push_back({"Despeckle", stage_key("despeckle", opt.despeckle_threshold, opt.diagonal_connections), false, std::max(opt.despeckle_threshold, 0),
+                              [opt](PipelineState &s)
+                              { morphology::despeckle_ccl(s.image, static_cast<uint>(opt.despeckle_threshold), opt.diagonal_connections); }});
+        }
+
+        if (opt.do_dilation)
+        {
+            stages.push_back({"Dilation", stage_key("dilation", opt.kernel_size), false, opt.kernel_size / 2,
+                              [opt](PipelineState &s) { morphology::dilation_square(s.image, opt.kernel_size); }});
+        }
+
+        if (opt.do_erosion)
+        {
+            stages.push_back({"Erosion", stage_key("erosion", opt.kernel_size), false, opt.kernel_size / 2,
+                              [opt](PipelineState &s) { morphology::erosion_square(s.image, opt.kernel_size); }});
+        }
+
+        // 12. Color Pass: the colored result becomes the output. After deskew, the color of the text pixels is sampled
+        // from the unrotated color copy through the same rotation; the background is filled with white directly.
+        // Light text of an inverted page is kept in the inverted colors, so it stays readable on white
+        if (opt.do_color_pass)
+        {
+            stages.push_back({"Color Pass", stage_key("color", opt.boundary_conditions), true, 0,
+                              [bc = opt.boundary_conditions](PipelineState &s)
+                              {
+                                  if (s.inverted)
+                                  {
+                                      invert_colors(s.color);
+                                  }
+                                  if (s.color_rotation != 0.0)
+                                  {
+                                      s.image = geometry::rotate_masked(s.color, s.color_rotation, s.image, 255, 255, geometry::Interpolation::Cubic, bc);
+                                  }
+                                  else
+                                  {
+                                      color::color_pass_inplace(s.color, s.image);
+                                      s.image.swap(s.color);
+                                  }
+                                  s.color.assign();
+                                  s.color_rotation = 0.0;
+                              }});
+        }
+
+        // 13. Paste back: the page keeps its uncropped size
+        if (opt.do_auto_crop && opt.crop_paste_back)
+        {
+            stages.push_back({"Paste Back", stage_key("paste"), false, GLOBAL, paste_back});
+        }
+
+        return stages;
+    }
+
+    CImg<uint> run_stages(const std::vector<Stage> &stages, TimingLog* log, const bool verbose)
+    {
+        const auto total_start = Clock::now();
+
+        PipelineState state;
+        run_range(stages, 0, state, log, verbose, [](size_t, const PipelineState &) {});
+
+        record_time(log, "TOTAL", std::chrono::duration_cast<Us>(Clock::now() - total_start).count(), verbose);
+        return std::move(state.image);
+    }
+
+    uint64_t fingerprint(const CImg<uint> &image)
+    {
+        // Row hashes in parallel, combined in row order so the result does not depend on the schedule
+        const long long rows = static_cast<long long>(image.height()) * image.depth() * image.spectrum();
+        std::vector<uint64_t> row_hash(rows);
+#pragma omp parallel for schedule(static)
+        for (long long r = 0; r < rows; ++r)
+        {
+            const uint* row = image.data() + r * image.width();
+            uint64_t h = 1469598103934665603ull; // FNV-1a on 32-bit words
+            for (int x = 0; x < image.width(); ++x)
+                h = (h ^ row[x]) * 1099511628211ull;
+            row_hash[r] = h;
+        }
+
+        uint64_t h = 1469598103934665603ull;
+        for (const uint64_t v : {static_cast<uint64_t>(image.width()), static_cast<uint64_t>(image.height()), static_cast<uint64_t>(image.depth()),
+                                 static_cast<uint64_t>(image.spectrum())})
+            h = (h ^ v) * 1099511628211ull;
+        for (const uint64_t v : row_hash)
+            h = (h ^ v) * 1099511628211ull;
+        return h;
+    }
+
+    bool StageChain::set_input(const CImg<uint> &input)
+    {
+        const uint64_t id = fingerprint(input);
+        const bool kept = id == input_fingerprint_;
+        if (!kept)
+        {
+            entries_.clear();
+            dpi_scales_.clear();
+            input_fingerprint_ = id;
+        }
+        return kept;
+    }
+
+    double StageChain::dpi_scale(const CImg<uint> &input, const int target_dpi)
+    {
+        const auto [it, inserted] = dpi_scales_.try_emplace(target_dpi, 1.0);
+        if (inserted)
+        {
+            it->second = geometry::dpi_normalization_scale(input, target_dpi);
+        }
+        return it->second;
+    }
+
+    size_t StageChain::matching_prefix(const std::vector<Stage> &stages) const
+    {
+        size_t count = 0;
+        while (count < stages.size() && count < entries_.size() && stages[count].key == entries_[count].key)
+            ++count;
+        return count;
+    }
+
+    PipelineState StageChain::restore(const size_t count) const
+    {
+        PipelineState state;
+        if (count == 0)
+            return state;
+
+        state.image = entries_[count - 1].image;
+        state.pyramid = entries_[count - 1].pyramid;
+        state.crop = entries_[count - 1].crop;
+        state.page_width = entries_[count - 1].page_width;
+        state.page_height = entries_[count - 1].page_height;
+        state.color_rotation = entries_[count - 1].color_rotation;
+        state.inverted = entries_[count - 1].inverted;
+        // The color copy is stored with the last stage that changed it
+        for (size_t i = count; i-- > 0;)
+        {
+            if (!entries_[i].color.is_empty())
+            {
+                state.color = entries_[i].color;
+                break;
+            }
+        }
+        return state;
+    }
+
+    CImg<uint> StageChain::run(const std::vector<Stage> &stages, TimingLog* log, const bool verbose)
+    {
+        const auto total_start = Clock::now();
+
+        // A stage list that ends inside the cached chain is fully cached; otherwise resume after the deepest valid stage
+        const size_t valid = matching_prefix(stages);
+        PipelineState state = restore(valid);
+        if (valid > 0)
+        {
+            record_time(log, "Cache Restore", std::chrono::duration_cast<Us>(Clock::now() - total_start).count(), verbose);
+        }
+
+        entries_.resize(valid);
+        run_range(stages, valid, state, log, verbose,
+                  [&](const size_t i, const PipelineState &s)
+                  {
+                      entries_.push_back(
+                          {stages[i].key, s.image, stages[i].modifies_color ? s.color : CImg<uint>(), s.pyramid, s.crop, s.page_width, s.page_height,
+                           s.color_rotation, s.inverted});
+                  });
+
+        record_time(log, "TOTAL", std::chrono::duration_cast<Us>(Clock::now() - total_start).count(), verbose);
+        return std::move(state.image);
+    }
+
+} // namespace ite::pipeline
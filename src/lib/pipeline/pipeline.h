@@ -0,0 +1,146 @@
+#pragma once
+/**
+ * @file pipeline.h
+ * @brief The enhancement pipeline as a list of stages, with reusable intermediate results.
+ *
+ * `ite::enhance` runs the stages built from its options. Every stage carries a key made of the options
+ * that determine its output, so two option sets share all leading stages whose keys are equal.
+ * A StageChain keeps the intermediate images of the last run and resumes later runs from the
+ * deepest stage that is still valid.
+ */
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "../color/contrast.h"
+#include "../core/pyramid.h"
+#include "../geometry/geometry.h"
+#include "CImg.h"
+#include "ite.h"
+
+using namespace cimg_library;
+
+namespace ite::pipeline
+{
+
+    /**
+     * @brief Data passed from stage to stage.
+     */
+    struct PipelineState
+    {
+        CImg<uint> image; ///< Working image (grayscale after the first stages, binary after binarization)
+        CImg<uint> color; ///< Color copy of the input, only carried when the color pass is enabled
+        std::shared_ptr<const core::Pyramid> pyramid; ///< Downsampled levels of `image` for analysis steps, or null
+        geometry::Box crop; ///< Region of the page the image was cropped to by auto-crop (empty if not cropped)
+        int page_width = 0; ///< Size of the page before auto-crop
+        int page_height = 0;
+        double color_rotation = 0.0; ///< Rotation of `image` (deskew) not applied to `color` yet; the color pass samples it lazily
+        bool inverted = false; ///< Whether the grayscale stage inverted a light-on-dark page; the color pass inverts the colors it keeps
+        std::string detail; ///< Note of the last stage for its timing event (e.g. the number of scored angles); cleared once recorded
+    };
+
+    /** @brief Stage::halo of stages that depend on the whole image. */
+    constexpr int GLOBAL = -1;
+
+    /**
+     * @brief One step of the pipeline.
+     */
+    struct Stage
+    {
+        std::string name; ///< Name used in the timing log
+        std::string key; ///< Options that determine the stage output (the input is given by the previous stages)
+        bool modifies_color = false; ///< Whether the stage changes PipelineState::color
+        int halo = 0; ///< Pixels around an output pixel its value depends on, or GLOBAL for image-wide statistics
+        std::function<void(PipelineState &)> run;
+        bool keeps_pyramid = false; ///< Whether PipelineState::pyramid still matches the image after the stage; otherwise it is dropped
+    };
+
+    /**
+     * @brief Builds the stages `ite::enhance` runs for the given options, in order.
+     * Disabled steps are left out; the first stage copies the input into the state.
+     * With `contrast_range`, the contrast stage applies that range instead of measuring one on its input.
+     * With DPI normalization, the window options of the later stages are scaled by the DPI scale: `dpi_scale` if given,
+     * otherwise it is estimated from `input` here.
+     */
+    std::vector<Stage> build_stages(const CImg<uint> &input, const EnhanceOptions &opt, int block_h, const color::StretchRange* contrast_range = nullptr,
+                                    const double* dpi_scale = nullptr);
+
+    /**
+     * @brief Intermediate results of the most recent run of a stage list.
+     *
+     * The chain stores the state after every stage (the color copy only after stages that change it).
+     * Memory grows with the number of stages times the image size.
+     */
+    class StageChain
+    {
+    public:
+        /**
+         * @brief Declares the input of the next run; a different input (by content) drops all cached stages.
+         * @return Whether the cached stages were kept.
+         */
+        bool set_input(const CImg<uint> &input);
+
+        /**
+         * @brief DPI normalization scale of the current input (see geometry::dpi_normalization_scale), estimated once per
+         * input and target resolution. `input` must be the image last passed to set_input().
+         */
+        double dpi_scale(const CImg<uint> &input, int target_dpi);
+
+        /** @brief Number of leading stages whose keys equal the cached ones. */
+        size_t matching_prefix(const std::vector<Stage> &stages) const;
+
+        /** @brief Number of cached stages. */
+        size_t size() const { return entries_.size(); }
+
+        /** @brief Drops all cached stages. */
+        void clear() { entries_.clear(); }
+
+        /**
+         * @brief Runs `stages`, resuming after the deepest cached stage that is still valid, and caches the new states.
+         * @return The output of the last stage.
+         */
+        CImg<uint> run(const std::vector<Stage> &stages, TimingLog* log = nullptr, bool verbose = false);
+
+    private:
+        struct Entry
+        {
+            std::string key;
+            CImg<uint> image;
+            CImg<uint> color; ///< Empty unless the stage modified the color copy
+            std::shared_ptr<const core::Pyramid> pyramid;
+            geometry::Box crop;
+            int page_width = 0;
+            int page_height = 0;
+            double color_rotation = 0.0;
+            bool inverted = false;
+        };
+
+        /** @brief Restores the state after the first `count` cached stages. */
+        PipelineState restore(size_t count) const;
+
+        std::vector<Entry> entries_;
+        std::map<int, double> dpi_scales_; ///< By target resolution
+        uint64_t input_fingerprint_ = 0;
+    };
+
+    /**
+     * @brief Runs the stages without caching, recording one timing event per stage.
+     * @return The output of the last stage.
+     */
+    CImg<uint> run_stages(const std::vector<Stage> &stages, TimingLog* log = nullptr, bool verbose = false);
+
+    /**
+     * @brief 64-bit hash of the dimensions and all pixel values of an image, computed in parallel.
+     */
+    uint64_t fingerprint(const CImg<uint> &image);
+
+    /**
+     * @brief Records a timing event in `log` (if given) and prints it when `verbose` is set.
+     */
+    void record_time(TimingLog* log, const std::string &name, long long us, bool verbose = false, const std::string &detail = {});
+
+} // namespace ite::pipeline
@@ -1,7 +1,11 @@
 #include "ite.h"
+#include "binarization/binarization.h"
 #include <CImg.h>
 #include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <vector>
 
 TEST_CASE("binarize: Converts grayscale to binary (black/white)", "[ite][binarize][Otsu][Sauvola][Bataineh]")
 {
@@ -394,4 +398,379 @@ TEST_CASE("binarize: Edge cases", "[ite][binarize][Otsu][Sauvola][Bataineh]")
         CHECK(output(2, 2) == 0);
         CHECK(output(0, 0) == 255);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("binarize: Sliding-window Sauvola matches the direct window formulation", "[ite][binarize][Sauvola]")
+{
+    // GIVEN: A pseudo-random grayscale image (deterministic LCG so the test is reproducible)
+    CImg<uint> input_image(37, 23, 1, 1, 0);
+    uint state = 12345u;
+    cimg_forXY(input_image, x, y)
+    {
+        state = state * 1103515245u + 12345u;
+        input_image(x, y) = (state >> 16) & 0xFF;
+    }
+
+    // Direct reference: visits every pixel of the (edge-clamped) window
+    auto reference = [&](int window_size, float k, float delta)
+    {
+        CImg<uint> ref(input_image.width(), input_image.height(), 1, 1, 0);
+        const int w_half = window_size / 2;
+        cimg_forXY(input_image, x, y)
+        {
+            const int x1 = std::max(0, x - w_half), x2 = std::min(input_image.width() - 1, x + w_half);
+            const int y1 = std::max(0, y - w_half), y2 = std::min(input_image.height() - 1, y + w_half);
+            double sum = 0.0, sum_sq = 0.0;
+            for (int j = y1; j <= y2; ++j)
+                for (int i = x1; i <= x2; ++i)
+                {
+                    sum += input_image(i, j);
+                    sum_sq += static_cast<double>(input_image(i, j)) * input_image(i, j);
+                }
+            const double N = (x2 - x1 + 1) * (y2 - y1 + 1);
+            const double mean = sum / N;
+            const double std_dev = std::sqrt(std::max(0.0, sum_sq / N - mean * mean));
+            const double threshold = mean * (1.0 + k * ((std_dev / 128.0) - 1.0)) - delta;
+            ref(x, y) = (input_image(x, y) > threshold) * 255;
+        }
+        return ref;
+    };
+
+    for (const int window_size : {1, 3, 15, 31, 101})
+    {
+        INFO("window_size = " << window_size);
+        // WHEN: We binarize with the streaming implementation
+        CImg<uint> output = ite::binarize_sauvola(input_image, window_size, 0.3f, 2.0f);
+        CImg<uint> expected = reference(window_size, 0.3f, 2.0f);
+
+        // THEN: Every pixel matches the direct computation
+        int mismatches = 0;
+        cimg_forXY(output, x, y) { mismatches += (output(x, y) != expected(x, y)); }
+        CHECK(mismatches == 0);
+    }
+}
+
+TEST_CASE("binarize: Downsampled threshold surface", "[ite][binarize][Sauvola][Bataineh]")
+{
+    // GIVEN: A page-like image with dark strokes on a smoothly varying background
+    CImg<uint> page(240, 160, 1, 1, 0);
+    cimg_forXY(page, x, y)
+    {
+        page(x, y) = 170 + (x + y) / 8;
+    }
+    const uint ink = 40;
+    for (int row = 20; row < 150; row += 20)
+    {
+        for (int x = 10; x < 230; x += 12)
+        {
+            page.draw_rectangle(x, row, x + 6, row + 8, &ink);
+        }
+    }
+
+    SECTION("F-measure of identical and disjoint foregrounds")
+    {
+        const CImg<uint> reference = ite::binarize_sauvola(page);
+        CImg<uint> inverted(reference);
+        cimg_forXY(reference, x, y)
+        {
+            inverted(x, y) = 255 - reference(x, y);
+        }
+
+        CHECK(ite::f_measure(reference, reference) == 1.0);
+        CHECK(ite::f_measure(inverted, reference) == 0.0);
+        CHECK_THROWS(ite::f_measure(reference, reference.get_crop(0, 0, 10, 10)));
+    }
+
+    SECTION("Scaled surfaces stay close to the exact thresholds")
+    {
+        for (int scale : {2, 4})
+        {
+            CHECK(ite::threshold_scale_fmeasure(page, ite::BinarizationMethod::Sauvola, scale, 31) > 0.95);
+            CHECK(ite::threshold_scale_fmeasure(page, ite::BinarizationMethod::Bataineh, scale) > 0.9);
+        }
+        CHECK(ite::threshold_scale_fmeasure(page, ite::BinarizationMethod::Sauvola, 1, 31) == 1.0);
+    }
+
+    SECTION("Flat images do not produce invalid thresholds")
+    {
+        const CImg<uint> flat(64, 64, 1, 1, 200);
+        const CImg<uint> output = ite::binarize_bataineh(flat, 4);
+        CHECK(output.min() == output.max());
+    }
+}
+
+TEST_CASE("binarize: Niblack, Wolf-Jolion, Phansalkar and NICK", "[ite][binarize][Niblack][Wolf][Phansalkar][NICK]")
+{
+    // GIVEN: A random grayscale image
+    CImg<uint> image(31, 19, 1, 1);
+    uint32_t state = 7u;
+    cimg_forXY(image, x, y)
+    {
+        state = state * 1664525u + 1013904223u;
+        image(x, y) = (state >> 24) & 0xFF;
+    }
+    const int window_size = 7;
+    const int r = window_size / 2;
+
+    // Direct window statistics of one pixel
+    auto window_stats = [&](const int x, const int y, double &mean, double &std_dev)
+    {
+        double sum = 0.0, sum_sq = 0.0;
+        int n = 0;
+        for (int yy = std::max(0, y - r); yy <= std::min(image.height() - 1, y + r); ++yy)
+        {
+            for (int xx = std::max(0, x - r); xx <= std::min(image.width() - 1, x + r); ++xx)
+            {
+                sum += image(xx, yy);
+                sum_sq += static_cast<double>(image(xx, yy)) * image(xx, yy);
+                ++n;
+            }
+        }
+        mean = sum / n;
+        std_dev = std::sqrt(std::max(0.0, sum_sq / n - mean * mean));
+    };
+
+    // Number of pixels whose output disagrees with `threshold(mean, std)`, ignoring ties within single-precision rounding
+    auto mismatches = [&](const CImg<uint> &output, const auto &threshold)
+    {
+        int count = 0;
+        cimg_forXY(image, x, y)
+        {
+            double mean, std_dev;
+            window_stats(x, y, mean, std_dev);
+            const double t = threshold(mean, std_dev);
+            if (std::abs(image(x, y) - t) > 1e-3 && output(x, y) != ((image(x, y) > t) ? 255u : 0u))
+                ++count;
+        }
+        return count;
+    };
+
+    SECTION("Niblack")
+    {
+        CHECK(mismatches(ite::binarize_niblack(image, window_size, -0.2f), [](double m, double s) { return m - 0.2f * s; }) == 0);
+    }
+
+    SECTION("Wolf-Jolion")
+    {
+        double R = 0.0;
+        cimg_forXY(image, x, y)
+        {
+            double mean, std_dev;
+            window_stats(x, y, mean, std_dev);
+            R = std::max(R, std_dev);
+        }
+        const double M = image.min();
+        const float k = 0.5f;
+        CHECK(mismatches(ite::binarize_wolf(image, window_size, k), [&](double m, double s) { return (1.0 - k) * m + k * M + k * (s / R) * (m - M); }) ==
+              0);
+    }
+
+    SECTION("Phansalkar")
+    {
+        const float k = 0.25f;
+        CHECK(mismatches(ite::binarize_phansalkar(image, window_size, k),
+                         [&](double m, double s) { return m * (1.0 + 2.0 * std::exp(-10.0 * m / 255.0) + k * ((s / 255.0) / 0.5 - 1.0)); }) == 0);
+    }
+
+    SECTION("NICK")
+    {
+        const float k = -0.1f;
+        CHECK(mismatches(ite::binarize_nick(image, window_size, k), [&](double m, double s) { return m + k * std::sqrt(s * s + m * m); }) == 0);
+    }
+
+    SECTION("Dark text on a light page")
+    {
+        CImg<uint> page(60, 40, 1, 1, 210);
+        const uint ink = 30;
+        page.draw_rectangle(20, 15, 40, 20, &ink);
+
+        for (const auto &output : {ite::binarize_wolf(page, 15), ite::binarize_phansalkar(page, 15), ite::binarize_nick(page, 15)})
+        {
+            CHECK(output(30, 17) == 0);
+            CHECK(output(5, 5) == 255);
+        }
+
+        // Niblack's threshold equals the mean in flat regions (s = 0), so only the text is checked
+        CHECK(ite::binarize_niblack(page, 15)(30, 17) == 0);
+    }
+}
+
+TEST_CASE("binarize: Tiled Otsu", "[ite][binarize][Otsu]")
+{
+    // GIVEN: A page whose background darkens from left to right, with ink marks that are always 60 levels darker
+    const int w = 256, h = 128;
+    CImg<uint> page(w, h, 1, 1);
+    cimg_forXY(page, x, y)
+    {
+        const uint background = 240 - (x * 150) / w;
+        page(x, y) = ((x % 32) >= 8 && (x % 32) < 12 && (y % 32) >= 8 && (y % 32) < 24) ? background - 60 : background;
+    }
+
+    SECTION("Separates ink from background on both sides of the gradient")
+    {
+        const CImg<uint> tiled = ite::binarize_otsu(page, 32);
+        int errors = 0;
+        cimg_forXY(page, x, y)
+        {
+            const bool ink = (x % 32) >= 8 && (x % 32) < 12 && (y % 32) >= 8 && (y % 32) < 24;
+            errors += (tiled(x, y) == 0) != ink;
+        }
+        CHECK(errors == 0);
+
+        // A single global threshold cannot: the dark right background falls into the ink class
+        const CImg<uint> global = ite::binarize_otsu(page);
+        CHECK(global(w - 2, 2) == 0);
+    }
+
+    SECTION("Uniform tiles inherit their neighbours' thresholds")
+    {
+        CImg<uint> sparse(w, h, 1, 1, 200);
+        const uint ink = 40;
+        sparse.draw_rectangle(10, 10, 20, 20, &ink);
+        const CImg<uint> tiled = ite::binarize_otsu(sparse, 32);
+        CHECK(tiled(15, 15) == 0);
+        CHECK(tiled(w - 5, h - 5) == 255);
+        CHECK(tiled.sum() == 255.0 * (w * h - 11 * 11));
+    }
+
+    SECTION("Tile size 0 is the global method")
+    {
+        const CImg<uint> untiled = ite::binarize_otsu(page, 0);
+        const CImg<uint> global = ite::binarize_otsu(page);
+        int differences = 0;
+        cimg_forXY(page, x, y) { differences += untiled(x, y) != global(x, y); }
+        CHECK(differences == 0);
+    }
+}
+
+TEST_CASE("binarize: Multi-level Otsu", "[ite][binarize][Otsu]")
+{
+    // GIVEN: Dark text on a light page, half of it under a mid-tone highlight
+    CImg<uint> page(120, 80, 1, 1, 230);
+    const uint highlight = 120, ink = 30;
+    page.draw_rectangle(0, 40, 119, 79, &highlight);
+    for (int x = 10; x < 110; x += 20)
+    {
+        page.draw_rectangle(x, 10, x + 5, 30, &ink);
+        page.draw_rectangle(x, 50, x + 5, 70, &ink);
+    }
+
+    SECTION("Thresholds separate the three gray levels")
+    {
+        const std::vector<int> levels = ite::binarization::compute_otsu_thresholds(page, 2);
+        REQUIRE(levels.size() == 2);
+        CHECK(levels[0] >= 30);
+        CHECK(levels[0] < 120);
+        CHECK(levels[1] >= 120);
+        CHECK(levels[1] < 230);
+        CHECK(ite::binarization::compute_otsu_thresholds(page, 1)[0] == ite::binarization::compute_otsu_threshold(page));
+        CHECK_THROWS(ite::binarization::compute_otsu_thresholds(page, 4));
+    }
+
+    SECTION("Only the darkest class is foreground")
+    {
+        const CImg<uint> single = ite::binarize_otsu(page);
+        const CImg<uint> multi = ite::binarize_otsu(page, 0, 2);
+
+        // One threshold puts the highlight in the text class, two thresholds keep it in the background
+        CHECK(single(2, 60) == 0);
+        CHECK(multi(2, 60) == 255);
+        CHECK(multi(2, 20) == 255);
+        CHECK(multi(12, 20) == 0);
+        CHECK(multi(12, 60) == 0);
+    }
+
+    SECTION("Values above 255 are read without wrapping")
+    {
+        CImg<uint> bright = page;
+        bright(0, 0) = 300;
+        CHECK(ite::binarize_otsu(bright)(0, 0) == 255);
+    }
+}
+
+TEST_CASE("binarize: Automatic polarity", "[ite][binarize][polarity]")
+{
+    // Text page: 12x10 "letters" of value `ink` on `paper`
+    auto text_page = [](const uint paper, const uint ink)
+    {
+        CImg<uint> page(600, 400, 1, 1, paper);
+        for (int y = 40; y + 12 < 360; y += 30)
+            for (int x = 40; x + 10 < 560; x += 16)
+                for (int dy = 0; dy < 12; ++dy)
+                    for (int dx = 0; dx < 10; ++dx)
+                        page(x + dx, y + dy) = ink;
+        return page;
+    };
+
+    SECTION("Light text on a dark page is detected, dark text on a light page is not")
+    {
+        CHECK(ite::binarization::detect_dark_background(text_page(30, 220)));
+        CHECK_FALSE(ite::binarization::detect_dark_background(text_page(220, 30)));
+
+        // Unimodal pages keep their polarity
+        CHECK_FALSE(ite::binarization::detect_dark_background(CImg<uint>(600, 400, 1, 1, 20)));
+
+        // Color input: dark blue page with yellow text
+        const CImg<uint> gray = text_page(30, 220);
+        CImg<uint> color(600, 400, 1, 3);
+        cimg_forXY(gray, x, y)
+        {
+            const bool text = gray(x, y) > 100;
+            color(x, y, 0, 0) = text ? 240 : 10;
+            color(x, y, 0, 1) = text ? 220 : 20;
+            color(x, y, 0, 2) = text ? 40 : 90;
+        }
+        CHECK(ite::binarization::detect_dark_background(color));
+    }
+
+    SECTION("normalize_polarity inverts only dark pages")
+    {
+        const CImg<uint> dark = ite::normalize_polarity(text_page(30, 220));
+        CHECK(dark(0, 0) == 225);
+        CHECK(dark(42, 42) == 35);
+
+        const CImg<uint> light = ite::normalize_polarity(text_page(220, 30));
+        CHECK(light(0, 0) == 220);
+    }
+
+    SECTION("Sauvola sees dark text with auto polarity in enhance")
+    {
+        ite::EnhanceOptions opt;
+        opt.binarization_method = ite::BinarizationMethod::Sauvola;
+        opt.do_auto_polarity = true;
+
+        const CImg<uint> dark = ite::enhance(text_page(30, 220), opt);
+        const CImg<uint> light = ite::enhance(text_page(220, 30), opt);
+        CHECK(dark(45, 45) == 0);
+        CHECK(dark(20, 20) == 255);
+        CHECK(dark == light);
+    }
+
+    SECTION("Color pass keeps inverted text readable")
+    {
+        // GIVEN: White and yellow text on a dark blue page
+        const CImg<uint> gray = text_page(30, 220);
+        CImg<uint> color(600, 400, 1, 3);
+        cimg_forXY(gray, x, y)
+        {
+            const bool text = gray(x, y) > 100;
+            const bool yellow = x >= 300;
+            color(x, y, 0, 0) = text ? 250 : 10;
+            color(x, y, 0, 1) = text ? 250 : 20;
+            color(x, y, 0, 2) = text ? (yellow ? 40 : 250) : 90;
+        }
+
+        ite::EnhanceOptions opt;
+        opt.binarization_method = ite::BinarizationMethod::Sauvola;
+        opt.do_auto_polarity = true;
+        opt.do_color_pass = true;
+        const CImg<uint> result = ite::enhance(color, opt);
+
+        // THEN: The background is white and the text keeps its (inverted) color instead of vanishing into it
+        REQUIRE(result.spectrum() == 3);
+        CHECK(result(20, 20, 0, 0) == 255);
+        CHECK(result(45, 45, 0, 0) == 5);
+        CHECK(result(45, 45, 0, 2) == 5);
+        CHECK(result(345, 45, 0, 0) == 5);
+        CHECK(result(345, 45, 0, 2) == 215);
+    }
+}
@@ -0,0 +1,103 @@
+#include "color/background.h"
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+
+using uint = unsigned int;
+
+namespace
+{
+    /**
+     * Page lit from the left: paper falls from 240 to 90 across the width, "letters" are at 40% of the paper brightness.
+     */
+    CImg<uint> shaded_page(int w, int h)
+    {
+        CImg<uint> page(w, h, 1, 1);
+        cimg_forXY(page, x, y)
+        {
+            const uint paper = 240 - 150 * x / (w - 1);
+            const bool ink = (y % 30) >= 10 && (y % 30) < 22 && (x % 16) >= 3 && (x % 16) < 13;
+            page(x, y) = ink ? paper * 2 / 5 : paper;
+        }
+        return page;
+    }
+} // namespace
+
+TEST_CASE("flatten_background: Removes uneven illumination", "[ite][background]")
+{
+    const CImg<uint> page = shaded_page(480, 300);
+
+    SECTION("Background grid follows the paper, not the letters")
+    {
+        const int factor = ite::color::background_factor(51);
+        const CImg<uint> background = ite::color::estimate_background(page, 51, factor);
+        REQUIRE(background.width() == (480 + factor - 1) / factor);
+        REQUIRE(background.height() == (300 + factor - 1) / factor);
+
+        bool follows_paper = true;
+        cimg_forXY(background, gx, gy)
+        {
+            const int x = std::min(479, gx * factor + factor / 2);
+            const int paper = 240 - 150 * x / 479;
+            follows_paper = follows_paper && std::abs(static_cast<int>(background(gx, gy)) - paper) <= 8;
+        }
+        CHECK(follows_paper);
+    }
+
+    SECTION("Paper becomes white, letters keep their contrast")
+    {
+        const CImg<uint> flat = ite::flatten_background(page);
+
+        bool paper_white = true, ink_dark = true;
+        cimg_forXY(page, x, y)
+        {
+            const bool ink = (y % 30) >= 10 && (y % 30) < 22 && (x % 16) >= 3 && (x % 16) < 13;
+            if (ink)
+                ink_dark = ink_dark && flat(x, y) >= 90 && flat(x, y) <= 115;
+            else
+                paper_white = paper_white && flat(x, y) >= 245;
+        }
+        CHECK(paper_white);
+        CHECK(ink_dark);
+
+        // A single global threshold now separates the letters everywhere
+        const CImg<uint> bin = ite::binarize_otsu(flat);
+        CHECK(bin(8, 15) == 0);
+        CHECK(bin(472, 15) == 0);
+        CHECK(bin(8, 5) == 255);
+        CHECK(bin(472, 5) == 255);
+    }
+
+    SECTION("Invalid arguments")
+    {
+        CImg<uint> color(10, 10, 1, 3, 100);
+        REQUIRE_THROWS_AS(ite::color::flatten_background(color), std::invalid_argument);
+        CImg<uint> gray(10, 10, 1, 1, 100);
+        REQUIRE_THROWS_AS(ite::color::flatten_background(gray, 1), std::invalid_argument);
+    }
+}
+
+TEST_CASE("enhance: Background flattening stage", "[ite][background]")
+{
+    const CImg<uint> page = shaded_page(480, 300);
+
+    ite::EnhanceOptions opt;
+    opt.binarization_method = ite::BinarizationMethod::Otsu;
+    opt.do_background_flattening = true;
+
+    ite::TimingLog log;
+    const CImg<uint> result = ite::enhance(page, opt, 64, &log);
+    CHECK(result(8, 15) == 0);
+    CHECK(result(472, 15) == 0);
+    CHECK(result(472, 5) == 255);
+
+    bool has_background = false;
+    for (const auto &e : log)
+        has_background = has_background || e.name == "Background";
+    CHECK(has_background);
+
+    // Without flattening, the global threshold loses the dark side of the page
+    opt.do_background_flattening = false;
+    const CImg<uint> plain = ite::enhance(page, opt);
+    CHECK((plain(472, 5) == 0 || plain(8, 15) == 255));
+}
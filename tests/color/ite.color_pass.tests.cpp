@@ -1,6 +1,8 @@
+#include "color/color.h"
 #include "ite.h"
 #include <CImg.h>
 #include <catch2/catch_test_macros.hpp>
+#include <vector>
 
 // Define 'uint' for clarity matching your library
 using uint = unsigned int;
@@ -96,3 +98,52 @@ TEST_CASE("color_pass: Applies binary mask to color image", "[ite][color]")
         CHECK(result.is_empty());
     }
 }
+
+TEST_CASE("color_pass_inplace: Compact masks and interleaved rows match the planar pass", "[ite][color]")
+{
+    // Odd width so the bit-packed rows end in a partial byte
+    const int w = 37, h = 11;
+    CImg<uint> color_img(w, h, 1, 3);
+    CImg<uint> bin_img(w, h, 1, 1);
+    for (int c = 0; c < 3; ++c)
+        cimg_forXY(color_img, x, y) color_img(x, y, 0, c) = (x * 7 + y * 13 + c * 50) % 256;
+    cimg_forXY(bin_img, x, y) bin_img(x, y) = ((x + 2 * y) % 3 == 0) ? 0 : 255;
+
+    CImg<uint> expected = color_img;
+    ite::color::color_pass_inplace(expected, bin_img);
+
+    SECTION("8-bit mask")
+    {
+        CImg<uint> result = color_img;
+        ite::color::color_pass_inplace(result, CImg<unsigned char>(bin_img));
+        CHECK(result == expected);
+    }
+
+    SECTION("Bit-packed mask")
+    {
+        const ite::color::PackedMask mask = ite::color::pack_mask(bin_img);
+        CHECK(mask.stride == 5);
+        CHECK(mask.bits.size() == 5u * h);
+
+        CImg<uint> result = color_img;
+        ite::color::color_pass_inplace(result, mask);
+        CHECK(result == expected);
+    }
+
+    SECTION("Interleaved RGB rows")
+    {
+        const size_t stride = 3 * w + 5;
+        std::vector<unsigned char> rows(stride * 4, 0);
+        ite::color::color_pass_rows(color_img, bin_img, 3, 4, rows.data(), stride);
+
+        bool same = true;
+        for (int i = 0; i < 4; ++i)
+            for (int x = 0; x < w; ++x)
+                for (int c = 0; c < 3; ++c)
+                    same = same && rows[i * stride + 3 * x + c] == expected(x, 3 + i, 0, c);
+        CHECK(same);
+
+        REQUIRE_THROWS_AS(ite::color::color_pass_rows(color_img, bin_img, 8, 4, rows.data(), stride), std::invalid_argument);
+        REQUIRE_THROWS_AS(ite::color::color_pass_rows(color_img, bin_img, 0, 1, rows.data(), 3 * w - 1), std::invalid_argument);
+    }
+}
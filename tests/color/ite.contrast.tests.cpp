@@ -63,4 +63,76 @@ TEST_CASE("contrast_enhancement: Stretches histogram", "[ite][contrast]")
         // We pick a pixel that used to be 150. It should now be much brighter.
         CHECK(output(5, 5) > 200);
     }
-}
\ No newline at end of file
+}
+TEST_CASE("contrast_clahe: Equalizes local contrast", "[ite][contrast]")
+{
+    SECTION("Faint text in one part of the page gains contrast")
+    {
+        // Left half: faint strokes (120 on 135), right half: strong strokes (20 on 230)
+        CImg<uint> input(256, 128, 1, 1);
+        cimg_forXY(input, x, y)
+        {
+            const bool ink = (x % 8) < 3 && (y % 16) < 10;
+            if (x < 128)
+                input(x, y) = ink ? 120 : 135;
+            else
+                input(x, y) = ink ? 20 : 230;
+        }
+
+        const CImg<uint> stretched = ite::contrast_enhancement(input);
+        const CImg<uint> output = ite::contrast_clahe(input, 32, 40.0f);
+
+        // Ink at (40, 20), paper at (44, 20)
+        const int faint_stretched = static_cast<int>(stretched(44, 20)) - static_cast<int>(stretched(40, 20));
+        const int faint_clahe = static_cast<int>(output(44, 20)) - static_cast<int>(output(40, 20));
+        CHECK(faint_clahe > 2 * faint_stretched);
+
+        // A low clip limit keeps the mapping close to linear
+        const CImg<uint> limited = ite::contrast_clahe(input, 32, 1.0f);
+        CHECK(std::abs(static_cast<int>(limited(44, 20)) - static_cast<int>(limited(40, 20)) - 15) <= 2);
+
+        // Strong strokes stay separated
+        CHECK(output(200, 20) < output(203, 20));
+        CHECK(output.max() <= 255);
+    }
+
+    SECTION("A single tile is a monotone mapping")
+    {
+        CImg<uint> ramp(32, 32, 1, 1);
+        cimg_forXY(ramp, x, y) ramp(x, y) = 60 + (x + 32 * y) * 100 / 1024;
+
+        const CImg<uint> output = ite::contrast_clahe(ramp, 32, 2.0f);
+        bool monotone = true;
+        for (size_t i = 1; i < output.size(); ++i)
+            monotone = monotone && output[i] >= output[i - 1];
+        CHECK(monotone);
+        CHECK(output[output.size() - 1] > ramp[ramp.size() - 1]);
+    }
+
+    SECTION("Invalid parameters")
+    {
+        const CImg<uint> input(16, 16, 1, 1, 100);
+        REQUIRE_THROWS_AS(ite::contrast_clahe(input, 4, 2.0f), std::invalid_argument);
+        REQUIRE_THROWS_AS(ite::contrast_clahe(input, 16, 0.0f), std::invalid_argument);
+    }
+
+    SECTION("Replaces the contrast stage of enhance")
+    {
+        CImg<uint> input(128, 128, 1, 1, 135);
+        cimg_forXY(input, x, y) if ((x % 8) < 3 && (y % 16) < 10) input(x, y) = 120;
+
+        ite::EnhanceOptions opt;
+        opt.do_clahe = true;
+        ite::TimingLog log;
+        ite::enhance(input, opt, 64, &log);
+
+        bool has_clahe = false, has_stretch = false;
+        for (const auto &e : log)
+        {
+            has_clahe = has_clahe || e.name == "Contrast (CLAHE)";
+            has_stretch = has_stretch || e.name == "Contrast";
+        }
+        CHECK(has_clahe);
+        CHECK_FALSE(has_stretch);
+    }
+}
@@ -0,0 +1,42 @@
+#include "core/histogram.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <numeric>
+
+TEST_CASE("histogram: Global moments match CImg", "[core][histogram]")
+{
+    SECTION("8-bit image")
+    {
+        // GIVEN: A 2-slice image with a spread of gray values
+        CImg<uint> image(37, 23, 2, 1);
+        cimg_forXYZ(image, x, y, z)
+        {
+            image(x, y, z) = (x * 7 + y * 13 + z * 101) % 256;
+        }
+
+        // WHEN: The histogram is computed
+        const ite::core::Histogram hist = ite::core::compute_histogram(image);
+
+        // THEN: Counts and moments agree with the direct computations
+        CHECK(hist.count == image.size());
+        CHECK(hist.overflow == 0);
+        CHECK(hist.min == image.min());
+        CHECK(hist.max == image.max());
+        CHECK(std::abs(hist.mean() - image.mean()) < 1e-9);
+        CHECK(std::abs(hist.variance() - image.variance()) < 1e-6);
+        CHECK(std::accumulate(hist.bins.begin(), hist.bins.end(), uint64_t{0}) == image.size());
+    }
+
+    SECTION("Values above 255 still contribute to the moments")
+    {
+        CImg<uint> image(4, 1, 1, 1, 10, 20, 300, 1000);
+        const ite::core::Histogram hist = ite::core::compute_histogram(image);
+
+        CHECK(hist.overflow == 2);
+        CHECK(hist.bins[10] == 1);
+        CHECK(hist.max == 1000);
+        CHECK(hist.mean() == 332.5);
+        CHECK(std::abs(hist.variance() - image.variance()) < 1e-6);
+    }
+}
@@ -0,0 +1,107 @@
+#include "core/local_stats.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace
+{
+    CImg<uint> random_image(const int w, const int h, const int d = 1)
+    {
+        CImg<uint> image(w, h, d, 1);
+        uint32_t state = 12345u;
+        cimg_for(image, ptr, uint)
+        {
+            state = state * 1664525u + 1013904223u;
+            *ptr = (state >> 24) & 0xFF;
+        }
+        return image;
+    }
+} // namespace
+
+TEST_CASE("local stats: Matches brute-force window statistics", "[core][local_stats]")
+{
+    // GIVEN: A random image and windows that are smaller, similar and larger than the image
+    const CImg<uint> image = random_image(29, 17, 2);
+    const std::vector<ite::core::LocalWindow> windows = {{0, 0}, {1, 2}, {4, 4}, {7, 3}, {40, 40}};
+
+    // WHEN: All statistics of all windows are computed in one sweep
+    const ite::core::LocalStats stats(image, windows,
+                                      ite::core::LOCAL_MEAN | ite::core::LOCAL_STD_DEV | ite::core::LOCAL_MIN | ite::core::LOCAL_MAX);
+
+    std::vector<int> mismatches(windows.size(), 0);
+    std::vector<int> rows_seen(image.depth() * image.height(), 0);
+    stats.for_each_row(
+        [&](const int y, const int z, const int, const ite::core::LocalStatsRow* rows)
+        {
+            rows_seen[z * image.height() + y]++;
+            for (size_t i = 0; i < windows.size(); ++i)
+            {
+                for (int x = 0; x < image.width(); ++x)
+                {
+                    // THEN: Every value equals the direct computation over the clipped window
+                    double sum = 0.0, sum_sq = 0.0;
+                    uint lo = 255, hi = 0;
+                    int n = 0;
+                    for (int yy = std::max(0, y - windows[i].half_height); yy <= std::min(image.height() - 1, y + windows[i].half_height); ++yy)
+                    {
+                        for (int xx = std::max(0, x - windows[i].half_width); xx <= std::min(image.width() - 1, x + windows[i].half_width); ++xx)
+                        {
+                            const uint v = image(xx, yy, z);
+                            sum += v;
+                            sum_sq += static_cast<double>(v) * v;
+                            lo = std::min(lo, v);
+                            hi = std::max(hi, v);
+                            ++n;
+                        }
+                    }
+                    const double mean = sum / n;
+                    const double std_dev = std::sqrt(std::max(0.0, sum_sq / n - mean * mean));
+
+                    if (rows[i].mean[x] != mean || std::abs(rows[i].std_dev[x] - std_dev) > 1e-9 || rows[i].min[x] != lo || rows[i].max[x] != hi)
+                    {
+#pragma omp critical
+                        mismatches[i]++;
+                    }
+                }
+            }
+        });
+
+    for (size_t i = 0; i < windows.size(); ++i)
+    {
+        CHECK(mismatches[i] == 0);
+    }
+    CHECK(std::all_of(rows_seen.begin(), rows_seen.end(), [](const int n) { return n == 1; }));
+}
+
+TEST_CASE("local stats: Min/max filters", "[core][local_stats]")
+{
+    SECTION("Single bright pixel spreads over the window")
+    {
+        CImg<uint> image(9, 7, 1, 1, 0);
+        image(4, 3) = 200;
+
+        const CImg<uint> maxima = ite::core::local_max(image, {2, 1});
+        CHECK(maxima(2, 2) == 200);
+        CHECK(maxima(6, 4) == 200);
+        CHECK(maxima(1, 3) == 0);
+        CHECK(maxima(4, 1) == 0);
+        CHECK(maxima.sum() == 200.0 * 5 * 3);
+    }
+
+    SECTION("Large radii cover the whole image")
+    {
+        const CImg<uint> image = random_image(70, 11);
+        const CImg<uint> minima = ite::core::local_min(image, {100, 100});
+        CHECK(minima.min() == image.min());
+        CHECK(minima.max() == image.min());
+    }
+
+    SECTION("Invalid windows are rejected")
+    {
+        const CImg<uint> image(4, 4, 1, 1, 0);
+        CHECK_THROWS(ite::core::LocalStats(image, {}));
+        CHECK_THROWS(ite::core::LocalStats(image, {{-1, 1}}));
+    }
+}
@@ -0,0 +1,112 @@
+#include "core/pyramid.h"
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("pyramid: 2x box levels", "[core][pyramid]")
+{
+    SECTION("Averages 2x2 blocks, odd edges with the pixels they have")
+    {
+        // GIVEN: A 3x3 image
+        CImg<uint> image(3, 3, 1, 1, 0);
+        image(0, 0) = 10;
+        image(1, 0) = 20;
+        image(0, 1) = 30;
+        image(1, 1) = 41;
+        image(2, 0) = 100;
+        image(2, 1) = 50;
+        image(0, 2) = 7;
+        image(1, 2) = 8;
+        image(2, 2) = 9;
+
+        // WHEN: Halving it
+        const CImg<uint> half = ite::core::downsample_2x(image);
+
+        // THEN: Full blocks, edge pairs and the corner are averaged (rounded)
+        REQUIRE(half.width() == 2);
+        REQUIRE(half.height() == 2);
+        CHECK(half(0, 0) == 25); // (10 + 20 + 30 + 41) / 4 = 25.25
+        CHECK(half(1, 0) == 75); // (100 + 50) / 2
+        CHECK(half(0, 1) == 8); // (7 + 8) / 2 = 7.5
+        CHECK(half(1, 1) == 9);
+    }
+
+    SECTION("Levels down to the minimum long side, found by size")
+    {
+        CImg<uint> image(1000, 600, 1, 1, 0);
+        for (int y = 0; y < 600; ++y)
+            for (int x = 0; x < 1000; ++x)
+                image(x, y) = (x / 10 + y / 10) % 2 ? 200 : 40;
+
+        const ite::core::Pyramid pyramid(image, 100);
+
+        // 500, 250, 125 (the next one, 63, is below the minimum)
+        REQUIRE(pyramid.levels() == 3);
+        CHECK(pyramid.level(1).width() == 500);
+        CHECK(pyramid.level(3).width() == 125);
+        CHECK(pyramid.level(3).height() == 75);
+        CHECK(pyramid.base_width() == 1000);
+
+        CHECK(pyramid.find(200) == &pyramid.level(2));
+        CHECK(pyramid.find(126) == &pyramid.level(2));
+        CHECK(pyramid.find(125) == &pyramid.level(3));
+        CHECK(pyramid.find(600) == nullptr);
+    }
+
+    SECTION("Pointwise operations reach every level")
+    {
+        CImg<uint> image(64, 64, 1, 1, 100);
+        ite::core::Pyramid pyramid(image, 8);
+        pyramid.apply([](CImg<uint> &level) { level.fill(7); });
+        for (int i = 1; i <= pyramid.levels(); ++i)
+            CHECK(pyramid.level(i)(0, 0) == 7);
+    }
+}
+
+TEST_CASE("pyramid: Shared by the analysis stages of enhance", "[core][pyramid]")
+{
+    CImg<uint> page(900, 700, 1, 1, 230);
+    for (int y = 100; y < 600; y += 30)
+        for (int x = 100; x < 800; ++x)
+            for (int t = 0; t < 4; ++t)
+                page(x, y + t) = 30;
+
+    ite::EnhanceOptions opt;
+    opt.binarization_method = ite::BinarizationMethod::Bataineh;
+
+    SECTION("Built for Bataineh without denoising")
+    {
+        ite::TimingLog log;
+        ite::enhance(page, opt, 64, &log);
+        int count = 0;
+        for (const auto &e : log)
+            count += e.name == "Analysis Pyramid";
+        CHECK(count == 1);
+    }
+
+    SECTION("Not built when denoising invalidates it before the consumer")
+    {
+        ite::EnhanceOptions denoised = opt;
+        denoised.do_median_blur = true;
+        ite::TimingLog log;
+        ite::enhance(page, denoised, 64, &log);
+        for (const auto &e : log)
+            CHECK(e.name != "Analysis Pyramid");
+    }
+
+    SECTION("Cached re-runs give the same result as a fresh run")
+    {
+        ite::EnhanceOptions deskewed = opt;
+        deskewed.do_deskew = true;
+        ite::EnhanceCache cache;
+        ite::enhance(page, deskewed, 64, nullptr, false, &cache);
+        deskewed.threshold_scale = 2;
+        const CImg<uint> cached = ite::enhance(page, deskewed, 64, nullptr, false, &cache);
+        const CImg<uint> fresh = ite::enhance(page, deskewed);
+        REQUIRE(cached.size() == fresh.size());
+        bool same = true;
+        for (size_t i = 0; i < fresh.size(); ++i)
+            same = same && cached[i] == fresh[i];
+        CHECK(same);
+    }
+}
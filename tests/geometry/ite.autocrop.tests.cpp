@@ -0,0 +1,179 @@
+#include "geometry/geometry.h"
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cstdlib>
+
+using namespace ite::geometry;
+
+namespace
+{
+    /**
+     * Synthetic scan: light page with a block of dark "letters" in [x0, x1] x [y0, y1]
+     * and an optional black scanner border along the left and top edges.
+     */
+    CImg<uint> scanned_page(int w, int h, int x0, int y0, int x1, int y1, int border)
+    {
+        CImg<uint> page(w, h, 1, 1, 230);
+        for (int y = y0; y + 12 <= y1 + 1; y += 30)
+            for (int x = x0; x + 10 <= x1 + 1; x += 16)
+                for (int dy = 0; dy < 12; ++dy)
+                    for (int dx = 0; dx < 10; ++dx)
+                        page(x + dx, y + dy) = 25;
+
+        for (int y = 0; y < h; ++y)
+            for (int x = 0; x < w; ++x)
+                if (x < border || y < border)
+                    page(x, y) = 10;
+        return page;
+    }
+
+    /**
+     * Synthetic text block in [x0, x1] x [y0, y1]: letters of varying width, every third with an ascender and every
+     * seventh with a descender, so the page has an up and a down.
+     */
+    CImg<uint> text_page(int w, int h, int x0, int y0, int x1, int y1)
+    {
+        CImg<uint> page(w, h, 1, 1, 230);
+        const int x_height = 12;
+        int index = 0;
+        for (int base = y0 + x_height; base + x_height / 2 <= y1; base += 3 * x_height)
+        {
+            for (int x = x0; x + 14 <= x1; ++index)
+            {
+                const int letter_w = 5 + (index * 7) % 9;
+                const int top = base - x_height - (index % 3 == 0 ? x_height / 2 : 0);
+                const int bottom = base + (index % 3 != 0 && index % 7 == 0 ? x_height / 2 : 0);
+                for (int y = top; y < bottom; ++y)
+                    for (int dx = 0; dx < letter_w; ++dx)
+                        page(x + dx, y) = 25;
+                x += letter_w + 3 + (index % 5 == 4 ? 8 : 0);
+            }
+        }
+        return page;
+    }
+
+    /**
+     * Bounding box of the black pixels of a binary image.
+     */
+    Box ink_bounds(const CImg<uint> &image)
+    {
+        Box box{image.width(), image.height(), -1, -1};
+        cimg_forXY(image, x, y)
+        {
+            if (image(x, y) == 0)
+            {
+                box.x0 = std::min(box.x0, x);
+                box.y0 = std::min(box.y0, y);
+                box.x1 = std::max(box.x1, x);
+                box.y1 = std::max(box.y1, y);
+            }
+        }
+        return box;
+    }
+} // namespace
+
+TEST_CASE("detect_content_bounds: Finds the content inside margins and borders", "[ite][autocrop]")
+{
+    SECTION("Empty margins")
+    {
+        const CImg<uint> page = scanned_page(1200, 900, 300, 200, 899, 699, 0);
+        const Box box = detect_content_bounds(page);
+
+        // All ink is kept, with a small margin
+        CHECK(box.x0 <= 300);
+        CHECK(box.y0 <= 200);
+        CHECK(box.x1 >= 899);
+        CHECK(box.y1 >= 699);
+        CHECK(box.x0 >= 300 - 60);
+        CHECK(box.y0 >= 200 - 60);
+        CHECK(box.x1 <= 899 + 60);
+        CHECK(box.y1 <= 699 + 60);
+    }
+
+    SECTION("Black scanner border")
+    {
+        // Letters almost up to the right and bottom edges
+        const CImg<uint> page = scanned_page(1200, 900, 80, 80, 1199, 899, 50);
+        const Box box = detect_content_bounds(page);
+
+        CHECK(box.x0 >= 50);
+        CHECK(box.y0 >= 50);
+        CHECK(box.x0 <= 80);
+        CHECK(box.y0 <= 80);
+        CHECK(box.x1 >= 1190);
+        CHECK(box.y1 >= 871);
+    }
+
+    SECTION("Nothing to crop")
+    {
+        const CImg<uint> blank(800, 600, 1, 1, 240);
+        const Box box = detect_content_bounds(blank);
+        CHECK(box.width() == 800);
+        CHECK(box.height() == 600);
+    }
+}
+
+TEST_CASE("enhance: Auto-crop with and without paste back", "[ite][autocrop]")
+{
+    const CImg<uint> page = scanned_page(1200, 900, 300, 200, 899, 699, 40);
+
+    ite::EnhanceOptions opt;
+    opt.binarization_method = ite::BinarizationMethod::Sauvola;
+    opt.do_auto_crop = true;
+
+    SECTION("Only the content is processed")
+    {
+        const CImg<uint> result = ite::enhance(page, opt);
+        CHECK(result.width() < 700);
+        CHECK(result.height() < 600);
+        CHECK(result.width() >= 600);
+        CHECK(result.height() >= 500);
+    }
+
+    SECTION("Paste back restores the page size")
+    {
+        opt.crop_paste_back = true;
+        ite::TimingLog log;
+        const CImg<uint> result = ite::enhance(page, opt, 64, &log);
+
+        REQUIRE(result.width() == 1200);
+        REQUIRE(result.height() == 900);
+
+        // The first letter stays in place, the border becomes white
+        CHECK(result(305, 205) == 0);
+        CHECK(result(10, 10) == 255);
+        CHECK(result(600, 20) == 255);
+
+        bool has_crop = false, has_paste = false;
+        for (const auto &e : log)
+        {
+            has_crop = has_crop || e.name == "Auto Crop";
+            has_paste = has_paste || e.name == "Paste Back";
+        }
+        CHECK(has_crop);
+        CHECK(has_paste);
+    }
+
+    SECTION("Paste back onto a page turned by the orientation")
+    {
+        // GIVEN: A text page scanned sideways (turned 90 degrees clockwise), so the correction turns it back
+        const CImg<uint> upright = text_page(1200, 900, 300, 200, 899, 699);
+        opt.crop_paste_back = true;
+        const Box expected = ink_bounds(ite::enhance(upright, opt));
+        opt.do_orientation = true;
+
+        // WHEN: The content is cropped, turned upright and pasted back
+        const CImg<uint> result = ite::enhance(upright.get_rotate(90, 0, 0), opt);
+
+        // THEN: The page is upright in its full size, with the text where it is on the upright scan
+        REQUIRE(result.width() == 1200);
+        REQUIRE(result.height() == 900);
+        const Box ink = ink_bounds(result);
+        CHECK(std::abs(ink.x0 - expected.x0) <= 2);
+        CHECK(std::abs(ink.y0 - expected.y0) <= 2);
+        CHECK(std::abs(ink.x1 - expected.x1) <= 2);
+        CHECK(std::abs(ink.y1 - expected.y1) <= 2);
+    }
+}
@@ -1,3 +1,4 @@
+#include "geometry/geometry.h"
 #include "ite.h"
 #include <CImg.h>
 #include <catch2/catch_test_macros.hpp>
@@ -90,4 +91,145 @@ TEST_CASE("deskew: Corrects image rotation", "[ite][deskew]")
         // (Original line was at 49, 50, 51. So 50+5 = 55 is safely background).
         CHECK(output(cx, cy + 5) < 50); 
     }
-}
\ No newline at end of file
+}
+namespace
+{
+    /**
+     * Synthetic page: white background with lines of dark "letters" of varying widths.
+     * Every third letter has an ascender, every seventh a descender, as in running Latin text.
+     */
+    CImg<uint> text_page(int w, int h)
+    {
+        CImg<uint> page(w, h, 1, 1, 235);
+        const int x_height = 12;
+        int index = 0;
+        for (int base = 40; base + 2 * x_height < h - 30; base += 3 * x_height)
+        {
+            for (int x0 = 30; x0 + 14 < w - 30; ++index)
+            {
+                const int letter_w = 5 + (index * 7) % 9;
+                int top = base - x_height;
+                int bottom = base;
+                if (index % 3 == 0)
+                    top -= x_height / 2;
+                else if (index % 7 == 0)
+                    bottom += x_height / 2;
+
+                for (int y = top; y < bottom; ++y)
+                    for (int x = x0; x < x0 + letter_w; ++x)
+                        page(x, y) = 20;
+                x0 += letter_w + 3 + (index % 5 == 4 ? 8 : 0);
+            }
+        }
+        return page;
+    }
+} // namespace
+
+TEST_CASE("detect_page_rotation: Finds sideways and upside-down pages", "[ite][deskew][orientation]")
+{
+    const CImg<uint> page = text_page(500, 700);
+
+    SECTION("Quarter turns")
+    {
+        CHECK(ite::geometry::detect_page_rotation(page).orientation == 0);
+        // The correction undoes the turn: a page turned by 90 degrees clockwise needs 270 more
+        CHECK(ite::geometry::detect_page_rotation(page.get_rotate(90, 0, 0)).orientation == 270);
+        CHECK(ite::geometry::detect_page_rotation(page.get_rotate(180, 0, 0)).orientation == 180);
+        CHECK(ite::geometry::detect_page_rotation(page.get_rotate(270, 0, 0)).orientation == 90);
+    }
+
+    SECTION("Quarter turn and skew together")
+    {
+        const ite::geometry::PageRotation rotation = ite::geometry::detect_page_rotation(page.get_rotate(93, 1, 1));
+        CHECK(rotation.orientation == 270);
+        CHECK(std::abs(rotation.skew + 3.0) < 0.5);
+    }
+
+    SECTION("Orientation only is lossless")
+    {
+        const CImg<uint> output = ite::deskew(page.get_rotate(180, 0, 0), 1, true);
+        CHECK(output == page);
+    }
+}
+
+TEST_CASE("detect_skew_angle_docstrum: Levels dense and sparse pages", "[ite][deskew][docstrum]")
+{
+    SECTION("Text page")
+    {
+        const CImg<uint> skewed = text_page(500, 700).get_rotate(4, 1, 1);
+        CHECK(std::abs(ite::geometry::detect_skew_angle_docstrum(skewed) + 4.0) < 0.5);
+        CHECK(std::abs(ite::geometry::detect_skew_angle_projection_profile(skewed) + 4.0) < 0.5);
+    }
+
+    SECTION("Sparse page")
+    {
+        // A few rows of isolated blobs, like note heads on a music sheet
+        CImg<uint> page(800, 600, 1, 1, 240);
+        for (int y0 = 100; y0 < 500; y0 += 100)
+            for (int x0 = 100; x0 < 700; x0 += 45)
+                for (int y = 0; y < 7; ++y)
+                    for (int x = 0; x < 9; ++x)
+                        page(x0 + x, y0 + y) = 15;
+
+        const CImg<uint> skewed = page.get_rotate(-3, 1, 1);
+        CHECK(std::abs(ite::geometry::detect_skew_angle_docstrum(skewed) - 3.0) < 0.5);
+        CHECK(ite::geometry::detect_skew_angle_docstrum(page) == 0.0);
+    }
+
+    SECTION("Sideways page")
+    {
+        const CImg<uint> turned = text_page(500, 700).get_rotate(90, 0, 0);
+        const auto rotation = ite::geometry::detect_page_rotation(turned, true, ite::geometry::SkewEstimator::Docstrum);
+        CHECK(rotation.orientation == 270);
+        CHECK(rotation.skew == 0.0);
+    }
+}
+
+TEST_CASE("detect_page_rotation: Angle search strategies and early exit", "[ite][deskew][search]")
+{
+    using namespace ite::geometry;
+    const CImg<uint> page = text_page(500, 700);
+    const CImg<uint> skewed = page.get_rotate(4, 1, 1);
+
+    auto detect = [](const CImg<uint> &image, const AngleSearchOptions &search)
+    { return detect_page_rotation(image, false, SkewEstimator::ProjectionProfile, 15, 0.2f, 0.0f, nullptr, search); };
+
+    SECTION("Straight pages skip the search")
+    {
+        AngleSearchOptions search;
+        search.early_exit_margin = 0.01;
+        const PageRotation rotation = detect(page, search);
+        CHECK(rotation.skew == 0.0);
+        CHECK(rotation.evaluations == 3);
+
+        // A skewed page is still searched
+        const PageRotation skewed_rotation = detect(skewed, search);
+        CHECK(std::abs(skewed_rotation.skew + 4.0) < 0.3);
+        CHECK(skewed_rotation.evaluations > 30);
+    }
+
+    SECTION("Section searches find the grid's angle")
+    {
+        const PageRotation grid = detect(skewed, {});
+        CHECK(std::abs(grid.skew + 4.0) < 0.3);
+
+        AngleSearchOptions search;
+        search.strategy = AngleSearch::Golden;
+        const PageRotation golden = detect(skewed, search);
+        CHECK(std::abs(golden.skew - grid.skew) < 0.1);
+        CHECK(golden.evaluations < grid.evaluations);
+
+        search.strategy = AngleSearch::Ternary;
+        CHECK(std::abs(detect(skewed, search).skew - grid.skew) < 0.1);
+    }
+
+    SECTION("The budget caps the evaluations")
+    {
+        AngleSearchOptions search;
+        search.max_evaluations = 12;
+        const PageRotation rotation = detect(skewed, search);
+        CHECK(rotation.evaluations == 12);
+        // The 12 angles closest to 0 still cover -4 degrees
+        CHECK(std::abs(rotation.skew + 4.0) < 0.6);
+    }
+}
@@ -0,0 +1,197 @@
+#include "geometry/resample.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cmath>
+#include <stdexcept>
+
+using namespace ite::geometry;
+
+namespace
+{
+    // Image with a distinct value at every pixel and channel
+    CImg<uint> ramp_image(int w, int h, int channels)
+    {
+        CImg<uint> img(w, h, 1, channels);
+        for (int c = 0; c < channels; ++c)
+            for (int y = 0; y < h; ++y)
+                for (int x = 0; x < w; ++x)
+                    img(x, y, 0, c) = static_cast<uint>((x * 7 + y * 13 + c * 50) % 256);
+        return img;
+    }
+
+    bool same_pixels(const CImg<uint> &a, const CImg<uint> &b)
+    {
+        if (a.width() != b.width() || a.height() != b.height() || a.spectrum() != b.spectrum())
+            return false;
+        for (size_t i = 0; i < a.size(); ++i)
+            if (a.data()[i] != b.data()[i])
+                return false;
+        return true;
+    }
+} // namespace
+
+TEST_CASE("resize_area: Averages the covered source area", "[ite][resample]")
+{
+    SECTION("Integer factor averages blocks")
+    {
+        // GIVEN: A 4x4 image whose 2x2 blocks hold 0/100 and 40/80 pairs
+        CImg<uint> input(4, 4, 1, 1, 0);
+        for (int y = 0; y < 4; ++y)
+            for (int x = 0; x < 4; ++x)
+                input(x, y) = (x < 2) ? ((x + y) % 2 ? 100 : 0) : ((y < 2) ? 40 : 80);
+
+        // WHEN: Halving both sides
+        CImg<uint> output = resize_area(input, 2, 2);
+
+        // THEN: Every output pixel is the mean of its block
+        REQUIRE(output.width() == 2);
+        REQUIRE(output.height() == 2);
+        CHECK(output(0, 0) == 50);
+        CHECK(output(0, 1) == 50);
+        CHECK(output(1, 0) == 40);
+        CHECK(output(1, 1) == 80);
+    }
+
+    SECTION("Non-integer factor keeps a constant image and all channels")
+    {
+        CImg<uint> input(101, 67, 1, 3, 0);
+        for (int c = 0; c < 3; ++c)
+            for (int y = 0; y < 67; ++y)
+                for (int x = 0; x < 101; ++x)
+                    input(x, y, 0, c) = 60 + 70 * c;
+
+        CImg<uint> output = resize_area(input, 30, 20);
+
+        REQUIRE(output.spectrum() == 3);
+        for (int c = 0; c < 3; ++c)
+            for (int y = 0; y < 20; ++y)
+                for (int x = 0; x < 30; ++x)
+                    REQUIRE(output(x, y, 0, c) == static_cast<uint>(60 + 70 * c));
+    }
+
+    SECTION("Fractional coverage weights split pixels")
+    {
+        // 3 -> 2 pixels: each output covers 1.5 source pixels
+        CImg<uint> input(3, 1, 1, 1, 0);
+        input(0, 0) = 0;
+        input(1, 0) = 90;
+        input(2, 0) = 180;
+
+        CImg<uint> output = resize_area(input, 2, 1);
+
+        CHECK(output(0, 0) == 30); // (0 + 0.5 * 90) / 1.5
+        CHECK(output(1, 0) == 150); // (0.5 * 90 + 180) / 1.5
+    }
+
+    SECTION("Rejects non-positive sizes")
+    {
+        CImg<uint> input(10, 10, 1, 1, 0);
+        CHECK_THROWS_AS(resize_area(input, 0, 5), std::invalid_argument);
+    }
+}
+
+TEST_CASE("rotate: Quarter turns and arbitrary angles", "[ite][resample]")
+{
+    const CImg<uint> input = ramp_image(37, 23, 3);
+
+    SECTION("Quarter turns are exact permutations")
+    {
+        CImg<uint> r90 = rotate(input, 90.0);
+        REQUIRE(r90.width() == 23);
+        REQUIRE(r90.height() == 37);
+        for (int c = 0; c < 3; ++c)
+            for (int y = 0; y < 37; ++y)
+                for (int x = 0; x < 23; ++x)
+                    REQUIRE(r90(x, y, 0, c) == input(y, 22 - x, 0, c));
+
+        CImg<uint> r180 = rotate(input, 180.0);
+        for (int y = 0; y < 23; ++y)
+            for (int x = 0; x < 37; ++x)
+                REQUIRE(r180(x, y, 0, 1) == input(36 - x, 22 - y, 0, 1));
+
+        CHECK(same_pixels(rotate(input, -90.0), rotate(input, 270.0)));
+        CHECK(same_pixels(rotate(rotate(input, 90.0), 270.0), input));
+        CHECK(same_pixels(rotate(input, 360.0), input));
+    }
+
+    SECTION("Coordinate map gives the same result as the direct rotation")
+    {
+        for (Interpolation interp : {Interpolation::Nearest, Interpolation::Linear, Interpolation::Cubic})
+        {
+            const CoordinateMap map = rotation_map(input.width(), input.height(), 12.5);
+            CImg<uint> direct = rotate(input, 12.5, interp, 1);
+            CHECK(direct.width() == map.width);
+            CHECK(direct.height() == map.height);
+            CHECK(same_pixels(direct, remap(input, map, interp, 1)));
+        }
+    }
+
+    SECTION("Canvas encloses the rotated image")
+    {
+        const double rad = 30.0 * M_PI / 180.0;
+        CImg<uint> output = rotate(input, 30.0, Interpolation::Linear, 0);
+        CHECK(output.width() == static_cast<int>(std::lround(1 + 36 * std::cos(rad) + 22 * std::sin(rad))));
+        CHECK(output.height() == static_cast<int>(std::lround(1 + 36 * std::sin(rad) + 22 * std::cos(rad))));
+
+        // Dirichlet leaves the corners empty
+        CHECK(output(0, 0, 0, 0) == 0);
+        CHECK(output(output.width() - 1, output.height() - 1, 0, 2) == 0);
+    }
+
+    SECTION("Neumann keeps a constant image constant")
+    {
+        CImg<uint> flat(50, 40, 1, 1, 0);
+        for (size_t i = 0; i < flat.size(); ++i)
+            flat.data()[i] = 200;
+
+        CImg<uint> output = rotate(flat, 7.3, Interpolation::Cubic, 1);
+        for (size_t i = 0; i < output.size(); ++i)
+            REQUIRE(output.data()[i] == 200);
+    }
+
+    SECTION("Rejects a map whose arrays do not match its size")
+    {
+        CoordinateMap map;
+        map.width = 4;
+        map.height = 4;
+        map.x.resize(16);
+        CHECK_THROWS_AS(remap(input, map), std::invalid_argument);
+    }
+}
+
+TEST_CASE("rotate_masked: Samples only the unmasked pixels", "[ite][resample]")
+{
+    const CImg<uint> color = ramp_image(60, 45, 3);
+
+    SECTION("Equals a full rotation with the masked pixels filled")
+    {
+        const CImg<uint> full = rotate(color, 4.5, Interpolation::Cubic, 1);
+
+        // Mask: a few "text" pixels (0) on background (255)
+        CImg<uint> mask(full.width(), full.height(), 1, 1, 255);
+        for (int y = 10; y < mask.height() - 10; y += 3)
+            for (int x = 5; x < mask.width() - 5; x += 2)
+                mask(x, y) = 0;
+
+        CImg<uint> expected = full;
+        for (int c = 0; c < 3; ++c)
+            for (int y = 0; y < mask.height(); ++y)
+                for (int x = 0; x < mask.width(); ++x)
+                    if (mask(x, y) == 255)
+                        expected(x, y, 0, c) = 255;
+
+        CHECK(same_pixels(rotate_masked(color, 4.5, mask, 255, 255, Interpolation::Cubic, 1), expected));
+    }
+
+    SECTION("Quarter turns stay exact")
+    {
+        const CImg<uint> mask(45, 60, 1, 1, 0);
+        CHECK(same_pixels(rotate_masked(color, 270.0, mask), rotate(color, 270.0)));
+    }
+
+    SECTION("Rejects a mask of another size")
+    {
+        const CImg<uint> mask(60, 45, 1, 1, 0);
+        CHECK_THROWS_AS(rotate_masked(color, 10.0, mask), std::invalid_argument);
+    }
+}
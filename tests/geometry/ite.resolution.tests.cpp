@@ -0,0 +1,121 @@
+#include "geometry/resolution.h"
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_approx.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+using namespace ite::geometry;
+
+namespace
+{
+    /**
+     * Synthetic page: white background with lines of dark "letters". Most letters are x_height tall,
+     * every third one has an ascender, every seventh a descender.
+     */
+    CImg<uint> text_page(int w, int h, int x_height)
+    {
+        CImg<uint> page(w, h, 1, 1, 235);
+        const int letter_w = x_height * 3 / 5;
+        const int line_pitch = x_height * 3;
+        int index = 0;
+        for (int base = 2 * x_height; base + x_height < h - x_height; base += line_pitch)
+        {
+            for (int x0 = x_height; x0 + letter_w < w - x_height; x0 += letter_w + x_height / 3)
+            {
+                int top = base - x_height;
+                int bottom = base;
+                if (index % 3 == 0)
+                    top -= x_height / 2;
+                else if (index % 7 == 0)
+                    bottom += x_height / 2;
+                ++index;
+
+                for (int y = top; y < bottom; ++y)
+                    for (int x = x0; x < x0 + letter_w; ++x)
+                        page(x, y) = 20;
+            }
+        }
+        return page;
+    }
+} // namespace
+
+TEST_CASE("estimate_x_height: Measures the height of lowercase letters", "[ite][resolution]")
+{
+    SECTION("Page below the proxy size")
+    {
+        CHECK(estimate_x_height(text_page(1600, 1200, 24)) == Catch::Approx(24.0).margin(1.0));
+    }
+
+    SECTION("Large page measured on a proxy")
+    {
+        CHECK(estimate_x_height(text_page(4800, 3600, 60)) == Catch::Approx(60.0).margin(3.0));
+    }
+
+    SECTION("No estimate without text")
+    {
+        CImg<uint> blank(800, 600, 1, 1, 240);
+        CHECK(estimate_x_height(blank) == 0.0);
+        CHECK(dpi_normalization_scale(blank, 300) == 1.0);
+    }
+}
+
+TEST_CASE("DPI normalization: Downscales high-resolution pages", "[ite][resolution]")
+{
+    // x-height 60 px is about 900 DPI
+    const CImg<uint> page = text_page(3000, 2400, 60);
+
+    SECTION("Scale brings the text to the target resolution")
+    {
+        const double scale = dpi_normalization_scale(page, 300);
+        CHECK(scale == Catch::Approx(REFERENCE_X_HEIGHT_300DPI / 60.0).margin(0.02));
+
+        // Pages already at the target are left alone
+        CHECK(dpi_normalization_scale(text_page(1600, 1200, 20), 300) == 1.0);
+    }
+
+    SECTION("enhance works at the normalized resolution")
+    {
+        ite::EnhanceOptions opt;
+        opt.binarization_method = ite::BinarizationMethod::Sauvola;
+        opt.do_dpi_normalization = true;
+        opt.target_dpi = 300;
+
+        ite::TimingLog log;
+        const CImg<uint> result = ite::enhance(page, opt, 64, &log);
+
+        CHECK(result.width() == Catch::Approx(1000).margin(30));
+        CHECK(result.height() == Catch::Approx(800).margin(25));
+
+        bool has_event = false;
+        for (const auto &e : log)
+            has_event = has_event || e.name == "DPI Normalization";
+        CHECK(has_event);
+
+        // Letters survive: the first letter of the first line is ink in the result
+        const double s = static_cast<double>(result.width()) / page.width();
+        CHECK(result(static_cast<int>((60 + 18) * s), static_cast<int>(100 * s)) == 0);
+        CHECK(result(static_cast<int>(20 * s), static_cast<int>(20 * s)) == 255);
+    }
+
+    SECTION("Sweeps and cached runs reuse the estimate and match enhance")
+    {
+        std::vector<ite::EnhanceOptions> combinations(3);
+        for (auto &opt : combinations)
+            opt.do_dpi_normalization = true;
+        combinations[1].sauvola_k = 0.3f;
+        combinations[2].target_dpi = 200;
+
+        std::vector<CImg<uint>> results(combinations.size());
+        ite::enhance_sweep(page, combinations, [&](const size_t index, const CImg<uint> &result) { results[index] = result; });
+
+        ite::EnhanceCache cache;
+        for (size_t i = 0; i < combinations.size(); ++i)
+        {
+            const CImg<uint> expected = ite::enhance(page, combinations[i]);
+            CHECK(results[i] == expected);
+            CHECK(ite::enhance(page, combinations[i], 64, nullptr, false, &cache) == expected);
+        }
+        CHECK(results[2].width() < results[0].width());
+    }
+}
@@ -0,0 +1,123 @@
+#include "io/mrc.h"
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <vector>
+#include <zlib.h>
+
+using namespace ite::io;
+
+namespace
+{
+    /**
+     * White page with rows of red and blue "letters".
+     */
+    CImg<uint> color_page(int w, int h)
+    {
+        CImg<uint> page(w, h, 1, 3, 255);
+        for (int y = 16; y + 12 < h; y += 32)
+            for (int x = 16; x + 10 < w; x += 16)
+                for (int dy = 0; dy < 12; ++dy)
+                    for (int dx = 0; dx < 10; ++dx)
+                    {
+                        const bool red = (y / 32) % 2 == 0;
+                        page(x + dx, y + dy, 0, 0) = red ? 200 : 20;
+                        page(x + dx, y + dy, 0, 1) = 30;
+                        page(x + dx, y + dy, 0, 2) = red ? 40 : 180;
+                    }
+        return page;
+    }
+
+    std::vector<unsigned char> read_file(const std::string &path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        return {std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()};
+    }
+
+    uint32_t get_u32(const std::vector<unsigned char> &data, const size_t pos)
+    {
+        return (uint32_t(data[pos]) << 24) | (uint32_t(data[pos + 1]) << 16) | (uint32_t(data[pos + 2]) << 8) | uint32_t(data[pos + 3]);
+    }
+} // namespace
+
+TEST_CASE("split_mrc: Layers reproduce the page", "[ite][mrc]")
+{
+    const CImg<uint> page = color_page(203, 150);
+
+    SECTION("Mask is exact and uniform blocks keep their color")
+    {
+        const MrcLayers layers = split_mrc(page, 8);
+        REQUIRE(layers.mask.width() == 203);
+        REQUIRE(layers.mask.height() == 150);
+        CHECK(layers.foreground.width() == 26);
+        CHECK(layers.foreground.height() == 19);
+
+        bool mask_ok = true;
+        cimg_forXY(page, x, y)
+        {
+            const bool white = page(x, y, 0, 0) == 255 && page(x, y, 0, 1) == 255 && page(x, y, 0, 2) == 255;
+            mask_ok = mask_ok && layers.mask(x, y) == (white ? 255u : 0u);
+        }
+        CHECK(mask_ok);
+
+        // Every letter row has a single color, so the page comes back unchanged
+        CHECK(compose_mrc(layers) == page);
+    }
+
+    SECTION("Empty blocks take the mean ink color")
+    {
+        const MrcLayers layers = split_mrc(page, 8);
+        // Block (0, 0) holds no letters; red and blue rows are about equally frequent
+        CHECK(layers.foreground(0, 0, 0, 1) == 30);
+        CHECK(layers.foreground(0, 0, 0, 0) > 20);
+        CHECK(layers.foreground(0, 0, 0, 0) < 200);
+    }
+
+    SECTION("Invalid scale")
+    {
+        REQUIRE_THROWS_AS(split_mrc(page, 0), std::invalid_argument);
+    }
+}
+
+TEST_CASE("save_bilevel_png: Writes a valid 1-bit PNG", "[ite][mrc]")
+{
+    const CImg<uint> page = color_page(203, 150);
+    const MrcLayers layers = split_mrc(page);
+    const std::string path = (std::filesystem::temp_directory_path() / "ite_mrc_test.mask.png").string();
+
+    save_bilevel_png(layers.mask, path);
+    const std::vector<unsigned char> png = read_file(path);
+    std::remove(path.c_str());
+
+    REQUIRE(png.size() > 33);
+    const std::vector<unsigned char> signature = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    CHECK(std::equal(signature.begin(), signature.end(), png.begin()));
+    CHECK(get_u32(png, 16) == 203);
+    CHECK(get_u32(png, 20) == 150);
+    CHECK(png[24] == 1); // Bit depth
+    CHECK(png[25] == 0); // Grayscale
+
+    // Much smaller than the 8-bit RGB pixels
+    CHECK(png.size() * 50 < page.size());
+
+    // IDAT follows IHDR; its pixels decode to the mask
+    const size_t idat = 33;
+    REQUIRE(std::string(png.begin() + idat + 4, png.begin() + idat + 8) == "IDAT");
+    const size_t row_bytes = 1 + (203 + 7) / 8;
+    std::vector<unsigned char> raw(row_bytes * 150);
+    uLongf raw_size = raw.size();
+    REQUIRE(uncompress(raw.data(), &raw_size, png.data() + idat + 8, get_u32(png, idat)) == Z_OK);
+    REQUIRE(raw_size == raw.size());
+
+    bool pixels_ok = true;
+    cimg_forXY(layers.mask, x, y)
+    {
+        const bool white = (raw[y * row_bytes + 1 + x / 8] >> (7 - x % 8)) & 1;
+        pixels_ok = pixels_ok && white == (layers.mask(x, y) == 255);
+    }
+    CHECK(pixels_ok);
+}
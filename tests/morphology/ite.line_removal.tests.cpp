@@ -0,0 +1,142 @@
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+
+namespace
+{
+    void fill(CImg<uint> &image, int x0, int y0, int x1, int y1, int z = 0)
+    {
+        for (int y = y0; y <= y1; ++y)
+            for (int x = x0; x <= x1; ++x)
+                image(x, y, z) = 0;
+    }
+} // namespace
+
+TEST_CASE("remove_lines: Removes rules and keeps crossing strokes", "[ite][line_removal]")
+{
+    SECTION("Staff line crossed by a note stem")
+    {
+        // GIVEN: A 2 px staff line across the page, a stem crossing it and a short dash beside it
+        CImg<uint> input(300, 100, 1, 1, 255);
+        fill(input, 0, 50, 299, 51);
+        fill(input, 100, 30, 102, 70); // Stem
+        fill(input, 200, 20, 239, 21); // Dash shorter than the minimum length
+
+        // WHEN: Lines of at least 101 px are removed
+        const CImg<uint> output = ite::remove_lines(input, 101);
+
+        // THEN: The line is gone, the stem stays connected through it, the dash is untouched
+        CHECK(output(10, 50) == 255);
+        CHECK(output(250, 51) == 255);
+        CHECK(output(99, 50) == 255);
+        CHECK(output(101, 40) == 0);
+        CHECK(output(101, 50) == 0);
+        CHECK(output(101, 51) == 0);
+        CHECK(output(101, 60) == 0);
+        CHECK(output(220, 20) == 0);
+    }
+
+    SECTION("Table grid with text in the cells")
+    {
+        CImg<uint> input(240, 240, 1, 1, 255);
+        for (int i = 0; i <= 2; ++i)
+        {
+            fill(input, 0, i * 110 + 10, 239, i * 110 + 11); // Rows
+            fill(input, i * 110 + 10, 0, i * 110 + 11, 239); // Columns
+        }
+        fill(input, 40, 40, 49, 59); // A "letter" in the first cell
+
+        const CImg<uint> output = ite::remove_lines(input, 101);
+
+        // All rules including their crossings are removed, the letter is kept
+        bool letter = true;
+        int black = 0;
+        cimg_forXY(output, x, y)
+        {
+            const bool in_letter = x >= 40 && x <= 49 && y >= 40 && y <= 59;
+            letter = letter && (!in_letter || output(x, y) == 0);
+            black += (!in_letter && output(x, y) == 0) ? 1 : 0;
+        }
+        CHECK(letter);
+        CHECK(black == 0);
+    }
+
+    SECTION("Strokes cut by the border")
+    {
+        // GIVEN: A stem and a bar of 60 px that touch the border, and a rule across the full width
+        CImg<uint> input(300, 200, 1, 1, 255);
+        fill(input, 20, 0, 22, 59); // Stem cut at the top
+        fill(input, 240, 100, 299, 102); // Bar cut at the right
+        fill(input, 0, 150, 299, 151); // Rule
+
+        const CImg<uint> output = ite::remove_lines(input, 101);
+
+        // THEN: Only the rule is removed; outside the image counts as background
+        CHECK(output(21, 0) == 0);
+        CHECK(output(21, 30) == 0);
+        CHECK(output(21, 59) == 0);
+        CHECK(output(299, 101) == 0);
+        CHECK(output(240, 101) == 0);
+        CHECK(output(0, 150) == 255);
+        CHECK(output(299, 151) == 255);
+    }
+
+    SECTION("Every slice of a volume")
+    {
+        // GIVEN: Two slices with a staff line, each crossed by a stem at a different position
+        CImg<uint> input(300, 100, 2, 1, 255);
+        for (int z = 0; z < 2; ++z)
+        {
+            fill(input, 0, 50, 299, 51, z);
+            fill(input, 100 + 100 * z, 30, 102 + 100 * z, 70, z);
+        }
+
+        const CImg<uint> output = ite::remove_lines(input, 101);
+
+        // THEN: Both slices lose the line and keep their own stem connected through it
+        for (int z = 0; z < 2; ++z)
+        {
+            CHECK(output(10, 50, z) == 255);
+            CHECK(output(101 + 100 * z, 50, z) == 0);
+            CHECK(output(101 + 100 * z, 51, z) == 0);
+            CHECK(output(101 + 100 * (1 - z), 50, z) == 255);
+        }
+    }
+
+    SECTION("Short lengths and multi-channel images")
+    {
+        CImg<uint> input(50, 50, 1, 1, 255);
+        fill(input, 0, 10, 49, 10);
+        CHECK(ite::remove_lines(input, 1) == input);
+
+        const CImg<uint> color(10, 10, 1, 3, 255);
+        REQUIRE_THROWS_AS(ite::remove_lines(color, 101), std::runtime_error);
+    }
+
+    SECTION("Line removal stage in enhance")
+    {
+        // Gray page with an underlined word
+        CImg<uint> page(400, 200, 1, 1, 230);
+        for (int x = 50; x + 10 < 350; x += 16)
+            for (int y = 80; y < 100; ++y)
+                for (int dx = 0; dx < 10; ++dx)
+                    page(x + dx, y) = 20;
+        for (int x = 40; x < 360; ++x)
+            for (int y = 104; y < 107; ++y)
+                page(x, y) = 20;
+
+        ite::EnhanceOptions opt;
+        opt.binarization_method = ite::BinarizationMethod::Otsu;
+        opt.do_line_removal = true;
+
+        ite::TimingLog log;
+        const CImg<uint> result = ite::enhance(page, opt, 64, &log);
+        CHECK(result(200, 105) == 255);
+        CHECK(result(55, 90) == 0);
+
+        bool has_stage = false;
+        for (const auto &e : log)
+            has_stage = has_stage || e.name == "Line Removal";
+        CHECK(has_stage);
+    }
+}
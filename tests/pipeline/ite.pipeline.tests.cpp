@@ -0,0 +1,237 @@
+#include "ite.h"
+#include <CImg.h>
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // Dark strokes on a light, noisy page
+    CImg<uint> test_page(const int w = 96, const int h = 64, const int spectrum = 1)
+    {
+        CImg<uint> image(w, h, 1, spectrum);
+        uint32_t state = 777u;
+        cimg_forC(image, c)
+        {
+            cimg_forXY(image, x, y)
+            {
+                state = state * 1664525u + 1013904223u;
+                const bool stroke = (x % 16) < 3 && (y % 20) > 4;
+                image(x, y, 0, c) = (stroke ? 40u : 200u) + ((state >> 24) & 0x1F) + 10u * c;
+            }
+        }
+        return image;
+    }
+
+    int differences(const CImg<uint> &a, const CImg<uint> &b)
+    {
+        if (a.width() != b.width() || a.height() != b.height() || a.spectrum() != b.spectrum())
+            return -1;
+        int n = 0;
+        for (size_t i = 0; i < a.size(); ++i)
+            n += a[i] != b[i];
+        return n;
+    }
+
+    long count_events(const ite::TimingLog &log, const std::string &name)
+    {
+        return std::count_if(log.begin(), log.end(), [&](const ite::TimingEvent &e) { return e.name == name; });
+    }
+} // namespace
+
+TEST_CASE("pipeline: Sweep matches individual runs", "[ite][pipeline][sweep]")
+{
+    const CImg<uint> page = test_page(96, 64, 3);
+
+    // GIVEN: Combinations that differ in denoising, binarization and post-processing
+    std::vector<ite::EnhanceOptions> combinations;
+    for (const int window : {3, 5})
+    {
+        for (const float k : {0.1f, 0.2f, 0.3f})
+        {
+            ite::EnhanceOptions opt;
+            opt.do_adaptive_median = true;
+            opt.adaptive_median_max_window = window;
+            opt.sauvola_k = k;
+            combinations.push_back(opt);
+        }
+    }
+    ite::EnhanceOptions colored;
+    colored.do_color_pass = true;
+    colored.do_dilation = true;
+    combinations.push_back(colored);
+
+    // WHEN: All combinations are evaluated in one sweep
+    std::vector<CImg<uint>> results(combinations.size());
+    std::vector<int> calls(combinations.size(), 0);
+    ite::TimingLog log;
+    ite::enhance_sweep(page, combinations,
+                       [&](const size_t index, const CImg<uint> &result)
+                       {
+                           results[index] = result;
+                           calls[index]++;
+                       },
+                       64, &log);
+
+    // THEN: Every result equals a separate enhance run
+    for (size_t i = 0; i < combinations.size(); ++i)
+    {
+        CHECK(calls[i] == 1);
+        CHECK(differences(results[i], ite::enhance(page, combinations[i])) == 0);
+    }
+
+    // AND: Shared stages ran once per distinct prefix
+    CHECK(count_events(log, "Adaptive Median") == 2);
+    CHECK(count_events(log, "Binarization (Sauvola)") == 7);
+    CHECK(count_events(log, "Cache Restore") == 5); // all but the first run of each input copy (gray / gray + color)
+}
+
+TEST_CASE("pipeline: Empty sweep", "[ite][pipeline][sweep]")
+{
+    int calls = 0;
+    ite::enhance_sweep(test_page(), {}, [&](size_t, const CImg<uint> &) { calls++; });
+    CHECK(calls == 0);
+}
+
+TEST_CASE("pipeline: Cached re-runs resume from the deepest valid stage", "[ite][pipeline][cache]")
+{
+    const CImg<uint> page = test_page();
+    ite::EnhanceCache cache;
+
+    ite::EnhanceOptions opt;
+    opt.do_median_blur = true;
+    opt.despeckle_threshold = 4;
+
+    // GIVEN: A first run that fills the cache
+    ite::TimingLog log;
+    CHECK(differences(ite::enhance(page, opt, 64, &log, false, &cache), ite::enhance(page, opt)) == 0);
+    CHECK(count_events(log, "Median Blur") == 1);
+    CHECK(cache.size() > 0);
+
+    SECTION("Changing a post-binarization option only re-runs the tail")
+    {
+        opt.despeckle_threshold = 12;
+        log.clear();
+        const CImg<uint> result = ite::enhance(page, opt, 64, &log, false, &cache);
+
+        CHECK(differences(result, ite::enhance(page, opt)) == 0);
+        CHECK(count_events(log, "Median Blur") == 0);
+        CHECK(count_events(log, "Binarization (Sauvola)") == 0);
+        CHECK(count_events(log, "Despeckle") == 1);
+    }
+
+    SECTION("Unchanged options return the cached result")
+    {
+        log.clear();
+        CHECK(differences(ite::enhance(page, opt, 64, &log, false, &cache), ite::enhance(page, opt)) == 0);
+        CHECK(count_events(log, "Despeckle") == 0);
+    }
+
+    SECTION("A different input starts over")
+    {
+        CImg<uint> edited = page;
+        edited(5, 5) = 0;
+        log.clear();
+        CHECK(differences(ite::enhance(edited, opt, 64, &log, false, &cache), ite::enhance(edited, opt)) == 0);
+        CHECK(count_events(log, "Init & Copy") == 1);
+        CHECK(count_events(log, "Median Blur") == 1);
+    }
+
+    SECTION("Clearing drops the cached stages")
+    {
+        cache.clear();
+        CHECK(cache.size() == 0);
+    }
+}
+
+TEST_CASE("pipeline: Cached deskew keeps the pyramid state of the options", "[ite][pipeline][cache]")
+{
+    // GIVEN: Text lines skewed by about 4 degrees on a light page
+    CImg<uint> page(240, 160, 1, 1, 210);
+    cimg_forXY(page, x, y)
+    {
+        const double v = y - 0.07 * x;
+        if (std::fmod(v + 200.0, 16.0) < 3.0 && (x % 12) < 9 && x > 10 && x < 230 && y > 10 && y < 150)
+            page(x, y) = 40;
+    }
+
+    ite::EnhanceOptions opt;
+    opt.binarization_method = ite::BinarizationMethod::Bataineh;
+    opt.do_deskew = true;
+    opt.do_median_blur = true;
+    ite::EnhanceCache cache;
+    ite::TimingLog log;
+    ite::enhance(page, opt, 64, &log, false, &cache);
+    REQUIRE(count_events(log, "Deskew") == 1);
+
+    // WHEN: Denoising is switched off, so Bataineh classifies on the pyramid of the rotated page
+    opt.do_median_blur = false;
+    log.clear();
+    const CImg<uint> result = ite::enhance(page, opt, 64, &log, false, &cache);
+
+    // THEN: The deskew stage is not reused from the run without pyramid, and the result equals an uncached run
+    CHECK(count_events(log, "Deskew") == 1);
+    CHECK(differences(result, ite::enhance(page, opt)) == 0);
+
+    // AND: Switching back resumes from the matching cached stages
+    opt.do_median_blur = true;
+    log.clear();
+    CHECK(differences(ite::enhance(page, opt, 64, &log, false, &cache), ite::enhance(page, opt)) == 0);
+}
+
+TEST_CASE("pipeline: Region re-enhancement matches a full run", "[ite][pipeline][region]")
+{
+    ite::EnhanceOptions opt;
+    opt.do_median_blur = true;
+    opt.despeckle_threshold = 6;
+    opt.do_dilation = true;
+    opt.kernel_size = 3;
+
+    SECTION("Local pipeline, grayscale and color")
+    {
+        for (const int spectrum : {1, 3})
+        {
+            ite::EnhanceOptions local = opt;
+            local.do_color_pass = spectrum == 3;
+            const CImg<uint> page = test_page(400, 300, spectrum);
+            const CImg<uint> previous = ite::enhance(page, local);
+
+            // GIVEN: A retouched area
+            CImg<uint> edited = page;
+            const uint ink[] = {20, 30, 40};
+            edited.draw_rectangle(70, 50, 80, 58, ink);
+
+            // WHEN: Only that area is re-enhanced
+            ite::TimingLog log;
+            const CImg<uint> updated = ite::enhance_region(edited, {68, 48, 15, 13}, local, previous, 64, &log);
+
+            // THEN: The result equals a full run on the edited image, and only the region was processed
+            CHECK(differences(updated, ite::enhance(edited, local)) == 0);
+            CHECK(count_events(log, "Region Splice") == 1);
+        }
+    }
+
+    SECTION("Stages with image-wide statistics run the full pipeline")
+    {
+        opt.binarization_method = ite::BinarizationMethod::Otsu;
+        const CImg<uint> page = test_page(160, 120);
+        CImg<uint> edited = page;
+        const uint ink = 0;
+        edited.draw_rectangle(10, 10, 30, 20, &ink);
+
+        ite::TimingLog log;
+        const CImg<uint> updated = ite::enhance_region(edited, {10, 10, 21, 11}, opt, ite::enhance(page, opt), 64, &log);
+        CHECK(differences(updated, ite::enhance(edited, opt)) == 0);
+        CHECK(count_events(log, "Region Splice") == 0);
+    }
+
+    SECTION("Empty rectangles and size mismatches")
+    {
+        const CImg<uint> page = test_page(64, 48);
+        const CImg<uint> previous = ite::enhance(page, opt);
+        CHECK(differences(ite::enhance_region(page, {100, 100, 5, 5}, opt, previous), previous) == 0);
+        CHECK_THROWS(ite::enhance_region(page, {0, 0, 5, 5}, opt, CImg<uint>(10, 10, 1, 1, 0)));
+    }
+}
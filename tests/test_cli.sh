@@ -58,11 +58,24 @@ run_test "Kernel size must be > 0 (given 0)" 2 -i in.jpg -o out.jpg --kernel-siz
 run_test "Adaptive median max must be odd (given 4)" 2 -i in.jpg -o out.jpg --adaptive-median-max 4
 run_test "Adaptive median max must be >= 3 (given 1)" 2 -i in.jpg -o out.jpg --adaptive-median-max 1
 run_test "Despeckle thresh can be 0 (non-negative)" 2 -i in.jpg -o out.jpg --despeckle-thresh -1
+run_test "Unknown binarization method" 2 -i in.jpg -o out.jpg --binarization fake
+run_test "Unknown skew method" 2 -i in.jpg -o out.jpg --do-deskew --skew-method hough
+run_test "Unknown deskew search" 2 -i in.jpg -o out.jpg --do-deskew --deskew-search binary
+run_test "Otsu tile size too small" 2 -i in.jpg -o out.jpg --otsu-tile-size 8
+run_test "Otsu thresholds out of range" 2 -i in.jpg -o out.jpg --otsu-thresholds 4
+run_test "Sweep over a non-pipeline option" 2 -i in.jpg -o out.jpg --sweep trials=1,2
+run_test "Sweep without values" 2 -i in.jpg -o out.jpg --sweep sauvola-k
+run_test "Target DPI too low" 2 -i in.jpg -o out.jpg --do-dpi-normalization --target-dpi 10
+run_test "Background window too small" 2 -i in.jpg -o out.jpg --do-background-flattening --background-window 2
+run_test "CLAHE tile size too small" 2 -i in.jpg -o out.jpg --do-clahe --clahe-tile-size 4
+run_test "Line min length too small" 2 -i in.jpg -o out.jpg --do-line-removal --line-min-length 2
+run_test "MRC scale must be > 0 (given 0)" 2 -i in.jpg -o out.jpg --mrc-scale 0
 
 # --- 5. Valid Combinations (Simulated) ---
 # Note: These might still return 1 if the files 'in.jpg' don't exist,
 # but they test that the CLI parser itself accepts the flags.
 run_test "Valid toggles and params" 1 -i in.jpg -o out.jpg --do-gaussian --sigma 1.5 --do-deskew
+run_test "Valid local binarization method and k" 1 -i in.jpg -o out.jpg --binarization wolf --wolf-k 0.3 --niblack-k -0.25
 
 echo "--------------------------------"
 echo -e "Tests Completed: ${GREEN}$PASSED passed${NC}, ${RED}$FAILED failed${NC}"